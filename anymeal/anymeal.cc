@@ -13,22 +13,74 @@
 
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cstring>
+#include <iostream>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QSplashScreen>
 #include "main_window.hh"
+#include "pack.hh"
 
 
+// Copy the recipe database without starting the user interface (e.g. for nightly snapshots).
+static int backup(const char *filename) {
+  try {
+    Database database;
+    database.open(MainWindow::database_path().toUtf8().constData(), true);
+    int shown = -1;
+    database.backup_to(filename, [&shown](int remaining, int total) {
+      int percent = total > 0 ? (total - remaining) * 100 / total : 100;
+      if (percent != shown) {
+        std::cerr << "\rBacking up database ... " << percent << "%" << std::flush;
+        shown = percent;
+      };
+      return true;
+    });
+    std::cerr << std::endl;
+    return 0;
+  } catch (std::exception &e) {
+    std::cerr << std::endl << e.what() << std::endl;
+    return 1;
+  };
+}
+
+// Write all recipes to a read-only pack file without starting the user interface.
+static int pack(const char *filename) {
+  try {
+    Database database;
+    database.open(MainWindow::database_path().toUtf8().constData(), true);
+    database.select_all();
+    write_pack(database, filename);
+    return 0;
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  };
+}
+
 int main(int argc, char *argv[]) {
   QCoreApplication::setApplicationName("anymeal");
   QCoreApplication::addLibraryPath(".");
+  for (int i=1; i<argc-1; i++)
+    if (!strcmp(argv[i], "--backup")) {
+      QCoreApplication app(argc, argv);
+      return backup(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--pack")) {
+      QCoreApplication app(argc, argv);
+      return pack(argv[i + 1]);
+    };
   QApplication app(argc, argv);
   QPixmap pixmap(":/images/splash.png");
   QSplashScreen splash(pixmap);
   splash.show();
   app.processEvents();
   setlocale(LC_NUMERIC, "C"); // Change back behaviour of atof.
-  MainWindow main_window;
+  // Print execution statistics of the SQL statements when exiting.
+  bool profile_sql = app.arguments().contains("--profile-sql");
+  MainWindow main_window(NULL, profile_sql);
   splash.finish(&main_window);
   main_window.show();
-  return app.exec();
+  int result = app.exec();
+  if (profile_sql)
+    std::cerr << main_window.profile_report();
+  return result;
 }
@@ -0,0 +1,80 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include "async_database.hh"
+
+
+using namespace std;
+
+AsyncDatabase::AsyncDatabase(void): m_stop(false), m_submitted(0), m_started(0), m_running(0)
+{
+  m_thread = thread(&AsyncDatabase::run, this);
+}
+
+AsyncDatabase::~AsyncDatabase(void) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_one();
+  m_thread.join();
+}
+
+void AsyncDatabase::open(const char *filename, bool read_only) {
+  string name(filename);
+  call([name, read_only](Database &database) { database.open(name.c_str(), read_only); });
+}
+
+long AsyncDatabase::last_request(void) {
+  lock_guard<mutex> lock(m_mutex);
+  return m_submitted;
+}
+
+void AsyncDatabase::interrupt(long request) {
+  // The lock prevents the worker from moving on to the next request while interrupting.
+  lock_guard<mutex> lock(m_mutex);
+  sqlite3 *db = m_database.db();
+  if (db && m_running == request)
+    sqlite3_interrupt(db);
+}
+
+void AsyncDatabase::enqueue(const function<void(Database &)> &request) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_queue.push_back(request);
+    m_submitted++;
+  }
+  m_condition.notify_one();
+}
+
+void AsyncDatabase::run(void) {
+  unique_lock<mutex> lock(m_mutex);
+  while (true) {
+    if (m_queue.empty()) {
+      if (m_stop)
+        break;
+      m_condition.wait(lock);
+      continue;
+    };
+    function<void(Database &)> request = m_queue.front();
+    m_queue.pop_front();
+    // Requests are numbered in the order they were submitted.
+    m_running = ++m_started;
+    lock.unlock();
+    request(m_database);
+    lock.lock();
+    m_running = 0;
+  };
+}
@@ -0,0 +1,87 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <type_traits>
+#include "database.hh"
+
+
+// Facade owning a database connection on a dedicated thread.
+// Requests are queued and executed in order. The results are returned as futures.
+class AsyncDatabase
+{
+public:
+  AsyncDatabase(void);
+  virtual ~AsyncDatabase(void);
+  void open(const char *filename, bool read_only=false);
+  // Number of the most recently submitted request.
+  long last_request(void);
+  // Interrupt the given request only if it is currently running.
+  void interrupt(long request);
+  template <typename F>
+  std::future<typename std::invoke_result<F, Database &>::type> submit(F request) {
+    typedef typename std::invoke_result<F, Database &>::type T;
+    std::shared_ptr<std::packaged_task<T(Database &)> > task(new std::packaged_task<T(Database &)>(request));
+    std::future<T> result = task->get_future();
+    enqueue([task](Database &database) { (*task)(database); });
+    return result;
+  }
+  template <typename F>
+  std::future<typename std::invoke_result<F, Database &>::type> transaction(F request) {
+    return submit([request](Database &database) mutable {
+      database.begin();
+      try {
+        if constexpr (std::is_void<typename std::invoke_result<F, Database &>::type>::value) {
+          request(database);
+          database.commit();
+        } else {
+          typename std::invoke_result<F, Database &>::type result = request(database);
+          database.commit();
+          return result;
+        };
+      } catch (std::exception &) {
+        try {
+          database.rollback();
+        } catch (std::exception &) {
+          // Interrupted statements roll back the transaction already.
+        };
+        throw;
+      };
+    });
+  }
+  template <typename F>
+  typename std::invoke_result<F, Database &>::type call(F request) {
+    return submit(request).get();
+  }
+protected:
+  void enqueue(const std::function<void(Database &)> &request);
+  void run(void);
+  Database m_database;
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<std::function<void(Database &)> > m_queue;
+  bool m_stop;
+  long m_submitted;
+  long m_started;
+  long m_running;
+};
@@ -0,0 +1,97 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include "bitmap.hh"
+
+
+using namespace std;
+
+IdBitmap::IdBitmap(void): m_size(0)
+{
+}
+
+IdBitmap::IdBitmap(const vector<sqlite3_int64> &ids): m_size(0)
+{
+  for (vector<sqlite3_int64>::const_iterator id=ids.begin(); id!=ids.end(); id++)
+    add(*id);
+}
+
+void IdBitmap::add(sqlite3_int64 id) {
+  Container &container = m_containers[id >> 16];
+  uint16_t low = id & 0xffff;
+  if (container.bits.empty()) {
+    vector<uint16_t>::iterator position;
+    // Ids are usually added in ascending order.
+    if (container.values.empty() || container.values.back() < low)
+      position = container.values.end();
+    else {
+      position = lower_bound(container.values.begin(), container.values.end(), low);
+      if (*position == low)
+        return;
+    };
+    container.values.insert(position, low);
+    m_size++;
+    if (container.values.size() > BITMAP_SPARSE_LIMIT) {
+      container.bits.resize(65536 / 64);
+      for (vector<uint16_t>::iterator value=container.values.begin(); value!=container.values.end(); value++)
+        container.bits[*value >> 6] |= (uint64_t)1 << (*value & 63);
+      vector<uint16_t>().swap(container.values);
+    };
+  } else {
+    uint64_t mask = (uint64_t)1 << (low & 63);
+    if (!(container.bits[low >> 6] & mask)) {
+      container.bits[low >> 6] |= mask;
+      m_size++;
+    };
+  };
+}
+
+bool IdBitmap::contains(sqlite3_int64 id) const {
+  map<sqlite3_int64, Container>::const_iterator container = m_containers.find(id >> 16);
+  if (container == m_containers.end())
+    return false;
+  uint16_t low = id & 0xffff;
+  if (container->second.bits.empty())
+    return binary_search(container->second.values.begin(), container->second.values.end(), low);
+  return (container->second.bits[low >> 6] >> (low & 63)) & 1;
+}
+
+vector<sqlite3_int64> IdBitmap::ids(void) const {
+  vector<sqlite3_int64> result;
+  result.reserve(m_size);
+  for (map<sqlite3_int64, Container>::const_iterator container=m_containers.begin(); container!=m_containers.end(); container++) {
+    sqlite3_int64 high = container->first << 16;
+    if (container->second.bits.empty()) {
+      for (vector<uint16_t>::const_iterator value=container->second.values.begin(); value!=container->second.values.end(); value++)
+        result.push_back(high | *value);
+    } else {
+      for (int word=0; word<(int)container->second.bits.size(); word++) {
+        uint64_t bits = container->second.bits[word];
+        for (int bit=0; bits; bit++, bits >>= 1)
+          if (bits & 1)
+            result.push_back(high | (word << 6) | bit);
+      };
+    };
+  };
+  return result;
+}
+
+size_t IdBitmap::bytes(void) const {
+  size_t result = 0;
+  for (map<sqlite3_int64, Container>::const_iterator container=m_containers.begin(); container!=m_containers.end(); container++)
+    result += container->second.values.size() * sizeof(uint16_t) + container->second.bits.size() * sizeof(uint64_t);
+  return result;
+}
@@ -0,0 +1,46 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <sqlite3.h>
+
+
+// Maximum number of ids stored as a sorted list in a container before switching to a bitset.
+#define BITMAP_SPARSE_LIMIT 4096
+
+// Compressed set of recipe ids. Ids are grouped by their upper bits into containers of 65536 ids. A container either
+// holds a sorted list of the lower 16 bits or, if it is dense, a bitset.
+class IdBitmap
+{
+public:
+  IdBitmap(void);
+  IdBitmap(const std::vector<sqlite3_int64> &ids);
+  void add(sqlite3_int64 id);
+  bool contains(sqlite3_int64 id) const;
+  int size(void) const { return m_size; }
+  std::vector<sqlite3_int64> ids(void) const;
+  size_t bytes(void) const;
+protected:
+  struct Container
+  {
+    std::vector<uint16_t> values;
+    std::vector<uint64_t> bits;
+  };
+  std::map<sqlite3_int64, Container> m_containers;
+  int m_size;
+};
@@ -0,0 +1,168 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include "blob.hh"
+
+
+using namespace std;
+
+// Flags indicating which parts of an ingredient amount are present.
+#define AMOUNT_INTEGER 1
+#define AMOUNT_FRACTION 2
+#define AMOUNT_FLOAT 4
+
+static void write_varint(string &output, uint64_t value) {
+  while (value >= 0x80) {
+    output += (char)((value & 0x7f) | 0x80);
+    value >>= 7;
+  };
+  output += (char)value;
+}
+
+static void write_string(string &output, const string &text) {
+  write_varint(output, text.size());
+  output += text;
+}
+
+static void write_sections(string &output, vector<pair<int, string> > &sections) {
+  write_varint(output, sections.size());
+  for (vector<pair<int, string> >::iterator section=sections.begin(); section!=sections.end(); section++) {
+    write_varint(output, (uint32_t)section->first);
+    write_string(output, section->second);
+  };
+}
+
+string recipe_body_to_blob(Recipe &recipe) {
+  string result;
+  result += (char)BLOB_VERSION;
+  write_varint(result, recipe.ingredients().size());
+  for (vector<Ingredient>::iterator ingredient=recipe.ingredients().begin(); ingredient!=recipe.ingredients().end(); ingredient++) {
+    int flags = 0;
+    if (ingredient->amount_integer() != 0)
+      flags |= AMOUNT_INTEGER;
+    if (ingredient->amount_numerator() != 0 || ingredient->amount_denominator() != 1)
+      flags |= AMOUNT_FRACTION;
+    if (ingredient->amount_float() != 0.0)
+      flags |= AMOUNT_FLOAT;
+    result += (char)flags;
+    if (flags & AMOUNT_INTEGER)
+      write_varint(result, (uint32_t)ingredient->amount_integer());
+    if (flags & AMOUNT_FRACTION) {
+      write_varint(result, (uint32_t)ingredient->amount_numerator());
+      write_varint(result, (uint32_t)ingredient->amount_denominator());
+    };
+    if (flags & AMOUNT_FLOAT) {
+      double amount = ingredient->amount_float();
+      char buffer[sizeof(double)];
+      memcpy(buffer, &amount, sizeof(double));
+      result.append(buffer, sizeof(double));
+    };
+    result += (char)ingredient->unit_index();
+    write_string(result, ingredient->text());
+  };
+  write_sections(result, recipe.ingredient_sections());
+  write_varint(result, recipe.instructions().size());
+  for (vector<string>::iterator instruction=recipe.instructions().begin(); instruction!=recipe.instructions().end(); instruction++)
+    write_string(result, *instruction);
+  write_sections(result, recipe.instruction_sections());
+  return result;
+}
+
+// Sequential reader checking the bounds of the blob.
+class BlobReader
+{
+public:
+  BlobReader(const char *data, int size): m_pointer(data), m_end(data + size) {}
+  int byte(void) {
+    if (m_pointer >= m_end)
+      throw blob_exception("Unexpected end of recipe blob.");
+    return (unsigned char)*m_pointer++;
+  }
+  uint64_t varint(void) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (true) {
+      int c = byte();
+      if (shift > 63)
+        throw blob_exception("Integer in recipe blob is too long.");
+      value |= (uint64_t)(c & 0x7f) << shift;
+      if (!(c & 0x80))
+        break;
+      shift += 7;
+    };
+    return value;
+  }
+  string text(void) {
+    uint64_t size = varint();
+    if (size > (uint64_t)(m_end - m_pointer))
+      throw blob_exception("String in recipe blob exceeds its size.");
+    string result(m_pointer, size);
+    m_pointer += size;
+    return result;
+  }
+  double real(void) {
+    if (m_end - m_pointer < (int)sizeof(double))
+      throw blob_exception("Unexpected end of recipe blob.");
+    double value;
+    memcpy(&value, m_pointer, sizeof(double));
+    m_pointer += sizeof(double);
+    return value;
+  }
+protected:
+  const char *m_pointer;
+  const char *m_end;
+};
+
+void blob_to_recipe_body(const char *data, int size, Recipe &recipe) {
+  BlobReader reader(data, size);
+  int version = reader.byte();
+  if (version < 1 || version > BLOB_VERSION)
+    throw blob_exception("Recipe blob was created by more recent release of software.");
+  uint64_t n = reader.varint();
+  for (uint64_t i=0; i<n; i++) {
+    Ingredient ingredient;
+    int flags = reader.byte();
+    if (flags & AMOUNT_INTEGER)
+      ingredient.set_amount_integer((uint32_t)reader.varint());
+    if (flags & AMOUNT_FRACTION) {
+      ingredient.set_amount_numerator((uint32_t)reader.varint());
+      ingredient.set_amount_denominator((uint32_t)reader.varint());
+    };
+    if (flags & AMOUNT_FLOAT)
+      ingredient.set_amount_float(reader.real());
+    if (version == 1)
+      ingredient.set_unit(reader.text().c_str());
+    else
+      ingredient.set_unit((Unit)min(reader.byte(), (int)UNIT_NONE));
+    ingredient.set_text(reader.text().c_str());
+    recipe.add_ingredient(ingredient);
+  };
+  n = reader.varint();
+  for (uint64_t i=0; i<n; i++) {
+    int line = (uint32_t)reader.varint();
+    recipe.add_ingredient_section(line, reader.text().c_str());
+  };
+  n = reader.varint();
+  for (uint64_t i=0; i<n; i++)
+    recipe.add_instruction(reader.text().c_str());
+  n = reader.varint();
+  for (uint64_t i=0; i<n; i++) {
+    int line = (uint32_t)reader.varint();
+    recipe.add_instruction_section(line, reader.text().c_str());
+  };
+}
@@ -0,0 +1,37 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <string>
+#include "recipe.hh"
+
+
+// Version 1 stored ingredient units as MealMaster codes instead of a single byte.
+#define BLOB_VERSION 2
+
+class blob_exception: public std::exception
+{
+public:
+  blob_exception(const std::string &error): m_error(error) {}
+  virtual ~blob_exception(void) throw() {}
+  virtual const char *what(void) const throw() { return m_error.c_str(); }
+protected:
+  std::string m_error;
+};
+
+// Encode ingredients, instructions, and sections of a recipe as a compact binary string.
+std::string recipe_body_to_blob(Recipe &recipe);
+// Decode ingredients, instructions, and sections and add them to the recipe.
+void blob_to_recipe_body(const char *data, int size, Recipe &recipe);
@@ -16,13 +16,14 @@
 #include "categories_model.hh"
 
 
-CategoriesModel::CategoriesModel(QObject *parent, Database *database): QAbstractListModel(parent), m_database(database) {
-  m_categories = m_database->categories();
+CategoriesModel::CategoriesModel(QObject *parent, StringPool *pool): QAbstractListModel(parent), m_pool(pool) {
 }
 
-void CategoriesModel::reset(void) {
+void CategoriesModel::reset(const std::vector<std::string> &categories) {
   beginResetModel();
-  m_categories = m_database->categories();
+  m_categories.clear();
+  for (std::vector<std::string>::const_iterator category=categories.begin(); category!=categories.end(); category++)
+    m_categories.push_back(m_pool->intern(*category));
   endResetModel();
 }
 
@@ -34,7 +35,7 @@ QVariant CategoriesModel::data(const QModelIndex &index, int role) const {
   QVariant result;
   if (role == Qt::DisplayRole || role == Qt::EditRole) {
     int row = index.row();
-    result = QString(m_categories[row].c_str());
+    result = QString::fromUtf8(m_categories[row].data(), m_categories[row].size());
   };
   return result;
 }
@@ -16,20 +16,22 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
 #include <QtCore/QAbstractListModel>
-#include "database.hh"
+#include "string_pool.hh"
 
 
+// List of category names. The names are interned in a pool which can be shared with other models.
 class CategoriesModel: public QAbstractListModel
 {
   Q_OBJECT
 public:
-  CategoriesModel(QObject *parent, Database *database);
-  void reset(void);
+  CategoriesModel(QObject *parent, StringPool *pool);
+  void reset(const std::vector<std::string> &categories);
   virtual int rowCount(const QModelIndex &parent=QModelIndex()) const;
   virtual QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
-  std::vector<std::string> categories(void) { return m_categories; };
+  std::vector<std::string> categories(void) { return std::vector<std::string>(m_categories.begin(), m_categories.end()); };
 protected:
-  Database *m_database;
-  std::vector<std::string> m_categories;
+  StringPool *m_pool;
+  std::vector<std::string_view> m_categories;
 };
@@ -17,14 +17,19 @@
 
 using namespace std;
 
-CategoryTableModel::CategoryTableModel(QObject *parent, Database *database):
-  QAbstractTableModel(parent), m_database(database)
+CategoryTableModel::CategoryTableModel(QObject *parent, AsyncDatabase *database, StringPool *pool):
+  QAbstractTableModel(parent), m_database(database), m_pool(pool)
 {
 }
 
 void CategoryTableModel::reset(const set<string> &selection) {
   beginResetModel();
-  m_categories_and_counts = m_database->categories_and_counts();
+  vector<pair<string, int> > categories_and_counts = m_database->call([](Database &database) {
+    return database.categories_and_counts();
+  });
+  m_categories_and_counts.clear();
+  for (vector<pair<string, int> >::iterator category=categories_and_counts.begin(); category!=categories_and_counts.end(); category++)
+    m_categories_and_counts.push_back(make_pair(m_pool->intern(category->first), category->second));
   m_selection = selection;
   endResetModel();
 }
@@ -60,14 +65,14 @@ QVariant CategoryTableModel::data(const QModelIndex &index, int role) const {
   if (role == Qt::DisplayRole || role == Qt::EditRole) {
     switch (column) {
       case 0:
-        result = QString(m_categories_and_counts[row].first.c_str());
+        result = QString::fromUtf8(m_categories_and_counts[row].first.data(), m_categories_and_counts[row].first.size());
         break;
       case 1:
         result = m_categories_and_counts[row].second;
         break;
     };
   } else if (role == Qt::CheckStateRole && column == 0) {
-    string category = m_categories_and_counts[row].first;
+    string category(m_categories_and_counts[row].first);
     result = m_selection.find(category) != m_selection.end() ? Qt::Checked : Qt::Unchecked;
   };
   return result;
@@ -75,7 +80,7 @@ QVariant CategoryTableModel::data(const QModelIndex &index, int role) const {
 
 bool CategoryTableModel::setData(const QModelIndex &index, const QVariant &value, int role) {
   if (role == Qt::CheckStateRole && index.column() == 0) {
-    string category = m_categories_and_counts[index.row()].first;
+    string category(m_categories_and_counts[index.row()].first);
     if (value == Qt::Checked)
       m_selection.insert(category);
     else
@@ -95,29 +100,31 @@ Qt::ItemFlags CategoryTableModel::flags(const QModelIndex &index) const {
 QModelIndex CategoryTableModel::add_category(const string &name) {
   int row = m_categories_and_counts.size();
   beginInsertRows(QModelIndex(), row, row);
-  m_categories_and_counts.push_back(make_pair(name, 0));
-  m_database->add_category(name.c_str());
+  m_categories_and_counts.push_back(make_pair(m_pool->intern(name), 0));
+  m_database->call([name](Database &database) { database.add_category(name.c_str()); });
   endInsertRows();
   return createIndex(row, 0);
 }
 
 void CategoryTableModel::delete_category(int row) {
   beginRemoveRows(QModelIndex(), row, row);
-  string category = m_categories_and_counts[row].first;
+  string category(m_categories_and_counts[row].first);
   m_categories_and_counts.erase(m_categories_and_counts.begin() + row);
   set<string>::iterator i = m_selection.find(category);
   if (i!=m_selection.end()) {
     m_selection.erase(i);
   };
-  m_database->delete_category(category.c_str());
+  m_database->call([category](Database &database) { database.delete_category(category.c_str()); });
   endRemoveRows();
 }
 
 void CategoryTableModel::rename_category(int row, const string &name) {
   QModelIndex index = createIndex(row, 0);
-  string current_name = m_categories_and_counts[row].first;
-  m_categories_and_counts[row].first = name;
-  m_database->rename_category(current_name.c_str(), name.c_str());
+  string current_name(m_categories_and_counts[row].first);
+  m_categories_and_counts[row].first = m_pool->intern(name);
+  m_database->call([current_name, name](Database &database) {
+    database.rename_category(current_name.c_str(), name.c_str());
+  });
   set<string>::iterator i = m_selection.find(current_name);
   if (i!=m_selection.end()) {
     m_selection.erase(i);
@@ -127,8 +134,10 @@ void CategoryTableModel::rename_category(int row, const string &name) {
 
 void CategoryTableModel::merge_category(int row, const std::string &name) {
   beginRemoveRows(QModelIndex(), row, row);
-  string current_name = m_categories_and_counts[row].first;
-  m_database->merge_category(current_name.c_str(), name.c_str());
+  string current_name(m_categories_and_counts[row].first);
+  m_database->call([current_name, name](Database &database) {
+    database.merge_category(current_name.c_str(), name.c_str());
+  });
   m_categories_and_counts.erase(m_categories_and_counts.begin() + row);
   set<string>::iterator i = m_selection.find(current_name);
   if (i!=m_selection.end()) {
@@ -138,10 +147,16 @@ void CategoryTableModel::merge_category(int row, const std::string &name) {
   endRemoveRows();
   for (unsigned int i=0; i<m_categories_and_counts.size(); i++) {
     if (m_categories_and_counts[i].first == name) {
-      m_categories_and_counts[i].second = m_database->count_recipes(name.c_str());
+      m_categories_and_counts[i].second = m_database->call([name](Database &database) {
+        return database.count_recipes(name.c_str());
+      });
       QModelIndex index = createIndex(i, 0);
       emit dataChanged(index, index.siblingAtColumn(1));
       break;
     };
   };
 }
+
+sqlite3_int64 CategoryTableModel::get_category_id(const string &name) {
+  return m_database->call([name](Database &database) { return database.get_category_id(name.c_str()); });
+}
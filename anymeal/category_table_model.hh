@@ -17,15 +17,17 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <string_view>
 #include <QtCore/QAbstractTableModel>
-#include "database.hh"
+#include "async_database.hh"
+#include "string_pool.hh"
 
 
 class CategoryTableModel: public QAbstractTableModel
 {
   Q_OBJECT
 public:
-  CategoryTableModel(QObject *parent, Database *database);
+  CategoryTableModel(QObject *parent, AsyncDatabase *database, StringPool *pool);
   int rowCount(const QModelIndex &parent=QModelIndex()) const;
   int columnCount(const QModelIndex &parent=QModelIndex()) const;
   QVariant headerData(int section, Qt::Orientation orientation, int role) const;
@@ -34,14 +36,15 @@ public:
   Qt::ItemFlags flags(const QModelIndex &index) const;
   void reset(const std::set<std::string> &selection);
   std::set<std::string> selection(void) { return m_selection; };
-  std::string category(int row) { return m_categories_and_counts[row].first; }
+  std::string category(int row) { return std::string(m_categories_and_counts[row].first); }
   QModelIndex add_category(const std::string &name);
   void delete_category(int row);
   void rename_category(int row, const std::string &name);
   void merge_category(int row, const std::string &name);
-  sqlite3_int64 get_category_id(const char *name) { return m_database->get_category_id(name); }
+  sqlite3_int64 get_category_id(const std::string &name);
 protected:
-  Database *m_database;
+  AsyncDatabase *m_database;
+  StringPool *m_pool;
   std::set<std::string> m_selection;
-  std::vector<std::pair<std::string, int> > m_categories_and_counts;
+  std::vector<std::pair<std::string_view, int> > m_categories_and_counts;
 };
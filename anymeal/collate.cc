@@ -0,0 +1,114 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cstring>
+#include "collate.hh"
+
+
+using namespace std;
+
+// Letters are mapped to even weights above the ASCII range. Other ASCII characters keep their code and sort first.
+#define LETTER_WEIGHT(c) (0x80 + 2 * ((c) - 'a'))
+
+struct LatinRange {
+  int first;
+  int last;
+  const char *base;
+};
+
+// Letters of the Latin-1 supplement and Latin extended-A blocks which sort like plain letters.
+static const LatinRange latin_letters[] = {
+  {0xc0, 0xc5, "a"}, {0xc6, 0xc6, "ae"}, {0xc7, 0xc7, "c"}, {0xc8, 0xcb, "e"}, {0xcc, 0xcf, "i"}, {0xd0, 0xd0, "d"},
+  {0xd1, 0xd1, "n"}, {0xd2, 0xd6, "o"}, {0xd8, 0xd8, "o"}, {0xd9, 0xdc, "u"}, {0xdd, 0xdd, "y"}, {0xde, 0xde, "th"},
+  {0xdf, 0xdf, "ss"}, {0xe0, 0xe5, "a"}, {0xe6, 0xe6, "ae"}, {0xe7, 0xe7, "c"}, {0xe8, 0xeb, "e"}, {0xec, 0xef, "i"},
+  {0xf0, 0xf0, "d"}, {0xf1, 0xf1, "n"}, {0xf2, 0xf6, "o"}, {0xf8, 0xf8, "o"}, {0xf9, 0xfc, "u"}, {0xfd, 0xfd, "y"},
+  {0xfe, 0xfe, "th"}, {0xff, 0xff, "y"}, {0x100, 0x105, "a"}, {0x106, 0x10d, "c"}, {0x10e, 0x111, "d"},
+  {0x112, 0x11b, "e"}, {0x11c, 0x123, "g"}, {0x124, 0x127, "h"}, {0x128, 0x131, "i"}, {0x132, 0x133, "ij"},
+  {0x134, 0x135, "j"}, {0x136, 0x138, "k"}, {0x139, 0x142, "l"}, {0x143, 0x14b, "n"}, {0x14c, 0x151, "o"},
+  {0x152, 0x153, "oe"}, {0x154, 0x159, "r"}, {0x15a, 0x161, "s"}, {0x162, 0x167, "t"}, {0x168, 0x173, "u"},
+  {0x174, 0x175, "w"}, {0x176, 0x178, "y"}, {0x179, 0x17e, "z"}, {0x17f, 0x17f, "s"}
+};
+
+// Decode a UTF-8 character and advance the pointer. Returns -1 for an invalid byte.
+static int decode(const unsigned char *&p) {
+  int c = *p++;
+  int extra;
+  if (c < 0x80)
+    return c;
+  else if ((c & 0xe0) == 0xc0) {
+    c &= 0x1f;
+    extra = 1;
+  } else if ((c & 0xf0) == 0xe0) {
+    c &= 0x0f;
+    extra = 2;
+  } else if ((c & 0xf8) == 0xf0) {
+    c &= 0x07;
+    extra = 3;
+  } else
+    return -1;
+  const unsigned char *start = p;
+  for (int i=0; i<extra; i++) {
+    if ((*p & 0xc0) != 0x80) {
+      p = start;
+      return -1;
+    };
+    c = (c << 6) | (*p++ & 0x3f);
+  };
+  return c;
+}
+
+static void append_letters(string &result, const char *base) {
+  while (*base)
+    result += (char)LETTER_WEIGHT(*base++);
+}
+
+string sort_key(const char *text, const char *language) {
+  // Slovenian sorts c, s, z with caron as separate letters after the plain ones.
+  bool slovenian = strcmp(language, "sl") == 0;
+  string result;
+  const unsigned char *p = (const unsigned char *)text;
+  while (*p) {
+    const unsigned char *start = p;
+    int c = decode(p);
+    if (c >= 'a' && c <= 'z')
+      result += (char)LETTER_WEIGHT(c);
+    else if (c >= 'A' && c <= 'Z')
+      result += (char)LETTER_WEIGHT(c - 'A' + 'a');
+    else if (c >= 0 && c < 0x80)
+      result += (char)c;
+    else if (slovenian && (c == 0x10c || c == 0x10d))
+      result += (char)(LETTER_WEIGHT('c') + 1);
+    else if (slovenian && (c == 0x160 || c == 0x161))
+      result += (char)(LETTER_WEIGHT('s') + 1);
+    else if (slovenian && (c == 0x17d || c == 0x17e))
+      result += (char)(LETTER_WEIGHT('z') + 1);
+    else {
+      const char *base = NULL;
+      for (unsigned int i=0; i<sizeof(latin_letters) / sizeof(LatinRange); i++)
+        if (c >= latin_letters[i].first && c <= latin_letters[i].last) {
+          base = latin_letters[i].base;
+          break;
+        };
+      if (base)
+        append_letters(result, base);
+      else
+        // Other characters sort after all letters in code point order.
+        result.append((const char *)start, p - start);
+    };
+  };
+  result += '\0';
+  result += text;
+  return result;
+}
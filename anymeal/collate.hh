@@ -0,0 +1,23 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <string>
+
+
+// Binary sort key of a recipe title for the given user interface language.
+// Comparing keys with memcmp sorts letters with and without diacritics together and ignores case.
+// The original text is appended after a zero byte so that the order of titles with equal letters is defined.
+std::string sort_key(const char *text, const char *language);
@@ -0,0 +1,138 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include "compress.hh"
+
+
+using namespace std;
+
+// Phrases are looked up using their first characters.
+#define PREFIX_LENGTH 3
+// Longest word sequence considered when training the dictionary.
+#define MAX_WORDS 6
+
+void TextDictionary::set_phrases(int generation, const vector<string> &phrases) {
+  if (phrases.size() > DICTIONARY_SIZE)
+    throw compress_exception("Dictionary has too many phrases.");
+  m_generation = generation;
+  m_phrases = phrases;
+  index();
+}
+
+void TextDictionary::index(void) {
+  m_prefixes.clear();
+  for (unsigned int i=0; i<m_phrases.size(); i++)
+    m_prefixes[m_phrases[i].substr(0, PREFIX_LENGTH)].push_back(i);
+  // Try longest phrases first.
+  for (unordered_map<string, vector<int> >::iterator entry=m_prefixes.begin(); entry!=m_prefixes.end(); entry++)
+    sort(entry->second.begin(), entry->second.end(),
+         [this](int a, int b) { return m_phrases[a].size() > m_phrases[b].size(); });
+}
+
+static bool higher_saving(const pair<string, long> &a, const pair<string, long> &b) {
+  if (a.second != b.second)
+    return a.second > b.second;
+  return a.first < b.first;
+}
+
+void TextDictionary::train(const vector<string> &samples, int size) {
+  // Count word sequences including the trailing space.
+  unordered_map<string, long> counts;
+  for (vector<string>::const_iterator sample=samples.begin(); sample!=samples.end(); sample++) {
+    const string &text = *sample;
+    size_t start = 0;
+    while (start < text.size()) {
+      size_t end = start;
+      for (int words=0; words<MAX_WORDS && end<text.size(); words++) {
+        end = text.find(' ', end);
+        end = end == string::npos ? text.size() : end + 1;
+        if (end - start > PREFIX_LENGTH)
+          counts[text.substr(start, end - start)]++;
+      };
+      start = text.find(' ', start);
+      start = start == string::npos ? text.size() : start + 1;
+    };
+  };
+  // Rank phrases by the number of bytes saved.
+  vector<pair<string, long> > candidates;
+  for (unordered_map<string, long>::iterator entry=counts.begin(); entry!=counts.end(); entry++)
+    if (entry->second > 1)
+      candidates.push_back(make_pair(entry->first, entry->second * (long)(entry->first.size() - 2)));
+  sort(candidates.begin(), candidates.end(), higher_saving);
+  vector<string> phrases;
+  for (unsigned int i=0; i<candidates.size() && (int)phrases.size()<size; i++)
+    phrases.push_back(candidates[i].first);
+  set_phrases(m_generation % 255 + 1, phrases);
+}
+
+string TextDictionary::compress(const string &text) {
+  string result;
+  result += (char)m_generation;
+  size_t i = 0;
+  while (i < text.size()) {
+    int code = -1;
+    unordered_map<string, vector<int> >::iterator entry = m_prefixes.find(text.substr(i, PREFIX_LENGTH));
+    if (entry != m_prefixes.end()) {
+      for (vector<int>::iterator phrase=entry->second.begin(); phrase!=entry->second.end(); phrase++)
+        if (text.compare(i, m_phrases[*phrase].size(), m_phrases[*phrase]) == 0) {
+          code = *phrase;
+          break;
+        };
+    };
+    if (code >= 0) {
+      result += (char)(DICTIONARY_LEAD + (code >> 8));
+      result += (char)(code & 0xff);
+      i += m_phrases[code].size();
+    } else {
+      unsigned char c = text[i];
+      if (c >= DICTIONARY_LEAD) {
+        result += (char)DICTIONARY_ESCAPE;
+        result += (char)DICTIONARY_ESCAPE;
+      };
+      result += (char)c;
+      i++;
+    };
+  };
+  return result;
+}
+
+string TextDictionary::decompress(const char *data, int size) {
+  if (size < 1)
+    throw compress_exception("Compressed text is empty.");
+  if ((unsigned char)data[0] != m_generation)
+    throw compress_exception("Text was compressed using a different dictionary.");
+  string result;
+  int i = 1;
+  while (i < size) {
+    unsigned char c = data[i++];
+    if (c < DICTIONARY_LEAD) {
+      result += (char)c;
+      continue;
+    };
+    if (i >= size)
+      throw compress_exception("Unexpected end of compressed text.");
+    int code = ((c - DICTIONARY_LEAD) << 8) | (unsigned char)data[i++];
+    if (code == (DICTIONARY_SIZE)) {
+      if (i >= size)
+        throw compress_exception("Unexpected end of compressed text.");
+      result += data[i++];
+    } else if (code < (int)m_phrases.size())
+      result += m_phrases[code];
+    else
+      throw compress_exception("Invalid phrase in compressed text.");
+  };
+  return result;
+}
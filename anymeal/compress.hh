@@ -0,0 +1,55 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Phrases are encoded as two bytes with a lead byte which does not occur in UTF-8 text.
+#define DICTIONARY_LEAD 0xf8
+#define DICTIONARY_SIZE 2047
+#define DICTIONARY_ESCAPE 0xff
+
+class compress_exception: public std::exception
+{
+public:
+  compress_exception(const std::string &error): m_error(error) {}
+  virtual ~compress_exception(void) throw() {}
+  virtual const char *what(void) const throw() { return m_error.c_str(); }
+protected:
+  std::string m_error;
+};
+
+// Dictionary of frequent phrases for compressing instruction text.
+// Compressed text starts with the generation of the dictionary used to encode it.
+class TextDictionary
+{
+public:
+  TextDictionary(void): m_generation(0) {}
+  int generation(void) { return m_generation; }
+  std::vector<std::string> &phrases(void) { return m_phrases; }
+  bool empty(void) { return m_phrases.empty(); }
+  void set_phrases(int generation, const std::vector<std::string> &phrases);
+  void train(const std::vector<std::string> &samples, int size=DICTIONARY_SIZE);
+  std::string compress(const std::string &text);
+  std::string decompress(const char *data, int size);
+protected:
+  void index(void);
+  int m_generation;
+  std::vector<std::string> m_phrases;
+  std::unordered_map<std::string, std::vector<int> > m_prefixes;
+};
@@ -29,7 +29,7 @@ ConverterWindow::ConverterWindow(QWidget *parent):
   connect(m_ui.dest_unit_combo, SIGNAL(currentIndexChanged(int)), this, SLOT(update_value()));
   connect(m_ui.preset_combo, SIGNAL(currentIndexChanged(int)), this, SLOT(change_ingredient(int)));
   for (int i=0; i<UNITS; i++) {
-    string unit = html_unit(unit_from_index(i), &translate);
+    string unit = html_unit(i, &translate);
     m_ui.source_unit_combo->addItem(unit.c_str());
     m_ui.dest_unit_combo->addItem(unit.c_str());
   };
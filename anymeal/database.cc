@@ -13,25 +13,46 @@
 
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
 #include <sstream>
+#include <tuple>
+#include "blob.hh"
+#include "collate.hh"
 #include "database.hh"
 
 
+// Relevance of matches in title, ingredients, and instructions.
+#define SEARCH_WEIGHTS "10.0, 3.0, 1.0"
+
 using namespace std;
 
+// Number of database pages copied per step of a backup or restore.
+#define BACKUP_PAGES 256
+
 Database::Database(void):
-  m_db(NULL), m_begin(NULL), m_commit(NULL), m_rollback(NULL), m_insert_recipe(NULL),
+  m_db(NULL), m_compact_storage(false), m_reindex(false), m_refingerprint(false), m_retokenize(false), m_profiling(false), m_all_selected(true), m_language("en"), m_begin(NULL), m_commit(NULL), m_rollback(NULL), m_insert_recipe(NULL),
   m_add_category(NULL), m_recipe_category(NULL), m_add_ingredient(NULL), m_recipe_ingredient(NULL),
   m_get_header(NULL), m_get_categories(NULL), m_category_and_count_list(NULL), m_get_ingredients(NULL),
-  m_add_instruction(NULL), m_get_instructions(NULL), m_add_ingredient_section(NULL), m_get_ingredient_section(NULL),
-  m_add_instruction_section(NULL), m_get_instruction_section(NULL), m_count_selected(NULL), m_get_info(NULL),
+  m_index_ingredient(NULL), m_add_body(NULL), m_add_instruction(NULL), m_get_instructions(NULL), m_get_dictionary(NULL),
+  m_add_phrase(NULL), m_update_instruction(NULL), m_add_token(NULL), m_match_token(NULL), m_pantry_coverage(NULL),
+  m_select_staged(NULL), m_add_staged_to_selection(NULL), m_selected_ids(NULL), m_get_title(NULL),
+  m_index_recipe(NULL), m_select_text(NULL), m_ranked_titles(NULL), m_add_ingredient_section(NULL), m_get_ingredient_section(NULL),
+  m_add_instruction_section(NULL), m_get_instruction_section(NULL), m_count_all(NULL), m_get_all_info(NULL),
+  m_all_category_list(NULL), m_count_selected(NULL), m_get_info(NULL), m_get_all_page(NULL), m_get_page(NULL),
   m_select_title(NULL), m_category_list(NULL), m_select_category(NULL), m_select_no_category(NULL),
-  m_select_ingredient(NULL), m_select_no_ingredient(NULL), m_delete_recipe(NULL), m_delete_categories(NULL),
-  m_delete_ingredients(NULL), m_delete_instructions(NULL), m_delete_ingredient_sections(NULL),
-  m_delete_instruction_sections(NULL), m_delete_selection(NULL), m_clean_categories(NULL), m_clean_ingredients(NULL),
-  m_select_recipe(NULL), m_remove_recipe_category(NULL), m_rename_category(NULL), m_get_category_id(NULL),
-  m_merge_category(NULL), m_delete_category(NULL), m_delete_recipe_category(NULL), m_count_recipes_in_category(NULL)
+  m_select_ingredient(NULL), m_select_no_ingredient(NULL), m_stage_id(NULL), m_clear_ids(NULL),
+  m_delete_staged_recipes(NULL), m_unselect_staged(NULL), m_clean_categories(NULL), m_clean_ingredients(NULL),
+  m_select_recipe(NULL), m_add_staged_to_category(NULL), m_remove_staged_from_category(NULL), m_rename_category(NULL),
+  m_get_category_id(NULL), m_merge_category(NULL), m_delete_category(NULL), m_delete_recipe_category(NULL), m_count_recipes_in_category(NULL)
 {
 }
 
@@ -48,31 +69,50 @@ Database::~Database(void) {
   sqlite3_finalize(m_get_categories);
   sqlite3_finalize(m_category_and_count_list);
   sqlite3_finalize(m_get_ingredients);
+  sqlite3_finalize(m_index_ingredient);
+  sqlite3_finalize(m_add_body);
   sqlite3_finalize(m_add_instruction);
   sqlite3_finalize(m_get_instructions);
+  sqlite3_finalize(m_get_dictionary);
+  sqlite3_finalize(m_add_phrase);
+  sqlite3_finalize(m_update_instruction);
+  sqlite3_finalize(m_add_token);
+  sqlite3_finalize(m_match_token);
+  sqlite3_finalize(m_pantry_coverage);
+  sqlite3_finalize(m_select_staged);
+  sqlite3_finalize(m_add_staged_to_selection);
+  sqlite3_finalize(m_selected_ids);
+  sqlite3_finalize(m_get_title);
+  sqlite3_finalize(m_index_recipe);
+  sqlite3_finalize(m_select_text);
+  sqlite3_finalize(m_ranked_titles);
   sqlite3_finalize(m_add_ingredient_section);
   sqlite3_finalize(m_get_ingredient_section);
   sqlite3_finalize(m_add_instruction_section);
   sqlite3_finalize(m_get_instruction_section);
+  sqlite3_finalize(m_count_all);
+  sqlite3_finalize(m_get_all_info);
+  sqlite3_finalize(m_all_category_list);
   sqlite3_finalize(m_count_selected);
+  sqlite3_finalize(m_get_info);
+  sqlite3_finalize(m_get_all_page);
+  sqlite3_finalize(m_get_page);
   sqlite3_finalize(m_select_title);
   sqlite3_finalize(m_category_list);
   sqlite3_finalize(m_select_category);
   sqlite3_finalize(m_select_no_category);
   sqlite3_finalize(m_select_ingredient);
   sqlite3_finalize(m_select_no_ingredient);
-  sqlite3_finalize(m_delete_recipe);
-  sqlite3_finalize(m_delete_categories);
-  sqlite3_finalize(m_delete_ingredients);
-  sqlite3_finalize(m_delete_instructions);
-  sqlite3_finalize(m_delete_ingredient_sections);
-  sqlite3_finalize(m_delete_instruction_sections);
-  sqlite3_finalize(m_delete_selection);
+  sqlite3_finalize(m_stage_id);
+  sqlite3_finalize(m_clear_ids);
+  sqlite3_finalize(m_delete_staged_recipes);
+  sqlite3_finalize(m_unselect_staged);
   sqlite3_finalize(m_rename_category);
   sqlite3_finalize(m_clean_categories);
   sqlite3_finalize(m_clean_ingredients);
   sqlite3_finalize(m_select_recipe);
-  sqlite3_finalize(m_remove_recipe_category);
+  sqlite3_finalize(m_add_staged_to_category);
+  sqlite3_finalize(m_remove_staged_from_category);
   sqlite3_finalize(m_get_category_id);
   sqlite3_finalize(m_merge_category);
   sqlite3_finalize(m_delete_category);
@@ -81,6 +121,19 @@ Database::~Database(void) {
   sqlite3_close(m_db);
 }
 
+void Database::close(void) {
+  // All statements are defined when opening the database, so they can be finalized using the definitions.
+  for (map<sqlite3_stmt **, pair<const char *, const char *> >::iterator definition=m_definitions.begin();
+       definition!=m_definitions.end(); definition++) {
+    sqlite3_finalize(*definition->first);
+    *definition->first = NULL;
+  };
+  m_cookbooks.clear();
+  sqlite3_close(m_db);
+  m_db = NULL;
+  m_all_selected = true;
+}
+
 void Database::check(int result, const char *prefix) {
   if (result != SQLITE_OK && result != SQLITE_DONE && result != SQLITE_ROW) {
     ostringstream s;
@@ -89,130 +142,208 @@ void Database::check(int result, const char *prefix) {
   };
 }
 
-void Database::open(const char *filename) {
+void Database::define(sqlite3_stmt **statement, const char *sql, const char *error) {
+  m_definitions[statement] = make_pair(sql, error);
+}
+
+void Database::prepare(sqlite3_stmt *&statement) {
+  // Statements are prepared on first use so that opening the database is fast.
+  if (statement)
+    return;
+  map<sqlite3_stmt **, pair<const char *, const char *> >::iterator definition = m_definitions.find(&statement);
+  assert(definition != m_definitions.end());
+  int result = sqlite3_prepare_v2(m_db, definition->second.first, -1, &statement, NULL);
+  check(result, definition->second.second);
+}
+
+// SQL function returning instruction text which might be compressed.
+static void anymeal_text(sqlite3_context *context, int, sqlite3_value **argv) {
+  if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+    sqlite3_result_value(context, argv[0]);
+    return;
+  };
+  Database *database = (Database *)sqlite3_user_data(context);
+  try {
+    string text = database->decompress((const char *)sqlite3_value_blob(argv[0]), sqlite3_value_bytes(argv[0]));
+    sqlite3_result_text(context, text.data(), text.size(), SQLITE_TRANSIENT);
+  } catch (exception &e) {
+    sqlite3_result_error(context, e.what(), -1);
+  };
+}
+
+// SQL function returning the sort key of a recipe title for the current language.
+static void anymeal_sortkey(sqlite3_context *context, int, sqlite3_value **argv) {
+  Database *database = (Database *)sqlite3_user_data(context);
+  string key = sort_key((const char *)sqlite3_value_text(argv[0]), database->language().c_str());
+  sqlite3_result_blob(context, key.data(), key.size(), SQLITE_TRANSIENT);
+}
+
+// SQL function converting a MealMaster unit code to the number of the unit.
+static void anymeal_unit(sqlite3_context *context, int, sqlite3_value **argv) {
+  sqlite3_result_int(context, unit_from_code((const char *)sqlite3_value_text(argv[0])));
+}
+
+// Callback collecting execution statistics of SQL statements.
+static int anymeal_trace(unsigned int type, void *context, void *statement, void *data) {
+  ((Database *)context)->trace(type, statement, data);
+  return 0;
+}
+
+void Database::open(const char *filename, bool read_only) {
   int result;
-  result = sqlite3_open(filename, &m_db);
+  // URI file names are enabled so that cookbooks can be attached read-only.
+  if (read_only)
+    result = sqlite3_open_v2(filename, &m_db, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, NULL);
+  else
+    result = sqlite3_open_v2(filename, &m_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, NULL);
   check(result, "Error opening database: ");
   pragmas();
-  migrate();
-  select_all();
-  result = sqlite3_prepare_v2(m_db, "BEGIN;", -1, &m_begin, NULL);
-  check(result, "Error preparing begin transaction statement: ");
-  result = sqlite3_prepare_v2(m_db, "COMMIT;", -1, &m_commit, NULL);
-  check(result, "Error preparing commit transaction statement: ");
-  result = sqlite3_prepare_v2(m_db, "ROLLBACK;", -1, &m_rollback, NULL);
-  check(result, "Error preparing rollback transaction statement: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT INTO recipes VALUES(NULL, ?001, ?002, ?003);", -1, &m_insert_recipe, NULL);
-  check(result, "Error preparing insert statement for recipes: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT OR IGNORE INTO categories VALUES(NULL, ?001);", -1, &m_add_category, NULL);
-  check(result, "Error preparing statement for adding category: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT OR IGNORE INTO category SELECT ?001, id FROM categories WHERE categories.name = ?002;",
-                              -1, &m_recipe_category, NULL);
-  check(result, "Error preparing statement for assigning recipe category: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT OR IGNORE into ingredients VALUES(NULL, ?001);", -1, &m_add_ingredient, NULL);
-  check(result, "Error preparing statement for adding ingredient: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT INTO ingredient SELECT ?001, ?002, ?003, ?004, ?005, ?006, ?007, ingredients.id "
-                                    "FROM ingredients WHERE ingredients.name = ?008;", -1, &m_recipe_ingredient, NULL);
-  check(result, "Error preparing statement for adding ingredient to recipe: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT title, servings, servingsunit FROM recipes WHERE id = ?001;", -1, &m_get_header,
-                              NULL);
-  check(result, "Error preparing statement for fetching recipe header: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT name FROM categories, category WHERE recipeid = ?001 AND id = categoryid ORDER BY name;",
-                              -1, &m_get_categories, NULL);
-  check(result, "Error preparing statement for fetching recipe categories: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT name, COUNT(recipeid) FROM categories LEFT JOIN category ON id = categoryid "
-                              "GROUP BY name ORDER BY name;",
-                              -1, &m_category_and_count_list, NULL);
-  check(result, "Error preparing statement for fetching recipe categories and recipe counts: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT amountint, amountnum, amountdenom, amountfloat, unit, name "
-                              "FROM ingredient, ingredients WHERE recipeid = ?001 AND ingredientid = ingredients.id ORDER BY line;",
-                              -1, &m_get_ingredients, NULL);
-  check(result, "Error preparing statement for fetching recipe ingredients: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT INTO instruction VALUES(?001, ?002, ?003);", -1, &m_add_instruction, NULL);
-  check(result, "Error preparing statement for adding instruction to recipe: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT txt FROM instruction WHERE recipeid = ?001 ORDER BY line;", -1, &m_get_instructions,
-                              NULL);
-  check(result, "Error preparing statement for fetching recipe instructions: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT INTO ingredientsection VALUES(?001, ?002, ?003);", -1, &m_add_ingredient_section,
-                              NULL);
-  check(result, "Error preparing statement for storing ingredient section: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT line, title FROM ingredientsection WHERE recipeid = ?001 ORDER BY line;", -1,
-                              &m_get_ingredient_section, NULL);
-  check(result, "Error preparing statement for retrieving ingredient section: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT INTO instructionsection VALUES(?001, ?002, ?003);", -1, &m_add_instruction_section,
-                              NULL);
-  check(result, "Error preparing statement for storing instruction section: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT line, title FROM instructionsection WHERE recipeid = ?001 ORDER BY line;", -1,
-                              &m_get_instruction_section, NULL);
-  check(result, "Error preparing statement for retrieving instruction section: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT COUNT(id) FROM selection;", -1, &m_count_selected, NULL);
-  check(result, "Error preparing statement for counting recipes: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT selection.id, title from selection, recipes WHERE recipes.id = selection.id "
-                              "ORDER BY title COLLATE NOCASE;", -1, &m_get_info, NULL);
-  check(result, "Error preparing statement for retrieving recipe info: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM selection WHERE id NOT IN (SELECT selection.id FROM selection, recipes WHERE "
-                              "selection.id = recipes.id AND title LIKE '%' || ?001 || '%');", -1, &m_select_title, NULL);
-  check(result, "Error preparing statement for selecting by title: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT name FROM categories, category, selection WHERE categories.id = categoryid AND "
-                              "selection.id = recipeid GROUP BY categories.id ORDER BY COUNT(recipeid) DESC, name ASC;", -1,
-                              &m_category_list, NULL);
-  check(result, "Error preparing statement for listing categories: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM selection WHERE id NOT IN (SELECT selection.id FROM selection, category, categories "
-                              "WHERE selection.id = recipeid AND categoryid = categories.id AND name LIKE ?001 || '%');", -1,
-                              &m_select_category, NULL);
-  check(result, "Error preparing statement for selecting by category: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM selection WHERE id IN (SELECT selection.id FROM selection, category, categories "
-                              "WHERE selection.id = recipeid AND categoryid = categories.id AND name LIKE ?001 || '%');", -1,
-                              &m_select_no_category, NULL);
-  check(result, "Error preparing statement for excluding category: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM selection WHERE id NOT IN (SELECT selection.id FROM selection, ingredient, "
-                              "ingredients WHERE selection.id = recipeid AND ingredientid = ingredients.id AND "
-                              "name LIKE '%' || ?001 || '%');", -1, &m_select_ingredient, NULL);
-  check(result, "Error preparing statement for selecting by ingredient: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM selection WHERE id IN (SELECT selection.id FROM selection, ingredient, "
-                              "ingredients WHERE selection.id = recipeid AND ingredientid = ingredients.id AND "
-                              "name LIKE '%' || ?001 || '%');", -1, &m_select_no_ingredient, NULL);
-  check(result, "Error preparing statement for selecting by not having ingredient: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM recipes WHERE id = ?001;", -1, &m_delete_recipe, NULL);
-  check(result, "Error preparing statement for deleting recipe: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM category WHERE recipeid = ?001;", -1, &m_delete_categories, NULL);
-  check(result, "Error preparing statement for deleting category: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM ingredient WHERE recipeid = ?001;", -1, &m_delete_ingredients, NULL);
-  check(result, "Error preparing statement for deleting ingredients: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM instruction WHERE recipeid = ?001;", -1, &m_delete_instructions, NULL);
-  check(result, "Error preparing statement for deleting instructions: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM ingredientsection WHERE recipeid = ?001;", -1, &m_delete_ingredient_sections,
-                              NULL);
-  check(result, "Error preparing statement for deleting ingredient sections: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM instructionsection WHERE recipeid = ?001;", -1, &m_delete_instruction_sections,
-                              NULL);
-  check(result, "Error preparing statement for deleting instruction sections: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM selection WHERE id = ?001;", -1, &m_delete_selection, NULL);
-  check(result, "Error preparing statement for deleting recipe from selection: ");
-  result = sqlite3_prepare_v2(m_db, "UPDATE categories SET name = ?002 WHERE name = ?001;", -1, &m_rename_category, NULL);
-  check(result, "Error preparing statement for renaming category: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT id FROM categories WHERE name = ?001;", -1, &m_get_category_id, NULL);
-  check(result, "Error preparing statement for getting category id: ");
-  result = sqlite3_prepare_v2(m_db, "UPDATE OR REPLACE category SET categoryid = ?002 WHERE categoryid = ?001;", -1, &m_merge_category, NULL);
-  check(result, "Error preparing statement for merging categories: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM categories WHERE id = ?001;", -1, &m_delete_category, NULL);
-  check(result, "Error preparing statement for deleting category: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM category WHERE categoryid = ?001;", -1, &m_delete_recipe_category, NULL);
-  check(result, "Error preparing statement for deleting recipe category: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM categories WHERE id NOT IN (SELECT categoryid FROM category);", -1,
-                              &m_clean_categories, NULL);
-  check(result, "Error preparing statement for cleaning categories: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM ingredients WHERE id NOT IN (SELECT ingredientid FROM ingredient);", -1,
-                              &m_clean_ingredients, NULL);
-  check(result, "Error preparing statement for cleaning ingredients: ");
-  result = sqlite3_prepare_v2(m_db, "INSERT INTO selection VALUES(?001);", -1, &m_select_recipe, NULL);
-  check(result, "Error preparing statement for selecting recipe: ");
-  result = sqlite3_prepare_v2(m_db, "DELETE FROM category WHERE recipeid = ?001 AND categoryid IN (SELECT id FROM categories "
-                              "WHERE name = ?002);", -1, &m_remove_recipe_category, NULL);
-  check(result, "Error preparing statement for removing category from recipe: ");
-  result = sqlite3_prepare_v2(m_db, "SELECT COUNT(recipeid) FROM category, categories WHERE categoryid = id AND name = ?001;",
-                              -1, &m_count_recipes_in_category, NULL);
-  check(result, "Error preparing statement for removing category from recipe: ");
+  // The sort key depends on the language of the connection, so the function is not deterministic.
+  result = sqlite3_create_function_v2(m_db, "anymeal_sortkey", 1, SQLITE_UTF8, this, &anymeal_sortkey, NULL, NULL, NULL);
+  check(result, "Error registering function for sorting titles: ");
+  result = sqlite3_create_function_v2(m_db, "anymeal_unit", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, &anymeal_unit,
+                                      NULL, NULL, NULL);
+  check(result, "Error registering function for converting units: ");
+  if (!read_only) {
+    journal();
+    migrate();
+    load_language();
+  } else if (user_version() >= 11) {
+    // Read-only connections compare titles with the stored sort keys when fetching pages.
+    load_language();
+  };
+  result = sqlite3_exec(m_db, "CREATE TEMPORARY TABLE ids(id INTEGER PRIMARY KEY);", NULL, NULL, NULL);
+  check(result, "Error creating table for staging recipe ids: ");
+  result = sqlite3_create_function_v2(m_db, "anymeal_text", 1, SQLITE_UTF8, this, &anymeal_text, NULL, NULL, NULL);
+  check(result, "Error registering function for decompressing text: ");
+  define(&m_begin, "BEGIN;", "Error preparing begin transaction statement: ");
+  define(&m_commit, "COMMIT;", "Error preparing commit transaction statement: ");
+  define(&m_rollback, "ROLLBACK;", "Error preparing rollback transaction statement: ");
+  define(&m_insert_recipe, "INSERT INTO recipes VALUES(NULL, ?001, ?002, ?003, anymeal_sortkey(?001), ?004);",
+         "Error preparing insert statement for recipes: ");
+  define(&m_add_category, "INSERT OR IGNORE INTO categories(name) VALUES(?001);",
+         "Error preparing statement for adding category: ");
+  define(&m_recipe_category, "INSERT OR IGNORE INTO category SELECT ?001, id FROM categories WHERE categories.name = ?002;",
+         "Error preparing statement for assigning recipe category: ");
+  define(&m_add_ingredient, "INSERT OR IGNORE INTO ingredients(name) VALUES(?001);",
+         "Error preparing statement for adding ingredient: ");
+  define(&m_recipe_ingredient, "INSERT INTO ingredient SELECT ?001, ?002, ?003, ?004, ?005, ?006, ?007, ingredients.id "
+         "FROM ingredients WHERE ingredients.name = ?008;", "Error preparing statement for adding ingredient to recipe: ");
+  define(&m_get_header, "SELECT title, servings, servingsunit, body FROM recipes LEFT JOIN recipebody ON recipeid = id "
+         "WHERE id = ?001;", "Error preparing statement for fetching recipe header: ");
+  define(&m_get_categories, "SELECT name FROM categories, category WHERE recipeid = ?001 AND id = categoryid ORDER BY name;",
+         "Error preparing statement for fetching recipe categories: ");
+  define(&m_category_and_count_list, "SELECT name, refcount FROM categories ORDER BY name;",
+         "Error preparing statement for fetching recipe categories and recipe counts: ");
+  define(&m_get_ingredients, "SELECT amountint, amountnum, amountdenom, amountfloat, unit, name "
+         "FROM ingredient, ingredients WHERE recipeid = ?001 AND ingredientid = ingredients.id ORDER BY line;",
+         "Error preparing statement for fetching recipe ingredients: ");
+  define(&m_index_ingredient, "INSERT OR IGNORE INTO recipeingredient SELECT id, ?001 FROM ingredients WHERE name = ?002;",
+         "Error preparing statement for indexing ingredient of recipe: ");
+  define(&m_add_body, "INSERT INTO recipebody VALUES(?001, ?002);", "Error preparing statement for adding recipe body: ");
+  define(&m_add_instruction, "INSERT INTO instruction VALUES(?001, ?002, ?003);",
+         "Error preparing statement for adding instruction to recipe: ");
+  define(&m_get_instructions, "SELECT anymeal_text(txt) FROM instruction WHERE recipeid = ?001 ORDER BY line;",
+         "Error preparing statement for fetching recipe instructions: ");
+  define(&m_get_dictionary, "SELECT generation, phrase FROM dictionary ORDER BY code;",
+         "Error preparing statement for fetching dictionary: ");
+  define(&m_add_phrase, "INSERT INTO dictionary VALUES(?001, ?002, ?003);",
+         "Error preparing statement for adding phrase to dictionary: ");
+  define(&m_update_instruction, "UPDATE instruction SET txt = ?003 WHERE recipeid = ?001 AND line = ?002;",
+         "Error preparing statement for updating instruction: ");
+  define(&m_add_token, "INSERT OR IGNORE INTO ingredienttokens VALUES(?001, ?002);",
+         "Error preparing statement for adding ingredient token: ");
+  define(&m_match_token, "SELECT ingredientid FROM ingredienttokens WHERE token = ?001;",
+         "Error preparing statement for matching ingredients: ");
+  define(&m_pantry_coverage, "SELECT recipeid, COUNT(DISTINCT CASE WHEN ingredientid IN (SELECT id FROM ids) THEN ingredientid END), "
+         "COUNT(DISTINCT ingredientid) FROM ingredientindex WHERE recipeid IN (SELECT recipeid FROM ingredientindex, ids WHERE "
+         "ingredientid = ids.id) AND recipeid IN (SELECT id FROM selection) GROUP BY recipeid;",
+         "Error preparing statement for counting covered ingredients: ");
+  define(&m_select_staged, "DELETE FROM selection WHERE id NOT IN (SELECT id FROM ids);",
+         "Error preparing statement for selecting recipes: ");
+  define(&m_add_staged_to_selection, "INSERT OR IGNORE INTO selection SELECT ids.id FROM ids, recipes WHERE recipes.id = ids.id;",
+         "Error preparing statement for adding recipes to selection: ");
+  define(&m_selected_ids, "SELECT id FROM selection ORDER BY id;", "Error preparing statement for listing selected recipes: ");
+  define(&m_get_title, "SELECT title FROM recipes WHERE id = ?001;", "Error preparing statement for getting recipe title: ");
+  define(&m_index_recipe, "INSERT INTO recipesearch(rowid, title, ingredients, instructions) VALUES(?001, ?002, ?003, ?004);",
+         "Error preparing statement for indexing recipe text: ");
+  define(&m_select_text, "DELETE FROM selection WHERE id NOT IN (SELECT rowid FROM recipesearch WHERE recipesearch MATCH ?001);",
+         "Error preparing statement for selecting by text: ");
+  define(&m_ranked_titles, "SELECT recipesearch.rowid, recipes.title FROM recipesearch, recipes, selection "
+         "WHERE recipesearch MATCH ?001 AND recipes.id = recipesearch.rowid AND selection.id = recipes.id "
+         "ORDER BY bm25(recipesearch, " SEARCH_WEIGHTS ") LIMIT ?002 OFFSET ?003;",
+         "Error preparing statement for ranking recipes: ");
+  define(&m_add_ingredient_section, "INSERT INTO ingredientsection VALUES(?001, ?002, ?003);",
+         "Error preparing statement for storing ingredient section: ");
+  define(&m_get_ingredient_section, "SELECT line, title FROM ingredientsection WHERE recipeid = ?001 ORDER BY line;",
+         "Error preparing statement for retrieving ingredient section: ");
+  define(&m_add_instruction_section, "INSERT INTO instructionsection VALUES(?001, ?002, ?003);",
+         "Error preparing statement for storing instruction section: ");
+  define(&m_get_instruction_section, "SELECT line, title FROM instructionsection WHERE recipeid = ?001 ORDER BY line;",
+         "Error preparing statement for retrieving instruction section: ");
+  define(&m_count_all, "SELECT COUNT(*) FROM recipes;", "Error preparing statement for counting all recipes: ");
+  define(&m_get_all_info, "SELECT id, title FROM recipes ORDER BY sortkey, id;",
+         "Error preparing statement for retrieving info of all recipes: ");
+  define(&m_all_category_list, "SELECT name FROM categories WHERE refcount > 0 ORDER BY refcount DESC, name ASC;",
+         "Error preparing statement for listing all categories: ");
+  define(&m_count_selected, "SELECT size FROM selectionsize;", "Error preparing statement for counting recipes: ");
+  define(&m_get_info, "SELECT selection.id, title from selection, recipes WHERE recipes.id = selection.id "
+         "ORDER BY sortkey, recipes.id;", "Error preparing statement for retrieving recipe info: ");
+  define(&m_get_all_page, "SELECT id, title FROM recipes WHERE (sortkey, id) > (?002, ?001) ORDER BY sortkey, id LIMIT ?003;",
+         "Error preparing statement for retrieving page of all recipes: ");
+  define(&m_get_page, "SELECT recipes.id, title FROM recipes, selection WHERE selection.id = recipes.id AND "
+         "(sortkey, recipes.id) > (?002, ?001) ORDER BY sortkey, recipes.id LIMIT ?003;",
+         "Error preparing statement for retrieving page of recipes: ");
+  define(&m_select_title, "DELETE FROM selection WHERE id NOT IN (SELECT selection.id FROM selection, recipes WHERE "
+         "selection.id = recipes.id AND title LIKE '%' || ?001 || '%');", "Error preparing statement for selecting by title: ");
+  define(&m_category_list, "SELECT name FROM categories, categorycounts WHERE categories.id = categoryid AND count > 0 "
+         "ORDER BY count DESC, name ASC;", "Error preparing statement for listing categories: ");
+  define(&m_select_category, "DELETE FROM selection WHERE id NOT IN (SELECT selection.id FROM selection, category, categories "
+         "WHERE selection.id = recipeid AND categoryid = categories.id AND name LIKE ?001 || '%');",
+         "Error preparing statement for selecting by category: ");
+  define(&m_select_no_category, "DELETE FROM selection WHERE id IN (SELECT selection.id FROM selection, category, categories "
+         "WHERE selection.id = recipeid AND categoryid = categories.id AND name LIKE ?001 || '%');",
+         "Error preparing statement for excluding category: ");
+  define(&m_select_ingredient, "DELETE FROM selection WHERE id NOT IN (SELECT selection.id FROM selection, ingredientindex, "
+         "ingredients WHERE selection.id = recipeid AND ingredientid = ingredients.id AND "
+         "name LIKE '%' || ?001 || '%');", "Error preparing statement for selecting by ingredient: ");
+  define(&m_select_no_ingredient, "DELETE FROM selection WHERE id IN (SELECT selection.id FROM selection, ingredientindex, "
+         "ingredients WHERE selection.id = recipeid AND ingredientid = ingredients.id AND "
+         "name LIKE '%' || ?001 || '%');", "Error preparing statement for selecting by not having ingredient: ");
+  define(&m_stage_id, "INSERT OR IGNORE INTO ids VALUES(?001);", "Error preparing statement for staging recipe id: ");
+  define(&m_clear_ids, "DELETE FROM ids;", "Error preparing statement for clearing staged recipe ids: ");
+  define(&m_delete_staged_recipes, "DELETE FROM recipes WHERE id IN (SELECT id FROM ids);",
+         "Error preparing statement for deleting recipes: ");
+  define(&m_unselect_staged, "DELETE FROM selection WHERE id IN (SELECT id FROM ids);",
+         "Error preparing statement for deleting recipes from selection: ");
+  define(&m_rename_category, "UPDATE categories SET name = ?002 WHERE name = ?001;",
+         "Error preparing statement for renaming category: ");
+  define(&m_get_category_id, "SELECT id FROM categories WHERE name = ?001;",
+         "Error preparing statement for getting category id: ");
+  // Copy instead of UPDATE OR REPLACE because rows deleted by conflict resolution do not fire triggers.
+  define(&m_merge_category, "INSERT OR IGNORE INTO category SELECT recipeid, ?002 FROM category WHERE categoryid = ?001;",
+         "Error preparing statement for merging categories: ");
+  define(&m_delete_category, "DELETE FROM categories WHERE id = ?001;", "Error preparing statement for deleting category: ");
+  define(&m_delete_recipe_category, "DELETE FROM category WHERE categoryid = ?001;",
+         "Error preparing statement for deleting recipe category: ");
+  define(&m_clean_categories, "DELETE FROM categories WHERE refcount = 0;",
+         "Error preparing statement for cleaning categories: ");
+  define(&m_clean_ingredients, "DELETE FROM ingredients WHERE refcount = 0;",
+         "Error preparing statement for cleaning ingredients: ");
+  define(&m_select_recipe, "INSERT INTO selection VALUES(?001);", "Error preparing statement for selecting recipe: ");
+  define(&m_add_staged_to_category, "INSERT OR IGNORE INTO category SELECT id, ?001 FROM ids;",
+         "Error preparing statement for adding recipes to category: ");
+  define(&m_remove_staged_from_category, "DELETE FROM category WHERE categoryid = ?001 AND recipeid IN (SELECT id FROM ids);",
+         "Error preparing statement for removing recipes from category: ");
+  define(&m_count_recipes_in_category, "SELECT refcount FROM categories WHERE name = ?001;",
+         "Error preparing statement for counting recipes in category: ");
+  load_dictionary();
+  if (m_reindex)
+    rebuild_search_index();
+  if (m_refingerprint)
+    compute_fingerprints();
+  if (m_retokenize)
+    tokenize_ingredients();
 }
 
 int Database::user_version(void) {
@@ -232,10 +363,21 @@ void Database::pragmas(void) {
   check(result, "Error enabling checks for foreign keys: ");
   result = sqlite3_exec(m_db, "PRAGMA cache_size = -256000;", NULL, NULL, NULL);
   check(result, "Error setting cache size: ");
+  result = sqlite3_exec(m_db, "PRAGMA busy_timeout = 10000;", NULL, NULL, NULL);
+  check(result, "Error setting busy timeout: ");
+}
+
+void Database::journal(void) {
+  // Write-ahead logging lets read-only connections run concurrently with a writer.
+  int result = sqlite3_exec(m_db, "PRAGMA journal_mode = WAL;", NULL, NULL, NULL);
+  check(result, "Error enabling write-ahead log: ");
+  result = sqlite3_exec(m_db, "PRAGMA synchronous = NORMAL;", NULL, NULL, NULL);
+  check(result, "Error setting synchronous mode: ");
 }
 
 void Database::create_version_1(void) {
   int result = sqlite3_exec(m_db,
+    "PRAGMA auto_vacuum = INCREMENTAL;\n"
     "BEGIN;\n"
     "CREATE TABLE recipes(id INTEGER PRIMARY KEY, title VARCHAR(60) NOT NULL, servings INTEGER NOT NULL, "
     "servingsunit VARCHAR(40) NOT NULL);\n"
@@ -281,6 +423,247 @@ void Database::migrate_version_2_to_version_3(void)
   check(result, "Error migrating database to version 3: ");
 }
 
+void Database::migrate_version_3_to_version_4(void)
+{
+  // Recreate tables referencing recipes so that deleting a recipe cascades.
+  int result = sqlite3_exec(m_db,
+    "PRAGMA foreign_keys = OFF;\n"
+    "BEGIN;\n"
+    "CREATE TABLE new_category(recipeid INTEGER NOT NULL, categoryid INTEGER NOT NULL, PRIMARY KEY(recipeid, categoryid), "
+    "FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE, FOREIGN KEY(categoryid) REFERENCES categories(id));\n"
+    "INSERT INTO new_category SELECT * FROM category;\n"
+    "DROP TABLE category;\n"
+    "ALTER TABLE new_category RENAME TO category;\n"
+    "CREATE TABLE new_ingredient(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, amountint INTEGER NOT NULL, "
+    "amountnum INTEGER NOT NULL, amountdenom INTEGER NOT NULL, amountfloat REAL NOT NULL, unit CHARACTER(2) NOT NULL, "
+    "ingredientid INTEGER NOT NULL, PRIMARY KEY(recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE, "
+    "FOREIGN KEY(ingredientid) REFERENCES ingredients(id));\n"
+    "INSERT INTO new_ingredient SELECT * FROM ingredient;\n"
+    "DROP TABLE ingredient;\n"
+    "ALTER TABLE new_ingredient RENAME TO ingredient;\n"
+    "CREATE TABLE new_instruction(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, txt TEXT NOT NULL, "
+    "PRIMARY KEY(recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE);\n"
+    "INSERT INTO new_instruction SELECT * FROM instruction;\n"
+    "DROP TABLE instruction;\n"
+    "ALTER TABLE new_instruction RENAME TO instruction;\n"
+    "CREATE TABLE new_ingredientsection(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, title VARCHAR(60) NOT NULL, "
+    "PRIMARY KEY (recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE);\n"
+    "INSERT INTO new_ingredientsection SELECT * FROM ingredientsection;\n"
+    "DROP TABLE ingredientsection;\n"
+    "ALTER TABLE new_ingredientsection RENAME TO ingredientsection;\n"
+    "CREATE TABLE new_instructionsection(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, title VARCHAR(60) NOT NULL, "
+    "PRIMARY KEY (recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE);\n"
+    "INSERT INTO new_instructionsection SELECT * FROM instructionsection;\n"
+    "DROP TABLE instructionsection;\n"
+    "ALTER TABLE new_instructionsection RENAME TO instructionsection;\n"
+    "COMMIT;\n"
+    "PRAGMA foreign_keys = ON;\n"
+    "PRAGMA user_version = 4;\n",
+    NULL, NULL, NULL);
+  if (result != SQLITE_OK) {
+    sqlite3_exec(m_db, "ROLLBACK;", NULL, NULL, NULL);
+    sqlite3_exec(m_db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+  };
+  check(result, "Error migrating database to version 4: ");
+}
+
+void Database::migrate_version_4_to_version_5(void)
+{
+  // Count references to categories and ingredients so that orphans can be found using an index.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "ALTER TABLE categories ADD COLUMN refcount INTEGER NOT NULL DEFAULT 0;\n"
+    "UPDATE categories SET refcount = (SELECT COUNT(*) FROM category WHERE categoryid = categories.id);\n"
+    "CREATE INDEX categories_unused ON categories(id) WHERE refcount = 0;\n"
+    "CREATE TRIGGER category_insert AFTER INSERT ON category BEGIN "
+    "UPDATE categories SET refcount = refcount + 1 WHERE id = NEW.categoryid; END;\n"
+    "CREATE TRIGGER category_delete AFTER DELETE ON category BEGIN "
+    "UPDATE categories SET refcount = refcount - 1 WHERE id = OLD.categoryid; END;\n"
+    "CREATE TRIGGER category_update AFTER UPDATE OF categoryid ON category BEGIN "
+    "UPDATE categories SET refcount = refcount - 1 WHERE id = OLD.categoryid; "
+    "UPDATE categories SET refcount = refcount + 1 WHERE id = NEW.categoryid; END;\n"
+    "ALTER TABLE ingredients ADD COLUMN refcount INTEGER NOT NULL DEFAULT 0;\n"
+    "UPDATE ingredients SET refcount = (SELECT COUNT(*) FROM ingredient WHERE ingredientid = ingredients.id);\n"
+    "CREATE INDEX ingredients_unused ON ingredients(id) WHERE refcount = 0;\n"
+    "CREATE TRIGGER ingredient_insert AFTER INSERT ON ingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount + 1 WHERE id = NEW.ingredientid; END;\n"
+    "CREATE TRIGGER ingredient_delete AFTER DELETE ON ingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount - 1 WHERE id = OLD.ingredientid; END;\n"
+    "CREATE TRIGGER ingredient_update AFTER UPDATE OF ingredientid ON ingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount - 1 WHERE id = OLD.ingredientid; "
+    "UPDATE ingredients SET refcount = refcount + 1 WHERE id = NEW.ingredientid; END;\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 5;\n",
+    NULL, NULL, NULL);
+  if (result != SQLITE_OK)
+    sqlite3_exec(m_db, "ROLLBACK;", NULL, NULL, NULL);
+  check(result, "Error migrating database to version 5: ");
+}
+
+void Database::migrate_version_5_to_version_6(void)
+{
+  // Compact storage of recipe bodies with a separate index of ingredients for searching.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "CREATE TABLE recipebody(recipeid INTEGER PRIMARY KEY, body BLOB NOT NULL, "
+    "FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE);\n"
+    "CREATE TABLE recipeingredient(ingredientid INTEGER NOT NULL, recipeid INTEGER NOT NULL, "
+    "PRIMARY KEY(ingredientid, recipeid), FOREIGN KEY(ingredientid) REFERENCES ingredients(id), "
+    "FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE) WITHOUT ROWID;\n"
+    "CREATE INDEX recipeingredient_recipe ON recipeingredient(recipeid);\n"
+    "CREATE TRIGGER recipeingredient_insert AFTER INSERT ON recipeingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount + 1 WHERE id = NEW.ingredientid; END;\n"
+    "CREATE TRIGGER recipeingredient_delete AFTER DELETE ON recipeingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount - 1 WHERE id = OLD.ingredientid; END;\n"
+    "CREATE VIEW ingredientindex AS SELECT recipeid, ingredientid FROM ingredient "
+    "UNION ALL SELECT recipeid, ingredientid FROM recipeingredient;\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 6;\n",
+    NULL, NULL, NULL);
+  if (result != SQLITE_OK)
+    sqlite3_exec(m_db, "ROLLBACK;", NULL, NULL, NULL);
+  check(result, "Error migrating database to version 6: ");
+}
+
+void Database::migrate_version_6_to_version_7(void)
+{
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "CREATE TABLE dictionary(generation INTEGER NOT NULL, code INTEGER PRIMARY KEY, phrase TEXT NOT NULL);\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 7;\n",
+    NULL, NULL, NULL);
+  check(result, "Error migrating database to version 7: ");
+}
+
+void Database::migrate_version_7_to_version_8(void)
+{
+  // Inverted index from ingredients to recipes.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "CREATE INDEX ingredient_recipe ON ingredient(ingredientid, recipeid);\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 8;\n",
+    NULL, NULL, NULL);
+  check(result, "Error migrating database to version 8: ");
+}
+
+void Database::migrate_version_8_to_version_9(void)
+{
+  // Full-text index of recipes. It is populated once all statements are prepared.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "CREATE VIRTUAL TABLE recipesearch USING fts5(title, ingredients, instructions, tokenize = 'unicode61 remove_diacritics 2');\n"
+    "CREATE TRIGGER recipes_delete AFTER DELETE ON recipes BEGIN DELETE FROM recipesearch WHERE rowid = OLD.id; END;\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 9;\n",
+    NULL, NULL, NULL);
+  check(result, "Error migrating database to version 9: ");
+  m_reindex = true;
+}
+
+void Database::migrate_version_9_to_version_10(void)
+{
+  // Index for listing recipe titles page by page.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "CREATE INDEX recipes_title ON recipes(title COLLATE NOCASE, id);\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 10;\n",
+    NULL, NULL, NULL);
+  check(result, "Error migrating database to version 10: ");
+}
+
+void Database::migrate_version_10_to_version_11(void)
+{
+  // Titles are sorted using precomputed keys of the user interface language.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "ALTER TABLE recipes ADD COLUMN sortkey BLOB;\n"
+    "UPDATE recipes SET sortkey = anymeal_sortkey(title);\n"
+    "DROP INDEX recipes_title;\n"
+    "CREATE INDEX recipes_sortkey ON recipes(sortkey, id);\n"
+    "CREATE TABLE collation(language VARCHAR(8) NOT NULL);\n"
+    "INSERT INTO collation VALUES('en');\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 11;\n",
+    NULL, NULL, NULL);
+  check(result, "Error migrating database to version 11: ");
+}
+
+void Database::migrate_version_11_to_version_12(void)
+{
+  // Store ingredient units as numbers. The table is recreated because the type of a column cannot be changed.
+  int result = sqlite3_exec(m_db,
+    "PRAGMA foreign_keys = OFF;\n"
+    "BEGIN;\n"
+    "DROP VIEW ingredientindex;\n"
+    "CREATE TABLE new_ingredient(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, amountint INTEGER NOT NULL, "
+    "amountnum INTEGER NOT NULL, amountdenom INTEGER NOT NULL, amountfloat REAL NOT NULL, unit INTEGER NOT NULL, "
+    "ingredientid INTEGER NOT NULL, PRIMARY KEY(recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id) ON DELETE CASCADE, "
+    "FOREIGN KEY(ingredientid) REFERENCES ingredients(id));\n"
+    "INSERT INTO new_ingredient SELECT recipeid, line, amountint, amountnum, amountdenom, amountfloat, anymeal_unit(unit), "
+    "ingredientid FROM ingredient;\n"
+    "DROP TABLE ingredient;\n"
+    "ALTER TABLE new_ingredient RENAME TO ingredient;\n"
+    "CREATE INDEX ingredient_recipe ON ingredient(ingredientid, recipeid);\n"
+    "CREATE TRIGGER ingredient_insert AFTER INSERT ON ingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount + 1 WHERE id = NEW.ingredientid; END;\n"
+    "CREATE TRIGGER ingredient_delete AFTER DELETE ON ingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount - 1 WHERE id = OLD.ingredientid; END;\n"
+    "CREATE TRIGGER ingredient_update AFTER UPDATE OF ingredientid ON ingredient BEGIN "
+    "UPDATE ingredients SET refcount = refcount - 1 WHERE id = OLD.ingredientid; "
+    "UPDATE ingredients SET refcount = refcount + 1 WHERE id = NEW.ingredientid; END;\n"
+    "CREATE VIEW ingredientindex AS SELECT recipeid, ingredientid FROM ingredient "
+    "UNION ALL SELECT recipeid, ingredientid FROM recipeingredient;\n"
+    "COMMIT;\n"
+    "PRAGMA foreign_keys = ON;\n"
+    "PRAGMA user_version = 12;\n",
+    NULL, NULL, NULL);
+  if (result != SQLITE_OK) {
+    sqlite3_exec(m_db, "ROLLBACK;", NULL, NULL, NULL);
+    sqlite3_exec(m_db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+  };
+  check(result, "Error migrating database to version 12: ");
+}
+
+void Database::migrate_version_12_to_version_13(void)
+{
+  // Fingerprints of the recipe content for detecting duplicates. They are computed once all statements are prepared.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "ALTER TABLE recipes ADD COLUMN fingerprint INTEGER;\n"
+    "CREATE INDEX recipes_fingerprint ON recipes(fingerprint);\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 13;\n",
+    NULL, NULL, NULL);
+  check(result, "Error migrating database to version 13: ");
+  m_refingerprint = true;
+}
+
+void Database::migrate_version_13_to_version_14(void)
+{
+  // Existing databases were created without incremental vacuuming. Changing it requires rewriting the file which can take
+  // a long time. Therefore it is done on demand using convert_to_incremental_vacuum.
+  int result = sqlite3_exec(m_db, "PRAGMA user_version = 14;", NULL, NULL, NULL);
+  check(result, "Error migrating database to version 14: ");
+}
+
+void Database::migrate_version_14_to_version_15(void)
+{
+  // Words of the ingredient names for matching pantry items. They are filled in once all statements are prepared.
+  int result = sqlite3_exec(m_db,
+    "BEGIN;\n"
+    "CREATE TABLE ingredienttokens(token VARCHAR(60) NOT NULL, ingredientid INTEGER NOT NULL, "
+    "PRIMARY KEY(token, ingredientid), FOREIGN KEY(ingredientid) REFERENCES ingredients(id) ON DELETE CASCADE) WITHOUT ROWID;\n"
+    "CREATE INDEX ingredienttokens_ingredient ON ingredienttokens(ingredientid);\n"
+    "COMMIT;\n"
+    "PRAGMA user_version = 15;\n",
+    NULL, NULL, NULL);
+  check(result, "Error migrating database to version 15: ");
+  m_retokenize = true;
+}
+
 void Database::migrate(void) {
   int version = user_version();
   if (version <= 0)
@@ -289,7 +672,31 @@ void Database::migrate(void) {
     migrate_version_1_to_version_2();
   if (version <= 2)
     migrate_version_2_to_version_3();
-  if (version > 3) {
+  if (version <= 3)
+    migrate_version_3_to_version_4();
+  if (version <= 4)
+    migrate_version_4_to_version_5();
+  if (version <= 5)
+    migrate_version_5_to_version_6();
+  if (version <= 6)
+    migrate_version_6_to_version_7();
+  if (version <= 7)
+    migrate_version_7_to_version_8();
+  if (version <= 8)
+    migrate_version_8_to_version_9();
+  if (version <= 9)
+    migrate_version_9_to_version_10();
+  if (version <= 10)
+    migrate_version_10_to_version_11();
+  if (version <= 11)
+    migrate_version_11_to_version_12();
+  if (version <= 12)
+    migrate_version_12_to_version_13();
+  if (version <= 13)
+    migrate_version_13_to_version_14();
+  if (version <= 14)
+    migrate_version_14_to_version_15();
+  if (version > 15) {
     ostringstream s;
     s << "Database version " << version << " was created by more recent release of software.";
     throw database_exception(s.str());
@@ -297,6 +704,7 @@ void Database::migrate(void) {
 }
 
 void Database::begin(void) {
+  prepare(m_begin);
   int result = sqlite3_step(m_begin);
   check(result, "Error beginning transaction: ");
   result = sqlite3_reset(m_begin);
@@ -304,6 +712,7 @@ void Database::begin(void) {
 }
 
 void Database::commit(void) {
+  prepare(m_commit);
   int result = sqlite3_step(m_commit);
   check(result, "Error committing transaction: ");
   result = sqlite3_reset(m_commit);
@@ -311,13 +720,17 @@ void Database::commit(void) {
 }
 
 void Database::rollback(void) {
+  prepare(m_rollback);
   int result = sqlite3_step(m_rollback);
   check(result, "Error rolling back transaction: ");
   result = sqlite3_reset(m_rollback);
   check(result, "Error resetting rollback transaction statement: ");
+  // The dictionary might have been changed by the transaction.
+  load_dictionary();
 }
 
 void Database::add_category(const char *name) {
+  prepare(m_add_category);
   int result = sqlite3_bind_text(m_add_category, 1, name, -1, SQLITE_STATIC);
   check(result, "Error binding category name: ");
   result = sqlite3_step(m_add_category);
@@ -329,8 +742,8 @@ void Database::add_category(const char *name) {
 #include <iostream>
 
 sqlite3_int64 Database::insert_recipe(Recipe &recipe) {
-  int c;
-  assert(m_insert_recipe);
+  prepare(m_insert_recipe);
+  prepare(m_recipe_category);
   int result;
   // Add recipe header.
   string title = recipe.title();
@@ -341,6 +754,8 @@ sqlite3_int64 Database::insert_recipe(Recipe &recipe) {
   string servings_unit = recipe.servings_unit();
   result = sqlite3_bind_text(m_insert_recipe, 3, recipe.servings_unit_c_str(), -1, SQLITE_STATIC);
   check(result, "Error binding recipe servings unit: ");
+  result = sqlite3_bind_int64(m_insert_recipe, 4, (sqlite3_int64)recipe_fingerprint(recipe));
+  check(result, "Error binding recipe fingerprint: ");
   result = sqlite3_step(m_insert_recipe);
   check(result, "Error executing insert statement: ");
   result = sqlite3_reset(m_insert_recipe);
@@ -361,16 +776,64 @@ sqlite3_int64 Database::insert_recipe(Recipe &recipe) {
     result = sqlite3_reset(m_recipe_category);
     check(result, "Error resetting recipe category statement: ");
   };
+  if (m_compact_storage)
+    insert_recipe_blob(recipe_id, recipe);
+  else
+    insert_recipe_rows(recipe_id, recipe);
+  index_recipe(recipe_id, recipe);
+  // Add to selection unless all recipes are selected implicitly.
+  if (!m_all_selected) {
+    prepare(m_select_recipe);
+    result = sqlite3_bind_int64(m_select_recipe, 1, recipe_id);
+    check(result, "Error binding id for selecting recipe: ");
+    result = sqlite3_step(m_select_recipe);
+    check(result, "Error selecting recipe: ");
+    result = sqlite3_reset(m_select_recipe);
+    check(result, "Error resetting statement for selecting recipe: ");
+  };
+  return recipe_id;
+}
+
+void Database::add_ingredient(const char *name) {
+  prepare(m_add_ingredient);
+  int result = sqlite3_bind_text(m_add_ingredient, 1, name, -1, SQLITE_STATIC);
+  check(result, "Error binding ingredient: ");
+  result = sqlite3_step(m_add_ingredient);
+  check(result, "Error adding ingredient: ");
+  result = sqlite3_reset(m_add_ingredient);
+  check(result, "Error resetting ingredient adding statement: ");
+  // Only new ingredients need to be split into words.
+  if (sqlite3_changes(m_db) > 0)
+    index_ingredient(sqlite3_last_insert_rowid(m_db), name);
+}
+
+void Database::index_ingredient(sqlite3_int64 id, const char *name) {
+  prepare(m_add_token);
+  vector<string> tokens = ingredient_tokens(name);
+  for (vector<string>::iterator token=tokens.begin(); token!=tokens.end(); token++) {
+    int result = sqlite3_bind_text(m_add_token, 1, token->c_str(), -1, SQLITE_STATIC);
+    check(result, "Error binding ingredient token: ");
+    result = sqlite3_bind_int64(m_add_token, 2, id);
+    check(result, "Error binding ingredient id: ");
+    result = sqlite3_step(m_add_token);
+    check(result, "Error adding ingredient token: ");
+    result = sqlite3_reset(m_add_token);
+    check(result, "Error resetting statement for adding ingredient token: ");
+  };
+}
+
+void Database::insert_recipe_rows(sqlite3_int64 recipe_id, Recipe &recipe) {
+  prepare(m_recipe_ingredient);
+  prepare(m_add_ingredient_section);
+  prepare(m_add_instruction);
+  prepare(m_add_instruction_section);
+  int result;
+  int c;
   // Add ingredients.
   c = 1;
   for (vector<Ingredient>::iterator ingredient=recipe.ingredients().begin(); ingredient!=recipe.ingredients().end(); ingredient++) {
     // Create ingredient.
-    result = sqlite3_bind_text(m_add_ingredient, 1, ingredient->text_c_str(), -1, SQLITE_STATIC);
-    check(result, "Error binding ingredient: ");
-    result = sqlite3_step(m_add_ingredient);
-    check(result, "Error adding ingredient: ");
-    result = sqlite3_reset(m_add_ingredient);
-    check(result, "Error resetting ingredient adding statement: ");
+    add_ingredient(ingredient->text_c_str());
     // Add ingredient to recipe.
     result = sqlite3_bind_int64(m_recipe_ingredient, 1, recipe_id);
     check(result, "Error binding recipe id: ");
@@ -384,8 +847,7 @@ sqlite3_int64 Database::insert_recipe(Recipe &recipe) {
     check(result, "Error binding ingredient amount denominator: ");
     result = sqlite3_bind_double(m_recipe_ingredient, 6, ingredient->amount_float());
     check(result, "Error binding ingredient floating-point amount: ");
-    string unit = ingredient->unit();
-    result = sqlite3_bind_text(m_recipe_ingredient, 7, ingredient->unit_c_str(), -1, SQLITE_STATIC);
+    result = sqlite3_bind_int(m_recipe_ingredient, 7, ingredient->unit_index());
     check(result, "Error binding ingredient unit: ");
     string text = ingredient->text();
     result = sqlite3_bind_text(m_recipe_ingredient, 8, ingredient->text_c_str(), -1, SQLITE_STATIC);
@@ -415,7 +877,13 @@ sqlite3_int64 Database::insert_recipe(Recipe &recipe) {
     check(result, "Error binding recipe id: ");
     result = sqlite3_bind_int(m_add_instruction, 2, c++);
     check(result, "Error binding instruction index: ");
-    result = sqlite3_bind_text(m_add_instruction, 3, instruction->c_str(), -1, SQLITE_STATIC);
+    string compressed;
+    if (!m_dictionary.empty())
+      compressed = m_dictionary.compress(*instruction);
+    if (!compressed.empty() && compressed.size() < instruction->size())
+      result = sqlite3_bind_blob(m_add_instruction, 3, compressed.data(), compressed.size(), SQLITE_STATIC);
+    else
+      result = sqlite3_bind_text(m_add_instruction, 3, instruction->c_str(), -1, SQLITE_STATIC);
     check(result, "Error binding instruction: ");
     result = sqlite3_step(m_add_instruction);
     check(result, "Error adding instruction to recipe: ");
@@ -435,68 +903,144 @@ sqlite3_int64 Database::insert_recipe(Recipe &recipe) {
     result = sqlite3_reset(m_add_instruction_section);
     check(result, "Error resetting instruction section statement: ");
   };
-  // Add to selection.
-  result = sqlite3_bind_int64(m_select_recipe, 1, recipe_id);
-  check(result, "Error binding id for selecting recipe: ");
-  result = sqlite3_step(m_select_recipe);
-  check(result, "Error selecting recipe: ");
-  result = sqlite3_reset(m_select_recipe);
-  check(result, "Error resetting statement for selecting recipe: ");
-  return recipe_id;
+}
+
+void Database::insert_recipe_blob(sqlite3_int64 recipe_id, Recipe &recipe) {
+  prepare(m_index_ingredient);
+  prepare(m_add_body);
+  int result;
+  // Index ingredients for searching.
+  for (vector<Ingredient>::iterator ingredient=recipe.ingredients().begin(); ingredient!=recipe.ingredients().end(); ingredient++) {
+    add_ingredient(ingredient->text_c_str());
+    result = sqlite3_bind_int64(m_index_ingredient, 1, recipe_id);
+    check(result, "Error binding recipe id: ");
+    result = sqlite3_bind_text(m_index_ingredient, 2, ingredient->text_c_str(), -1, SQLITE_STATIC);
+    check(result, "Error binding ingredient: ");
+    result = sqlite3_step(m_index_ingredient);
+    check(result, "Error indexing ingredient of recipe: ");
+    result = sqlite3_reset(m_index_ingredient);
+    check(result, "Error resetting statement for indexing ingredient of recipe: ");
+  };
+  // Store ingredients, instructions, and sections as one blob.
+  string body = recipe_body_to_blob(recipe);
+  result = sqlite3_bind_int64(m_add_body, 1, recipe_id);
+  check(result, "Error binding recipe id: ");
+  result = sqlite3_bind_blob(m_add_body, 2, body.data(), body.size(), SQLITE_STATIC);
+  check(result, "Error binding recipe body: ");
+  result = sqlite3_step(m_add_body);
+  check(result, "Error adding recipe body: ");
+  result = sqlite3_reset(m_add_body);
+  check(result, "Error resetting statement for adding recipe body: ");
 }
 
 int Database::num_recipes(void) {
-  int result = sqlite3_step(m_count_selected);
+  sqlite3_stmt *&statement = m_all_selected ? m_count_all : m_count_selected;
+  prepare(statement);
+  int result = sqlite3_step(statement);
   check(result, "Error counting recipes: ");
-  int count = sqlite3_column_int(m_count_selected, 0);
-  result = sqlite3_reset(m_count_selected);
+  int count = sqlite3_column_int(statement, 0);
+  result = sqlite3_reset(statement);
   check(result, "Error resetting statement for counting recipes: ");
   return count;
 }
 
 int Database::count_recipes(const char *category) {
+  prepare(m_count_recipes_in_category);
   int result = sqlite3_bind_text(m_count_recipes_in_category, 1, category, -1, SQLITE_STATIC);
   check(result, "Error binding category string: ");
   result = sqlite3_step(m_count_recipes_in_category);
   check(result, "Error counting recipes in category: ");
-  int count = sqlite3_column_int(m_count_recipes_in_category, 0);
+  int count = result == SQLITE_ROW ? sqlite3_column_int(m_count_recipes_in_category, 0) : 0;
   result = sqlite3_reset(m_count_recipes_in_category);
   check(result, "Error resetting statement for counting recipes in category: ");
   return count;
 }
 
 vector<pair<sqlite3_int64, string> > Database::recipe_info(void) {
+  sqlite3_stmt *&statement = m_all_selected ? m_get_all_info : m_get_info;
+  prepare(statement);
   int result;
   vector<pair<sqlite3_int64, string> > infos;
   while (true) {
-    result = sqlite3_step(m_get_info);
+    result = sqlite3_step(statement);
     check(result, "Error getting recipe information: ");
     if (result != SQLITE_ROW)
       break;
-    pair<sqlite3_int64, string> info(sqlite3_column_int64(m_get_info, 0), (const char *)sqlite3_column_text(m_get_info, 1));
+    pair<sqlite3_int64, string> info(sqlite3_column_int64(statement, 0), (const char *)sqlite3_column_text(statement, 1));
     infos.push_back(info);
   };
-  result = sqlite3_reset(m_get_info);
+  result = sqlite3_reset(statement);
   check(result, "Error resetting statement for getting recipe info: ");
   return infos;
 }
 
+vector<pair<sqlite3_int64, string> > Database::recipe_info(const vector<sqlite3_int64> &ids) {
+  // Titles are returned in the order of the ids. Recipes which do not exist any more are skipped.
+  prepare(m_get_title);
+  vector<pair<sqlite3_int64, string> > infos;
+  for (vector<sqlite3_int64>::const_iterator id=ids.begin(); id!=ids.end(); id++) {
+    int result = sqlite3_bind_int64(m_get_title, 1, *id);
+    check(result, "Error binding recipe id: ");
+    result = sqlite3_step(m_get_title);
+    check(result, "Error getting recipe title: ");
+    if (result == SQLITE_ROW)
+      infos.push_back(make_pair(*id, string((const char *)sqlite3_column_text(m_get_title, 0))));
+    result = sqlite3_reset(m_get_title);
+    check(result, "Error resetting statement for getting recipe title: ");
+  };
+  return infos;
+}
+
+vector<pair<sqlite3_int64, string> > Database::recipe_info(sqlite3_int64 after_id, const char *after_title, int count) {
+  StringPool pool;
+  vector<pair<sqlite3_int64, string_view> > infos = recipe_info(after_id, after_title, count, pool);
+  return vector<pair<sqlite3_int64, string> >(infos.begin(), infos.end());
+}
+
+vector<pair<sqlite3_int64, string_view> > Database::recipe_info(sqlite3_int64 after_id, const char *after_title, int count,
+                                                                StringPool &pool) {
+  // Keyset pagination continuing after the given recipe. Use an id of zero and an empty title to get the first page.
+  sqlite3_stmt *&statement = m_all_selected ? m_get_all_page : m_get_page;
+  prepare(statement);
+  int result = sqlite3_bind_int64(statement, 1, after_id);
+  check(result, "Error binding recipe id: ");
+  string key = sort_key(after_title, m_language.c_str());
+  result = sqlite3_bind_blob(statement, 2, key.data(), key.size(), SQLITE_STATIC);
+  check(result, "Error binding sort key of recipe title: ");
+  result = sqlite3_bind_int(statement, 3, count);
+  check(result, "Error binding number of recipes: ");
+  vector<pair<sqlite3_int64, string_view> > infos;
+  while (true) {
+    result = sqlite3_step(statement);
+    check(result, "Error getting page of recipe information: ");
+    if (result != SQLITE_ROW)
+      break;
+    infos.push_back(make_pair(sqlite3_column_int64(statement, 0), pool.add((const char *)sqlite3_column_text(statement, 1))));
+  };
+  result = sqlite3_reset(statement);
+  check(result, "Error resetting statement for getting page of recipe info: ");
+  return infos;
+}
+
 vector<string> Database::categories(void) {
+  sqlite3_stmt *&statement = m_all_selected ? m_all_category_list : m_category_list;
+  prepare(statement);
   int result;
   vector<string> categories;
   while (true) {
-    result = sqlite3_step(m_category_list);
+    result = sqlite3_step(statement);
     check(result, "Error getting categories: ");
     if (result != SQLITE_ROW)
       break;
-    categories.push_back((const char *)sqlite3_column_text(m_category_list, 0));
+    categories.push_back((const char *)sqlite3_column_text(statement, 0));
   };
-  result = sqlite3_reset(m_category_list);
+  result = sqlite3_reset(statement);
   check(result, "Error resetting statement for getting categories: ");
   return categories;
 }
 
 vector<pair<string, int> > Database::categories_and_counts(void) {
+  prepare(m_category_and_count_list);
   int result;
   vector<pair<string, int> > categories_and_counts;
   while (true) {
@@ -512,17 +1056,68 @@ vector<pair<string, int> > Database::categories_and_counts(void) {
   return categories_and_counts;
 }
 
-void Database::select_all(void) {
+void Database::create_selection(void) {
   int result;
   result = sqlite3_exec(m_db, "DROP TABLE IF EXISTS selection;", NULL, NULL, NULL);
   check(result, "Error dropping selection table: ");
   result = sqlite3_exec(m_db, "CREATE TEMPORARY TABLE selection(id INTEGER PRIMARY KEY);", NULL, NULL, NULL);
   check(result, "Error creating selection table: ");
-  result = sqlite3_exec(m_db, "INSERT INTO selection SELECT id FROM recipes;", NULL, NULL, NULL);
+}
+
+void Database::count_selection(void) {
+  // Count the selected recipes in bulk and let triggers apply the changes afterwards.
+  int result = sqlite3_exec(m_db,
+    "CREATE TEMPORARY TABLE IF NOT EXISTS selectionsize(size INTEGER NOT NULL);\n"
+    "CREATE TEMPORARY TABLE IF NOT EXISTS categorycounts(categoryid INTEGER PRIMARY KEY, count INTEGER NOT NULL);\n"
+    "DELETE FROM selectionsize;\n"
+    "INSERT INTO selectionsize SELECT COUNT(id) FROM selection;\n"
+    "DELETE FROM categorycounts;\n"
+    "INSERT INTO categorycounts SELECT categoryid, COUNT(recipeid) FROM category, selection WHERE recipeid = selection.id "
+    "GROUP BY categoryid;\n"
+    "CREATE TEMPORARY TRIGGER selection_insert AFTER INSERT ON selection BEGIN "
+    "UPDATE selectionsize SET size = size + 1; "
+    "INSERT INTO categorycounts SELECT categoryid, 1 FROM category WHERE recipeid = NEW.id AND true "
+    "ON CONFLICT(categoryid) DO UPDATE SET count = count + 1; END;\n"
+    "CREATE TEMPORARY TRIGGER selection_delete AFTER DELETE ON selection BEGIN "
+    "UPDATE selectionsize SET size = size - 1; "
+    "UPDATE categorycounts SET count = count - 1 WHERE categoryid IN (SELECT categoryid FROM category WHERE recipeid = OLD.id); "
+    "END;\n"
+    "CREATE TEMPORARY TRIGGER IF NOT EXISTS selected_category_insert AFTER INSERT ON category "
+    "WHEN EXISTS (SELECT id FROM selection WHERE id = NEW.recipeid) BEGIN "
+    "INSERT INTO categorycounts VALUES(NEW.categoryid, 1) ON CONFLICT(categoryid) DO UPDATE SET count = count + 1; END;\n"
+    "CREATE TEMPORARY TRIGGER IF NOT EXISTS selected_category_delete AFTER DELETE ON category "
+    "WHEN EXISTS (SELECT id FROM selection WHERE id = OLD.recipeid) BEGIN "
+    "UPDATE categorycounts SET count = count - 1 WHERE categoryid = OLD.categoryid; END;\n",
+    NULL, NULL, NULL);
+  check(result, "Error counting selected recipes: ");
+}
+
+void Database::select_all(void) {
+  // The selection table is only filled when the selection is filtered. The previous selection and the triggers maintaining
+  // its category counts are dropped so that the counts do not go stale while all recipes are selected.
+  int result = sqlite3_exec(m_db,
+    "DROP TRIGGER IF EXISTS selected_category_insert;\n"
+    "DROP TRIGGER IF EXISTS selected_category_delete;\n"
+    "DROP TABLE IF EXISTS selection;\n"
+    "DROP TABLE IF EXISTS categorycounts;\n",
+    NULL, NULL, NULL);
+  check(result, "Error resetting selection: ");
+  m_all_selected = true;
+}
+
+void Database::materialize_selection(void) {
+  if (!m_all_selected)
+    return;
+  create_selection();
+  int result = sqlite3_exec(m_db, "INSERT INTO selection SELECT id FROM recipes;", NULL, NULL, NULL);
   check(result, "Error selecting recipes: ");
+  count_selection();
+  m_all_selected = false;
 }
 
 void Database::select_by_title(const char *title) {
+  materialize_selection();
+  prepare(m_select_title);
   int result;
   result = sqlite3_bind_text(m_select_title, 1, title, -1, SQLITE_STATIC);
   check(result, "Error binding title string: ");
@@ -533,6 +1128,8 @@ void Database::select_by_title(const char *title) {
 }
 
 void Database::select_by_category(const char *category) {
+  materialize_selection();
+  prepare(m_select_category);
   int result;
   result = sqlite3_bind_text(m_select_category, 1, category, -1, SQLITE_STATIC);
   check(result, "Error binding category string: ");
@@ -543,6 +1140,8 @@ void Database::select_by_category(const char *category) {
 }
 
 void Database::select_by_no_category(const char *category) {
+  materialize_selection();
+  prepare(m_select_no_category);
   int result;
   result = sqlite3_bind_text(m_select_no_category, 1, category, -1, SQLITE_STATIC);
   check(result, "Error binding category string: ");
@@ -553,6 +1152,8 @@ void Database::select_by_no_category(const char *category) {
 }
 
 void Database::select_by_ingredient(const char *ingredient) {
+  materialize_selection();
+  prepare(m_select_ingredient);
   int result;
   result = sqlite3_bind_text(m_select_ingredient, 1, ingredient, -1, SQLITE_STATIC);
   check(result, "Error binding ingredient string: ");
@@ -563,6 +1164,8 @@ void Database::select_by_ingredient(const char *ingredient) {
 }
 
 void Database::select_by_no_ingredient(const char *ingredient) {
+  materialize_selection();
+  prepare(m_select_no_ingredient);
   int result;
   result = sqlite3_bind_text(m_select_no_ingredient, 1, ingredient, -1, SQLITE_STATIC);
   check(result, "Error binding ingredient string: ");
@@ -573,6 +1176,17 @@ void Database::select_by_no_ingredient(const char *ingredient) {
 }
 
 Recipe Database::fetch_recipe(sqlite3_int64 id) {
+  int cookbook = cookbook_of(id);
+  if (cookbook > 0) {
+    if (cookbook > (int)m_cookbooks.size()) {
+      ostringstream s;
+      s << "Could not find cookbook of recipe with id " << id << ".";
+      throw database_exception(s.str());
+    };
+    return m_cookbooks[cookbook - 1]->fetch_recipe(local_id(id));
+  };
+  prepare(m_get_header);
+  prepare(m_get_categories);
   int result;
   Recipe recipe;
   // Retrieve recipe header.
@@ -581,6 +1195,7 @@ Recipe Database::fetch_recipe(sqlite3_int64 id) {
   result = sqlite3_step(m_get_header);
   check(result, "Error retrieving recipe header: ");
   if (result != SQLITE_ROW) {
+    sqlite3_reset(m_get_header);
     ostringstream s;
     s << "Could not find recipe with id " << id << ".";
     throw database_exception(s.str());
@@ -588,6 +1203,15 @@ Recipe Database::fetch_recipe(sqlite3_int64 id) {
   recipe.set_title((const char *)sqlite3_column_text(m_get_header, 0));
   recipe.set_servings(sqlite3_column_int(m_get_header, 1));
   recipe.set_servings_unit((const char *)sqlite3_column_text(m_get_header, 2));
+  bool compact = sqlite3_column_type(m_get_header, 3) != SQLITE_NULL;
+  if (compact) {
+    try {
+      blob_to_recipe_body((const char *)sqlite3_column_blob(m_get_header, 3), sqlite3_column_bytes(m_get_header, 3), recipe);
+    } catch (blob_exception &e) {
+      sqlite3_reset(m_get_header);
+      throw database_exception(e.what());
+    };
+  };
   result = sqlite3_reset(m_get_header);
   check(result, "Error resetting recipe header query: ");
   // Retrieve recipe categories.
@@ -602,6 +1226,17 @@ Recipe Database::fetch_recipe(sqlite3_int64 id) {
   };
   result = sqlite3_reset(m_get_categories);
   check(result, "Error resetting recipe categories query: ");
+  if (!compact)
+    fetch_recipe_rows(id, recipe);
+  return recipe;
+}
+
+void Database::fetch_recipe_rows(sqlite3_int64 id, Recipe &recipe) {
+  prepare(m_get_ingredients);
+  prepare(m_get_ingredient_section);
+  prepare(m_get_instructions);
+  prepare(m_get_instruction_section);
+  int result;
   // Retrieve recipe ingredients.
   result = sqlite3_bind_int64(m_get_ingredients, 1, id);
   check(result, "Error binding recipe id for ingredients: ");
@@ -615,7 +1250,7 @@ Recipe Database::fetch_recipe(sqlite3_int64 id) {
     ingredient.set_amount_numerator(sqlite3_column_int(m_get_ingredients, 1));
     ingredient.set_amount_denominator(sqlite3_column_int(m_get_ingredients, 2));
     ingredient.set_amount_float(sqlite3_column_double(m_get_ingredients, 3));
-    ingredient.set_unit((const char *)sqlite3_column_text(m_get_ingredients, 4));
+    ingredient.set_unit((Unit)sqlite3_column_int(m_get_ingredients, 4));
     ingredient.add_text((const char *)sqlite3_column_text(m_get_ingredients, 5));
     recipe.add_ingredient(ingredient);
   };
@@ -658,7 +1293,6 @@ Recipe Database::fetch_recipe(sqlite3_int64 id) {
   };
   result = sqlite3_reset(m_get_instruction_section);
   check(result, "Error resetting recipe instruction section query: ");
-  return recipe;
 }
 
 vector<Recipe> Database::fetch_recipes(const vector<sqlite3_int64> &ids) {
@@ -669,91 +1303,367 @@ vector<Recipe> Database::fetch_recipes(const vector<sqlite3_int64> &ids) {
   return result;
 }
 
+static string file_uri(const char *filename) {
+  string result = "file:";
+  for (const char *c=filename; *c; c++) {
+    if (*c == '%' || *c == '?' || *c == '#') {
+      char escape[4];
+      snprintf(escape, sizeof(escape), "%%%02x", (unsigned char)*c);
+      result += escape;
+    } else
+      result += *c;
+  };
+  return result + "?mode=ro";
+}
+
+shared_ptr<Database> Database::open_cookbook(const char *filename) {
+  // Other databases are opened read-only, so they need to have the current version already.
+  shared_ptr<Database> cookbook(new Database);
+  cookbook->open(filename, true);
+  int version = cookbook->user_version();
+  if (version != 15) {
+    ostringstream s;
+    s << "Cookbook " << filename << " has database version " << version << " instead of 15. Open it with this release of "
+         "the software first.";
+    throw database_exception(s.str());
+  };
+  return cookbook;
+}
+
+int Database::attach_cookbook(const char *filename) {
+  // The cookbook is opened separately for fetching recipes because it has its own dictionary of instruction phrases.
+  shared_ptr<Database> cookbook = open_cookbook(filename);
+  // The cookbook is attached read-only as well so that all cookbooks can be searched with a single statement.
+  int number = m_cookbooks.size() + 1;
+  ostringstream sql;
+  sql << "ATTACH DATABASE ?001 AS cookbook" << number << ";";
+  sqlite3_stmt *statement;
+  int result = sqlite3_prepare_v2(m_db, sql.str().c_str(), -1, &statement, NULL);
+  check(result, "Error preparing statement for attaching cookbook: ");
+  string uri = file_uri(filename);
+  result = sqlite3_bind_text(statement, 1, uri.c_str(), -1, SQLITE_STATIC);
+  if (result == SQLITE_OK)
+    result = sqlite3_step(statement);
+  sqlite3_finalize(statement);
+  check(result, "Error attaching cookbook: ");
+  m_cookbooks.push_back(cookbook);
+  return number;
+}
+
+// SQL function decompressing instructions using the dictionary of the database being merged.
+static void anymeal_merge_text(sqlite3_context *context, int, sqlite3_value **argv) {
+  if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+    sqlite3_result_value(context, argv[0]);
+    return;
+  };
+  Database *source = (Database *)sqlite3_user_data(context);
+  try {
+    string text = source->decompress((const char *)sqlite3_value_blob(argv[0]), sqlite3_value_bytes(argv[0]));
+    sqlite3_result_text(context, text.data(), text.size(), SQLITE_TRANSIENT);
+  } catch (exception &e) {
+    sqlite3_result_error(context, e.what(), -1);
+  };
+}
+
+// SQL function computing the fingerprint of a recipe of the database being merged.
+static void anymeal_merge_fingerprint(sqlite3_context *context, int, sqlite3_value **argv) {
+  Database *source = (Database *)sqlite3_user_data(context);
+  try {
+    Recipe recipe = source->fetch_recipe(sqlite3_value_int64(argv[0]));
+    sqlite3_result_int64(context, (sqlite3_int64)recipe_fingerprint(recipe));
+  } catch (exception &e) {
+    sqlite3_result_error(context, e.what(), -1);
+  };
+}
+
+int Database::merge(const char *filename, bool skip_duplicates) {
+  // Recipes are copied in bulk. Temporary tables map the ids of the other database to the ids of this one.
+  shared_ptr<Database> source = open_cookbook(filename);
+  int result = sqlite3_create_function_v2(m_db, "anymeal_merge_text", 1, SQLITE_UTF8, source.get(), &anymeal_merge_text,
+                                          NULL, NULL, NULL);
+  check(result, "Error registering function for decompressing merged text: ");
+  // The other database is read-only, so fingerprints missing there are computed while comparing.
+  result = sqlite3_create_function_v2(m_db, "anymeal_merge_fingerprint", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, source.get(),
+                                      &anymeal_merge_fingerprint, NULL, NULL, NULL);
+  check(result, "Error registering function for fingerprinting merged recipes: ");
+  sqlite3_stmt *attach;
+  result = sqlite3_prepare_v2(m_db, "ATTACH DATABASE ?001 AS mergesource;", -1, &attach, NULL);
+  check(result, "Error preparing statement for attaching database to merge: ");
+  string uri = file_uri(filename);
+  result = sqlite3_bind_text(attach, 1, uri.c_str(), -1, SQLITE_STATIC);
+  if (result == SQLITE_OK)
+    result = sqlite3_step(attach);
+  sqlite3_finalize(attach);
+  check(result, "Error attaching database to merge: ");
+  int count = 0;
+  try {
+    begin();
+    try {
+      result = sqlite3_exec(m_db,
+        "CREATE TEMPORARY TABLE mergerecipes(oldid INTEGER PRIMARY KEY, newid INTEGER NOT NULL, fingerprint INTEGER);\n"
+        "CREATE TEMPORARY TABLE mergecategories(oldid INTEGER PRIMARY KEY, newid INTEGER NOT NULL);\n"
+        "CREATE TEMPORARY TABLE mergeingredients(oldid INTEGER PRIMARY KEY, newid INTEGER NOT NULL);\n",
+        NULL, NULL, NULL);
+      check(result, "Error creating tables for mapping ids of merged recipes: ");
+      // New recipe ids are appended after the highest id of this database.
+      if (skip_duplicates)
+        result = sqlite3_exec(m_db,
+          "INSERT INTO mergerecipes SELECT oldid, oldid + (SELECT IFNULL(MAX(id), 0) FROM main.recipes), fingerprint FROM "
+          "(SELECT MIN(id) AS oldid, fingerprint FROM "
+          "(SELECT id, IFNULL(fingerprint, anymeal_merge_fingerprint(id)) AS fingerprint FROM mergesource.recipes) "
+          "WHERE fingerprint NOT IN (SELECT fingerprint FROM main.recipes WHERE fingerprint IS NOT NULL) GROUP BY fingerprint);\n",
+          NULL, NULL, NULL);
+      else
+        result = sqlite3_exec(m_db,
+          "INSERT INTO mergerecipes SELECT id, id + (SELECT IFNULL(MAX(id), 0) FROM main.recipes), "
+          "IFNULL(fingerprint, anymeal_merge_fingerprint(id)) FROM mergesource.recipes;\n",
+          NULL, NULL, NULL);
+      check(result, "Error selecting recipes to merge: ");
+      result = sqlite3_exec(m_db,
+        "INSERT INTO main.recipes(id, title, servings, servingsunit, sortkey, fingerprint) "
+        "SELECT newid, title, servings, servingsunit, anymeal_sortkey(title), r.fingerprint "
+        "FROM mergesource.recipes AS s, mergerecipes AS r WHERE s.id = r.oldid;\n"
+        "INSERT OR IGNORE INTO main.categories(name) SELECT DISTINCT name FROM mergesource.categories AS c, "
+        "mergesource.category AS s, mergerecipes AS r WHERE c.id = s.categoryid AND s.recipeid = r.oldid;\n"
+        "INSERT INTO mergecategories SELECT s.id, m.id FROM mergesource.categories AS s, main.categories AS m "
+        "WHERE s.name = m.name;\n"
+        "INSERT INTO main.category SELECT r.newid, c.newid FROM mergesource.category AS s, mergerecipes AS r, "
+        "mergecategories AS c WHERE s.recipeid = r.oldid AND s.categoryid = c.oldid;\n"
+        "INSERT OR IGNORE INTO main.ingredients(name) SELECT DISTINCT name FROM mergesource.ingredients AS i, "
+        "mergesource.ingredientindex AS s, mergerecipes AS r WHERE i.id = s.ingredientid AND s.recipeid = r.oldid;\n"
+        "INSERT INTO mergeingredients SELECT s.id, m.id FROM mergesource.ingredients AS s, main.ingredients AS m "
+        "WHERE s.name = m.name;\n"
+        "INSERT OR IGNORE INTO main.ingredienttokens SELECT token, i.newid FROM mergesource.ingredienttokens AS s, "
+        "mergeingredients AS i WHERE s.ingredientid = i.oldid;\n"
+        "INSERT INTO main.ingredient SELECT r.newid, line, amountint, amountnum, amountdenom, amountfloat, unit, i.newid "
+        "FROM mergesource.ingredient AS s, mergerecipes AS r, mergeingredients AS i "
+        "WHERE s.recipeid = r.oldid AND s.ingredientid = i.oldid;\n"
+        "INSERT INTO main.recipeingredient SELECT i.newid, r.newid FROM mergesource.recipeingredient AS s, mergerecipes AS r, "
+        "mergeingredients AS i WHERE s.recipeid = r.oldid AND s.ingredientid = i.oldid;\n"
+        "INSERT INTO main.ingredientsection SELECT r.newid, line, title FROM mergesource.ingredientsection AS s, "
+        "mergerecipes AS r WHERE s.recipeid = r.oldid;\n"
+        "INSERT INTO main.instruction SELECT r.newid, line, anymeal_merge_text(txt) FROM mergesource.instruction AS s, "
+        "mergerecipes AS r WHERE s.recipeid = r.oldid;\n"
+        "INSERT INTO main.instructionsection SELECT r.newid, line, title FROM mergesource.instructionsection AS s, "
+        "mergerecipes AS r WHERE s.recipeid = r.oldid;\n"
+        "INSERT INTO main.recipebody SELECT r.newid, body FROM mergesource.recipebody AS s, mergerecipes AS r "
+        "WHERE s.recipeid = r.oldid;\n"
+        "INSERT INTO main.recipesearch(rowid, title, ingredients, instructions) SELECT r.newid, title, ingredients, instructions "
+        "FROM mergesource.recipesearch AS s, mergerecipes AS r WHERE s.rowid = r.oldid;\n",
+        NULL, NULL, NULL);
+      check(result, "Error copying merged recipes: ");
+      sqlite3_stmt *query;
+      result = sqlite3_prepare_v2(m_db, "SELECT COUNT(*) FROM mergerecipes;", -1, &query, NULL);
+      check(result, "Error preparing query for number of merged recipes: ");
+      result = sqlite3_step(query);
+      if (result == SQLITE_ROW)
+        count = sqlite3_column_int(query, 0);
+      sqlite3_finalize(query);
+      check(result, "Error counting merged recipes: ");
+      result = sqlite3_exec(m_db, "DROP TABLE mergerecipes; DROP TABLE mergecategories; DROP TABLE mergeingredients;",
+                            NULL, NULL, NULL);
+      check(result, "Error dropping tables for mapping ids of merged recipes: ");
+      commit();
+    } catch (exception &) {
+      rollback();
+      throw;
+    };
+  } catch (exception &) {
+    sqlite3_exec(m_db, "DETACH DATABASE mergesource;", NULL, NULL, NULL);
+    sqlite3_create_function_v2(m_db, "anymeal_merge_text", 1, SQLITE_UTF8, NULL, NULL, NULL, NULL, NULL);
+    sqlite3_create_function_v2(m_db, "anymeal_merge_fingerprint", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, NULL, NULL, NULL,
+                               NULL);
+    throw;
+  };
+  result = sqlite3_exec(m_db, "DETACH DATABASE mergesource;", NULL, NULL, NULL);
+  check(result, "Error detaching merged database: ");
+  // The functions refer to the other database which is closed now.
+  result = sqlite3_create_function_v2(m_db, "anymeal_merge_text", 1, SQLITE_UTF8, NULL, NULL, NULL, NULL, NULL);
+  check(result, "Error removing function for decompressing merged text: ");
+  result = sqlite3_create_function_v2(m_db, "anymeal_merge_fingerprint", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, NULL, NULL,
+                                      NULL, NULL);
+  check(result, "Error removing function for fingerprinting merged recipes: ");
+  return count;
+}
+
+vector<string> Database::cookbook_conditions(query_t query, vector<string> &parameters) {
+  // The query is compiled once for each attached cookbook. The main database uses the current selection instead.
+  vector<string> conditions;
+  for (int i=1; i<=(int)m_cookbooks.size(); i++) {
+    ostringstream schema;
+    schema << "cookbook" << i << ".";
+    conditions.push_back(query_to_sql(query, parameters, schema.str()));
+  };
+  return conditions;
+}
+
+vector<pair<sqlite3_int64, string> > Database::search_cookbooks(query_t query, sqlite3_int64 after_id, const char *after_title,
+                                                               int count) {
+  StringPool pool;
+  vector<pair<sqlite3_int64, string_view> > infos = search_cookbooks(query, after_id, after_title, count, pool);
+  return vector<pair<sqlite3_int64, string> >(infos.begin(), infos.end());
+}
+
+vector<pair<sqlite3_int64, string_view> > Database::search_cookbooks(query_t query, sqlite3_int64 after_id, const char *after_title,
+                                                                    int count, StringPool &pool) {
+  // Keyset pagination over the selected recipes and the matching recipes of all attached cookbooks using a single compound
+  // statement.
+  query = simplify_query(query);
+  vector<string> parameters;
+  vector<string> conditions = cookbook_conditions(query, parameters);
+  // The sort key and id of the previous recipe and the page size are passed after the query terms.
+  int key = parameters.size() + 1;
+  ostringstream sql;
+  sql << "SELECT id, title, sortkey FROM main.recipes WHERE (sortkey, id) > (?" << key << ", ?" << key + 1 << ")";
+  if (!m_all_selected)
+    sql << " AND id IN (SELECT id FROM selection)";
+  for (int i=1; i<=(int)m_cookbooks.size(); i++) {
+    // The sort keys stored in a cookbook may have been computed for another language.
+    sql << " UNION ALL SELECT " << cookbook_id(i, 0) << " + id AS id, title, anymeal_sortkey(title) AS sortkey FROM cookbook" << i
+        << ".recipes WHERE (anymeal_sortkey(title), " << cookbook_id(i, 0) << " + id) > (?" << key << ", ?" << key + 1 << ") AND "
+        << conditions[i - 1];
+  };
+  sql << " ORDER BY sortkey, id LIMIT ?" << key + 2 << ";";
+  sqlite3_stmt *statement;
+  int result = sqlite3_prepare_v2(m_db, sql.str().c_str(), -1, &statement, NULL);
+  check(result, "Error preparing statement for searching cookbooks: ");
+  for (int i=0; i<(int)parameters.size(); i++) {
+    result = sqlite3_bind_text(statement, i + 1, parameters[i].c_str(), -1, SQLITE_TRANSIENT);
+    if (result != SQLITE_OK) {
+      sqlite3_finalize(statement);
+      check(result, "Error binding query term: ");
+    };
+  };
+  string after_key = sort_key(after_title, m_language.c_str());
+  result = sqlite3_bind_blob(statement, key, after_key.data(), after_key.size(), SQLITE_STATIC);
+  if (result == SQLITE_OK)
+    result = sqlite3_bind_int64(statement, key + 1, after_id);
+  if (result == SQLITE_OK)
+    result = sqlite3_bind_int(statement, key + 2, count);
+  if (result != SQLITE_OK) {
+    sqlite3_finalize(statement);
+    check(result, "Error binding page of cookbook search: ");
+  };
+  vector<pair<sqlite3_int64, string_view> > infos;
+  while (true) {
+    result = sqlite3_step(statement);
+    if (result != SQLITE_ROW)
+      break;
+    infos.push_back(make_pair(sqlite3_column_int64(statement, 0), pool.add((const char *)sqlite3_column_text(statement, 1))));
+  };
+  sqlite3_finalize(statement);
+  check(result, "Error searching cookbooks: ");
+  return infos;
+}
+
+vector<pair<sqlite3_int64, string> > Database::search_cookbooks(const char *text, sqlite3_int64 after_id, const char *after_title,
+                                                               int count) {
+  return search_cookbooks(parse_query(text), after_id, after_title, count);
+}
+
+int Database::count_cookbooks(query_t query) {
+  // Number of recipes of the attached cookbooks matching the query.
+  query = simplify_query(query);
+  if (m_cookbooks.empty())
+    return 0;
+  vector<string> parameters;
+  vector<string> conditions = cookbook_conditions(query, parameters);
+  ostringstream sql;
+  sql << "SELECT";
+  for (int i=1; i<=(int)m_cookbooks.size(); i++) {
+    if (i > 1)
+      sql << " +";
+    sql << " (SELECT COUNT(*) FROM cookbook" << i << ".recipes WHERE " << conditions[i - 1] << ")";
+  };
+  sql << ";";
+  sqlite3_stmt *statement;
+  int result = sqlite3_prepare_v2(m_db, sql.str().c_str(), -1, &statement, NULL);
+  check(result, "Error preparing statement for counting recipes of cookbooks: ");
+  for (int i=0; i<(int)parameters.size(); i++) {
+    result = sqlite3_bind_text(statement, i + 1, parameters[i].c_str(), -1, SQLITE_TRANSIENT);
+    if (result != SQLITE_OK) {
+      sqlite3_finalize(statement);
+      check(result, "Error binding query term: ");
+    };
+  };
+  int count = 0;
+  result = sqlite3_step(statement);
+  if (result == SQLITE_ROW) {
+    count = sqlite3_column_int(statement, 0);
+    result = sqlite3_step(statement);
+  };
+  sqlite3_finalize(statement);
+  check(result, "Error counting recipes of cookbooks: ");
+  return count;
+}
+
+void Database::stage_ids(const vector<sqlite3_int64> &ids) {
+  prepare(m_clear_ids);
+  prepare(m_stage_id);
+  int result = sqlite3_step(m_clear_ids);
+  check(result, "Error clearing staged recipe ids: ");
+  result = sqlite3_reset(m_clear_ids);
+  check(result, "Error resetting statement for clearing staged recipe ids: ");
+  for (vector<sqlite3_int64>::const_iterator id=ids.begin(); id!=ids.end(); id++) {
+    result = sqlite3_bind_int64(m_stage_id, 1, *id);
+    check(result, "Error binding id for staging recipe: ");
+    result = sqlite3_step(m_stage_id);
+    check(result, "Error staging recipe id: ");
+    result = sqlite3_reset(m_stage_id);
+    check(result, "Error resetting statement for staging recipe id: ");
+  };
+}
+
 void Database::delete_recipes(const vector<sqlite3_int64> &ids) {
+  prepare(m_delete_staged_recipes);
+  stage_ids(ids);
   int result;
-  for (vector<sqlite3_int64>::const_iterator id=ids.begin(); id!=ids.end(); id++) {
-    // Delete categories.
-    result = sqlite3_bind_int64(m_delete_categories, 1, *id);
-    check(result, "Error binding id for deleting categories: ");
-    result = sqlite3_step(m_delete_categories);
-    check(result, "Error deleting categories: ");
-    result = sqlite3_reset(m_delete_categories);
-    check(result, "Error resetting statement for deleting categories: ");
-    // Delete ingredients.
-    result = sqlite3_bind_int64(m_delete_ingredients, 1, *id);
-    check(result, "Error binding id for deleting ingredients: ");
-    result = sqlite3_step(m_delete_ingredients);
-    check(result, "Error deleting ingredients: ");
-    result = sqlite3_reset(m_delete_ingredients);
-    check(result, "Error resetting statement for deleting ingredients: ");
-    // Delete instructions.
-    result = sqlite3_bind_int64(m_delete_instructions, 1, *id);
-    check(result, "Error binding id for deleting instructions: ");
-    result = sqlite3_step(m_delete_instructions);
-    check(result, "Error deleting instructions: ");
-    result = sqlite3_reset(m_delete_instructions);
-    check(result, "Error resetting statement for deleting instructions: ");
-    // Delete ingredient sections.
-    result = sqlite3_bind_int64(m_delete_ingredient_sections, 1, *id);
-    check(result, "Error binding id for deleting ingredient sections: ");
-    result = sqlite3_step(m_delete_ingredient_sections);
-    check(result, "Error deleting ingredient sections: ");
-    result = sqlite3_reset(m_delete_ingredient_sections);
-    check(result, "Error resetting statement for deleting ingredient sections: ");
-    // Delete instruction sections.
-    result = sqlite3_bind_int64(m_delete_instruction_sections, 1, *id);
-    check(result, "Error binding id for deleting instruction sections: ");
-    result = sqlite3_step(m_delete_instruction_sections);
-    check(result, "Error deleting instruction sections: ");
-    result = sqlite3_reset(m_delete_instruction_sections);
-    check(result, "Error resetting statement for deleting instruction sections: ");
-    // Delete selections.
-    result = sqlite3_bind_int64(m_delete_selection, 1, *id);
-    check(result, "Error binding id for deleting selection: ");
-    result = sqlite3_step(m_delete_selection);
-    check(result, "Error deleting selection: ");
-    result = sqlite3_reset(m_delete_selection);
-    check(result, "Error resetting statement for deleting selection: ");
-    // Delete recipe.
-    result = sqlite3_bind_int64(m_delete_recipe, 1, *id);
-    check(result, "Error binding id for deleting recipe: ");
-    result = sqlite3_step(m_delete_recipe);
-    check(result, "Error deleting recipe: ");
-    result = sqlite3_reset(m_delete_recipe);
-    check(result, "Error resetting statement for deleting recipe: ");
+  // Remove recipes from selection.
+  if (!m_all_selected) {
+    prepare(m_unselect_staged);
+    result = sqlite3_step(m_unselect_staged);
+    check(result, "Error deleting recipes from selection: ");
+    result = sqlite3_reset(m_unselect_staged);
+    check(result, "Error resetting statement for deleting recipes from selection: ");
   };
+  // Delete recipes. Categories, ingredients, instructions, and sections are removed by cascading foreign keys.
+  result = sqlite3_step(m_delete_staged_recipes);
+  check(result, "Error deleting recipes: ");
+  result = sqlite3_reset(m_delete_staged_recipes);
+  check(result, "Error resetting statement for deleting recipes: ");
 }
 
 void Database::add_recipes_to_category(const vector<sqlite3_int64> &ids, const char *category) {
+  prepare(m_add_staged_to_category);
   // Create category.
   add_category(category);
+  sqlite3_int64 category_id = get_category_id(category);
   // Add recipes to category.
-  for (vector<sqlite3_int64>::const_iterator id=ids.begin(); id!=ids.end(); id++) {
-    int result = sqlite3_bind_int64(m_recipe_category, 1, *id);
-    check(result, "Error binding recipe id: ");
-    result = sqlite3_bind_text(m_recipe_category, 2, category, -1, SQLITE_STATIC);
-    check(result, "Error binding category name: ");
-    result = sqlite3_step(m_recipe_category);
-    check(result, "Error adding recipe category: ");
-    result = sqlite3_reset(m_recipe_category);
-    check(result, "Error resetting recipe category statement: ");
-  };
+  stage_ids(ids);
+  int result = sqlite3_bind_int64(m_add_staged_to_category, 1, category_id);
+  check(result, "Error binding category id: ");
+  result = sqlite3_step(m_add_staged_to_category);
+  check(result, "Error adding recipes to category: ");
+  result = sqlite3_reset(m_add_staged_to_category);
+  check(result, "Error resetting statement for adding recipes to category: ");
 }
 
 void Database::remove_recipes_from_category(const vector<sqlite3_int64> &ids, const char *category) {
-  for (vector<sqlite3_int64>::const_iterator id=ids.begin(); id!=ids.end(); id++) {
-    int result = sqlite3_bind_int64(m_remove_recipe_category, 1, *id);
-    check(result, "Error binding recipe id: ");
-    result = sqlite3_bind_text(m_remove_recipe_category, 2, category, -1, SQLITE_STATIC);
-    check(result, "Error binding category name: ");
-    result = sqlite3_step(m_remove_recipe_category);
-    check(result, "Error adding recipe category: ");
-    result = sqlite3_reset(m_remove_recipe_category);
-    check(result, "Error resetting recipe category statement: ");
-  };
+  prepare(m_remove_staged_from_category);
+  sqlite3_int64 category_id = get_category_id(category);
+  if (category_id == 0)
+    return;
+  stage_ids(ids);
+  int result = sqlite3_bind_int64(m_remove_staged_from_category, 1, category_id);
+  check(result, "Error binding category id: ");
+  result = sqlite3_step(m_remove_staged_from_category);
+  check(result, "Error removing recipes from category: ");
+  result = sqlite3_reset(m_remove_staged_from_category);
+  check(result, "Error resetting statement for removing recipes from category: ");
 }
 
 void Database::rename_category(const char *current_name, const char *new_name) {
+  prepare(m_rename_category);
   int result = sqlite3_bind_text(m_rename_category, 1, current_name, -1, SQLITE_STATIC);
   check(result, "Error binding old category name: ");
   result = sqlite3_bind_text(m_rename_category, 2, new_name, -1, SQLITE_STATIC);
@@ -766,6 +1676,7 @@ void Database::rename_category(const char *current_name, const char *new_name) {
 
 sqlite3_int64 Database::get_category_id(const char *name)
 {
+  prepare(m_get_category_id);
   sqlite3_int64 category_id = 0;
   int result = sqlite3_bind_text(m_get_category_id, 1, name, -1, SQLITE_STATIC);
   check(result, "Error binding old category name: ");
@@ -779,6 +1690,7 @@ sqlite3_int64 Database::get_category_id(const char *name)
 }
 
 void Database::merge_category(const char *category, const char *target) {
+  prepare(m_merge_category);
   sqlite3_int64 category_id = get_category_id(category);
   sqlite3_int64 target_id = get_category_id(target);
   int result = sqlite3_bind_int64(m_merge_category, 1, category_id);
@@ -793,6 +1705,8 @@ void Database::merge_category(const char *category, const char *target) {
 }
 
 void Database::delete_category(const char *category) {
+  prepare(m_delete_recipe_category);
+  prepare(m_delete_category);
   sqlite3_int64 category_id = get_category_id(category);
   int result = sqlite3_bind_int64(m_delete_recipe_category, 1, category_id);
   check(result, "Error binding category id for deleting from recipe: ");
@@ -809,6 +1723,8 @@ void Database::delete_category(const char *category) {
 }
 
 void Database::garbage_collect(void) {
+  prepare(m_clean_categories);
+  prepare(m_clean_ingredients);
   int result;
   // Clean up categories.
   result = sqlite3_step(m_clean_categories);
@@ -821,3 +1737,653 @@ void Database::garbage_collect(void) {
   result = sqlite3_reset(m_clean_ingredients);
   check(result, "Error resetting statement for cleaning ingredients: ");
 }
+
+bool Database::incremental_vacuum_enabled(void) {
+  sqlite3_stmt *query;
+  int result = sqlite3_prepare_v2(m_db, "PRAGMA auto_vacuum;", -1, &query, NULL);
+  check(result, "Error preparing statement for querying vacuum mode: ");
+  int mode = 0;
+  result = sqlite3_step(query);
+  if (result == SQLITE_ROW)
+    mode = sqlite3_column_int(query, 0);
+  sqlite3_finalize(query);
+  // Mode 2 is incremental vacuuming.
+  return mode == 2;
+}
+
+void Database::convert_to_incremental_vacuum(void) {
+  // The whole file is rewritten once. Databases created by earlier versions do not use incremental vacuuming.
+  if (incremental_vacuum_enabled())
+    return;
+  int result = sqlite3_exec(m_db, "PRAGMA auto_vacuum = INCREMENTAL; VACUUM;", NULL, NULL, NULL);
+  check(result, "Error converting database to incremental vacuuming: ");
+}
+
+void Database::incremental_vacuum(void) {
+  // Free pages can only be released after the database was converted.
+  if (!incremental_vacuum_enabled())
+    return;
+  int result = sqlite3_exec(m_db, "PRAGMA incremental_vacuum;", NULL, NULL, NULL);
+  check(result, "Error releasing free pages: ");
+}
+
+void Database::load_dictionary(void) {
+  prepare(m_get_dictionary);
+  int result;
+  int generation = 0;
+  vector<string> phrases;
+  while (true) {
+    result = sqlite3_step(m_get_dictionary);
+    check(result, "Error fetching dictionary: ");
+    if (result != SQLITE_ROW)
+      break;
+    generation = sqlite3_column_int(m_get_dictionary, 0);
+    phrases.push_back((const char *)sqlite3_column_text(m_get_dictionary, 1));
+  };
+  result = sqlite3_reset(m_get_dictionary);
+  check(result, "Error resetting statement for fetching dictionary: ");
+  m_dictionary.set_phrases(generation, phrases);
+}
+
+string Database::decompress(const char *data, int size) {
+  // Another connection might have trained a new dictionary.
+  if (size > 0 && (unsigned char)data[0] != m_dictionary.generation())
+    load_dictionary();
+  return m_dictionary.decompress(data, size);
+}
+
+void Database::train_dictionary(void) {
+  prepare(m_add_phrase);
+  prepare(m_update_instruction);
+  int result;
+  // Keep the decompressed instructions while replacing the dictionary.
+  result = sqlite3_exec(m_db, "DROP TABLE IF EXISTS plain;\n"
+                              "CREATE TEMPORARY TABLE plain AS SELECT recipeid, line, anymeal_text(txt) AS txt FROM instruction;",
+                        NULL, NULL, NULL);
+  check(result, "Error decompressing instructions: ");
+  sqlite3_stmt *query;
+  result = sqlite3_prepare_v2(m_db, "SELECT txt FROM plain ORDER BY random() LIMIT 20000;", -1, &query, NULL);
+  check(result, "Error preparing query for sampling instructions: ");
+  vector<string> samples;
+  while (true) {
+    result = sqlite3_step(query);
+    if (result != SQLITE_ROW)
+      break;
+    samples.push_back((const char *)sqlite3_column_text(query, 0));
+  };
+  sqlite3_finalize(query);
+  check(result, "Error sampling instructions: ");
+  m_dictionary.train(samples);
+  // Store the new dictionary.
+  result = sqlite3_exec(m_db, "DELETE FROM dictionary;", NULL, NULL, NULL);
+  check(result, "Error deleting dictionary: ");
+  for (unsigned int i=0; i<m_dictionary.phrases().size(); i++) {
+    result = sqlite3_bind_int(m_add_phrase, 1, m_dictionary.generation());
+    check(result, "Error binding dictionary generation: ");
+    result = sqlite3_bind_int(m_add_phrase, 2, i);
+    check(result, "Error binding phrase code: ");
+    result = sqlite3_bind_text(m_add_phrase, 3, m_dictionary.phrases()[i].c_str(), -1, SQLITE_STATIC);
+    check(result, "Error binding phrase: ");
+    result = sqlite3_step(m_add_phrase);
+    check(result, "Error adding phrase to dictionary: ");
+    result = sqlite3_reset(m_add_phrase);
+    check(result, "Error resetting statement for adding phrase to dictionary: ");
+  };
+  // Compress the instructions using the new dictionary.
+  result = sqlite3_prepare_v2(m_db, "SELECT recipeid, line, txt FROM plain;", -1, &query, NULL);
+  check(result, "Error preparing query for reading instructions: ");
+  while (true) {
+    result = sqlite3_step(query);
+    if (result != SQLITE_ROW)
+      break;
+    string text = (const char *)sqlite3_column_text(query, 2);
+    string compressed = m_dictionary.compress(text);
+    result = sqlite3_bind_int64(m_update_instruction, 1, sqlite3_column_int64(query, 0));
+    if (result == SQLITE_OK)
+      result = sqlite3_bind_int(m_update_instruction, 2, sqlite3_column_int(query, 1));
+    if (result == SQLITE_OK) {
+      if (compressed.size() < text.size())
+        result = sqlite3_bind_blob(m_update_instruction, 3, compressed.data(), compressed.size(), SQLITE_STATIC);
+      else
+        result = sqlite3_bind_text(m_update_instruction, 3, text.c_str(), -1, SQLITE_STATIC);
+    };
+    if (result == SQLITE_OK)
+      result = sqlite3_step(m_update_instruction);
+    sqlite3_reset(m_update_instruction);
+    if (result != SQLITE_DONE)
+      break;
+  };
+  sqlite3_finalize(query);
+  check(result, "Error compressing instructions: ");
+  result = sqlite3_exec(m_db, "DROP TABLE plain;", NULL, NULL, NULL);
+  check(result, "Error dropping table of decompressed instructions: ");
+}
+
+vector<pair<sqlite3_int64, double> > Database::pantry(const vector<string> &ingredients, int count) {
+  materialize_selection();
+  prepare(m_match_token);
+  prepare(m_pantry_coverage);
+  int result;
+  // Look up all ingredients containing every word of one of the pantry items.
+  set<sqlite3_int64> matches;
+  for (vector<string>::const_iterator ingredient=ingredients.begin(); ingredient!=ingredients.end(); ingredient++) {
+    vector<string> tokens = ingredient_tokens(ingredient->c_str());
+    set<sqlite3_int64> candidates;
+    for (vector<string>::iterator token=tokens.begin(); token!=tokens.end(); token++) {
+      set<sqlite3_int64> found;
+      result = sqlite3_bind_text(m_match_token, 1, token->c_str(), -1, SQLITE_STATIC);
+      check(result, "Error binding pantry ingredient: ");
+      while (true) {
+        result = sqlite3_step(m_match_token);
+        check(result, "Error matching pantry ingredient: ");
+        if (result != SQLITE_ROW)
+          break;
+        sqlite3_int64 id = sqlite3_column_int64(m_match_token, 0);
+        if (token == tokens.begin() || candidates.find(id) != candidates.end())
+          found.insert(id);
+      };
+      result = sqlite3_reset(m_match_token);
+      check(result, "Error resetting statement for matching pantry ingredient: ");
+      candidates.swap(found);
+    };
+    matches.insert(candidates.begin(), candidates.end());
+  };
+  // Count the covered and the total ingredients of the selected recipes using a single grouped statement.
+  stage_ids(vector<sqlite3_int64>(matches.begin(), matches.end()));
+  // Keep the best recipes in a bounded heap with the worst one on top.
+  typedef tuple<double, int, sqlite3_int64> Score;
+  priority_queue<Score, vector<Score>, greater<Score> > heap;
+  while (true) {
+    result = sqlite3_step(m_pantry_coverage);
+    check(result, "Error counting covered ingredients: ");
+    if (result != SQLITE_ROW)
+      break;
+    sqlite3_int64 id = sqlite3_column_int64(m_pantry_coverage, 0);
+    int covered = sqlite3_column_int(m_pantry_coverage, 1);
+    int total = sqlite3_column_int(m_pantry_coverage, 2);
+    // Prefer lower recipe ids when the scores are equal.
+    Score score((double)covered / max(total, 1), covered, -id);
+    if ((int)heap.size() < count)
+      heap.push(score);
+    else if (count > 0 && score > heap.top()) {
+      heap.pop();
+      heap.push(score);
+    };
+  };
+  result = sqlite3_reset(m_pantry_coverage);
+  check(result, "Error resetting statement for counting covered ingredients: ");
+  vector<pair<sqlite3_int64, double> > ranking(heap.size());
+  for (int i=ranking.size() - 1; i>=0; i--) {
+    ranking[i] = make_pair(-get<2>(heap.top()), get<0>(heap.top()));
+    heap.pop();
+  };
+  return ranking;
+}
+
+void Database::select_ids(const vector<sqlite3_int64> &ids) {
+  materialize_selection();
+  prepare(m_select_staged);
+  stage_ids(ids);
+  int result = sqlite3_step(m_select_staged);
+  check(result, "Error selecting recipes: ");
+  result = sqlite3_reset(m_select_staged);
+  check(result, "Error resetting statement for selecting recipes: ");
+}
+
+IdBitmap Database::selection_bitmap(void) {
+  materialize_selection();
+  prepare(m_selected_ids);
+  IdBitmap bitmap;
+  while (true) {
+    int result = sqlite3_step(m_selected_ids);
+    check(result, "Error listing selected recipes: ");
+    if (result != SQLITE_ROW)
+      break;
+    bitmap.add(sqlite3_column_int64(m_selected_ids, 0));
+  };
+  int result = sqlite3_reset(m_selected_ids);
+  check(result, "Error resetting statement for listing selected recipes: ");
+  return bitmap;
+}
+
+void Database::restore_selection(const IdBitmap &bitmap) {
+  materialize_selection();
+  prepare(m_select_staged);
+  prepare(m_add_staged_to_selection);
+  // Only the difference to the current selection is applied so that the triggers maintaining the counts do little work.
+  stage_ids(bitmap.ids());
+  int result = sqlite3_step(m_select_staged);
+  check(result, "Error removing recipes from selection: ");
+  result = sqlite3_reset(m_select_staged);
+  check(result, "Error resetting statement for selecting recipes: ");
+  result = sqlite3_step(m_add_staged_to_selection);
+  check(result, "Error adding recipes to selection: ");
+  result = sqlite3_reset(m_add_staged_to_selection);
+  check(result, "Error resetting statement for adding recipes to selection: ");
+}
+
+void Database::index_recipe(sqlite3_int64 recipe_id, Recipe &recipe) {
+  prepare(m_index_recipe);
+  string ingredients;
+  for (vector<Ingredient>::iterator ingredient=recipe.ingredients().begin(); ingredient!=recipe.ingredients().end(); ingredient++)
+    ingredients += ingredient->text() + "\n";
+  string instructions;
+  for (vector<string>::iterator instruction=recipe.instructions().begin(); instruction!=recipe.instructions().end(); instruction++)
+    instructions += *instruction + "\n";
+  int result = sqlite3_bind_int64(m_index_recipe, 1, recipe_id);
+  check(result, "Error binding recipe id: ");
+  result = sqlite3_bind_text(m_index_recipe, 2, recipe.title_c_str(), -1, SQLITE_STATIC);
+  check(result, "Error binding recipe title: ");
+  result = sqlite3_bind_text(m_index_recipe, 3, ingredients.c_str(), -1, SQLITE_STATIC);
+  check(result, "Error binding ingredient text: ");
+  result = sqlite3_bind_text(m_index_recipe, 4, instructions.c_str(), -1, SQLITE_STATIC);
+  check(result, "Error binding instruction text: ");
+  result = sqlite3_step(m_index_recipe);
+  check(result, "Error indexing recipe text: ");
+  result = sqlite3_reset(m_index_recipe);
+  check(result, "Error resetting statement for indexing recipe text: ");
+}
+
+void Database::rebuild_search_index(void) {
+  vector<sqlite3_int64> ids;
+  sqlite3_stmt *query;
+  int result = sqlite3_prepare_v2(m_db, "SELECT id FROM recipes;", -1, &query, NULL);
+  check(result, "Error preparing query for recipe ids: ");
+  while (true) {
+    result = sqlite3_step(query);
+    if (result != SQLITE_ROW)
+      break;
+    ids.push_back(sqlite3_column_int64(query, 0));
+  };
+  sqlite3_finalize(query);
+  check(result, "Error querying recipe ids: ");
+  begin();
+  try {
+    result = sqlite3_exec(m_db, "DELETE FROM recipesearch;", NULL, NULL, NULL);
+    check(result, "Error clearing full-text index: ");
+    for (vector<sqlite3_int64>::iterator id=ids.begin(); id!=ids.end(); id++) {
+      Recipe recipe = fetch_recipe(*id);
+      index_recipe(*id, recipe);
+    };
+    commit();
+  } catch (exception &) {
+    rollback();
+    throw;
+  };
+  m_reindex = false;
+}
+
+void Database::compute_fingerprints(void) {
+  vector<sqlite3_int64> ids;
+  sqlite3_stmt *query;
+  int result = sqlite3_prepare_v2(m_db, "SELECT id FROM recipes WHERE fingerprint IS NULL;", -1, &query, NULL);
+  check(result, "Error preparing query for recipes without fingerprint: ");
+  while (true) {
+    result = sqlite3_step(query);
+    if (result != SQLITE_ROW)
+      break;
+    ids.push_back(sqlite3_column_int64(query, 0));
+  };
+  sqlite3_finalize(query);
+  check(result, "Error querying recipes without fingerprint: ");
+  sqlite3_stmt *update;
+  result = sqlite3_prepare_v2(m_db, "UPDATE recipes SET fingerprint = ?002 WHERE id = ?001;", -1, &update, NULL);
+  check(result, "Error preparing statement for setting recipe fingerprint: ");
+  begin();
+  try {
+    for (vector<sqlite3_int64>::iterator id=ids.begin(); id!=ids.end(); id++) {
+      Recipe recipe = fetch_recipe(*id);
+      result = sqlite3_bind_int64(update, 1, *id);
+      check(result, "Error binding recipe id: ");
+      result = sqlite3_bind_int64(update, 2, (sqlite3_int64)recipe_fingerprint(recipe));
+      check(result, "Error binding recipe fingerprint: ");
+      result = sqlite3_step(update);
+      check(result, "Error setting recipe fingerprint: ");
+      result = sqlite3_reset(update);
+      check(result, "Error resetting statement for setting recipe fingerprint: ");
+    };
+    commit();
+  } catch (exception &) {
+    sqlite3_finalize(update);
+    rollback();
+    throw;
+  };
+  sqlite3_finalize(update);
+  m_refingerprint = false;
+}
+
+void Database::tokenize_ingredients(void) {
+  vector<pair<sqlite3_int64, string> > ingredients;
+  sqlite3_stmt *query;
+  int result = sqlite3_prepare_v2(m_db, "SELECT id, name FROM ingredients WHERE id NOT IN "
+                                  "(SELECT ingredientid FROM ingredienttokens);", -1, &query, NULL);
+  check(result, "Error preparing query for ingredients without tokens: ");
+  while (true) {
+    result = sqlite3_step(query);
+    if (result != SQLITE_ROW)
+      break;
+    ingredients.push_back(make_pair(sqlite3_column_int64(query, 0), (const char *)sqlite3_column_text(query, 1)));
+  };
+  sqlite3_finalize(query);
+  check(result, "Error querying ingredients without tokens: ");
+  begin();
+  try {
+    for (vector<pair<sqlite3_int64, string> >::iterator ingredient=ingredients.begin(); ingredient!=ingredients.end(); ingredient++)
+      index_ingredient(ingredient->first, ingredient->second.c_str());
+    commit();
+  } catch (exception &) {
+    rollback();
+    throw;
+  };
+  m_retokenize = false;
+}
+
+void Database::load_language(void) {
+  sqlite3_stmt *query;
+  int result = sqlite3_prepare_v2(m_db, "SELECT language FROM collation;", -1, &query, NULL);
+  check(result, "Error preparing query for sorting language: ");
+  result = sqlite3_step(query);
+  if (result == SQLITE_ROW)
+    m_language = (const char *)sqlite3_column_text(query, 0);
+  sqlite3_finalize(query);
+  check(result, "Error querying sorting language: ");
+}
+
+void Database::set_language(const char *language) {
+  // The sort keys of all titles are updated when the language changes.
+  if (m_language == language)
+    return;
+  string previous = m_language;
+  m_language = language;
+  begin();
+  try {
+    sqlite3_stmt *query;
+    int result = sqlite3_prepare_v2(m_db, "UPDATE collation SET language = ?001;", -1, &query, NULL);
+    check(result, "Error preparing statement for setting sorting language: ");
+    sqlite3_bind_text(query, 1, language, -1, SQLITE_STATIC);
+    result = sqlite3_step(query);
+    sqlite3_finalize(query);
+    check(result, "Error setting sorting language: ");
+    result = sqlite3_exec(m_db, "UPDATE recipes SET sortkey = anymeal_sortkey(title);", NULL, NULL, NULL);
+    check(result, "Error updating sort keys of recipe titles: ");
+    commit();
+  } catch (exception &) {
+    m_language = previous;
+    rollback();
+    throw;
+  };
+}
+
+string Database::search_query(const char *text) {
+  return text_search_query(text);
+}
+
+void Database::select_by_text(const char *text) {
+  materialize_selection();
+  prepare(m_select_text);
+  string query = search_query(text);
+  if (query.empty())
+    return;
+  int result = sqlite3_bind_text(m_select_text, 1, query.c_str(), -1, SQLITE_STATIC);
+  check(result, "Error binding search text: ");
+  result = sqlite3_step(m_select_text);
+  check(result, "Error filtering recipes by text: ");
+  result = sqlite3_reset(m_select_text);
+  check(result, "Error resetting statement for filtering recipes by text: ");
+}
+
+void Database::select_by_query(query_t query) {
+  query = simplify_query(query);
+  if (!query)
+    return;
+  materialize_selection();
+  // The whole query is compiled to a single statement so that the selection is only scanned once.
+  vector<string> parameters;
+  string sql = "DELETE FROM selection WHERE NOT " + query_to_sql(query, parameters) + ";";
+  sqlite3_stmt *statement;
+  int result = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &statement, NULL);
+  check(result, "Error preparing statement for selecting by query: ");
+  for (int i=0; i<(int)parameters.size(); i++) {
+    result = sqlite3_bind_text(statement, i + 1, parameters[i].c_str(), -1, SQLITE_TRANSIENT);
+    if (result != SQLITE_OK) {
+      sqlite3_finalize(statement);
+      check(result, "Error binding query term: ");
+    };
+  };
+  result = sqlite3_step(statement);
+  if (result != SQLITE_DONE) {
+    sqlite3_finalize(statement);
+    check(result, "Error filtering recipes by query: ");
+  };
+  result = sqlite3_finalize(statement);
+  check(result, "Error finalizing statement for selecting by query: ");
+}
+
+void Database::select_by_query(const char *text) {
+  select_by_query(parse_query(text));
+}
+
+vector<pair<sqlite3_int64, string> > Database::ranked_recipe_info(const char *text, int offset, int count) {
+  StringPool pool;
+  vector<pair<sqlite3_int64, string_view> > infos = ranked_recipe_info(text, offset, count, pool);
+  return vector<pair<sqlite3_int64, string> >(infos.begin(), infos.end());
+}
+
+vector<pair<sqlite3_int64, string_view> > Database::ranked_recipe_info(const char *text, int offset, int count, StringPool &pool) {
+  materialize_selection();
+  prepare(m_ranked_titles);
+  vector<pair<sqlite3_int64, string_view> > infos;
+  string query = search_query(text);
+  if (query.empty())
+    return infos;
+  int result = sqlite3_bind_text(m_ranked_titles, 1, query.c_str(), -1, SQLITE_STATIC);
+  check(result, "Error binding search text: ");
+  result = sqlite3_bind_int(m_ranked_titles, 2, count);
+  check(result, "Error binding number of recipes: ");
+  result = sqlite3_bind_int(m_ranked_titles, 3, offset);
+  check(result, "Error binding offset of recipes: ");
+  while (true) {
+    result = sqlite3_step(m_ranked_titles);
+    check(result, "Error ranking recipes: ");
+    if (result != SQLITE_ROW)
+      break;
+    infos.push_back(make_pair(sqlite3_column_int64(m_ranked_titles, 0), pool.add((const char *)sqlite3_column_text(m_ranked_titles, 1))));
+  };
+  result = sqlite3_reset(m_ranked_titles);
+  check(result, "Error resetting statement for ranking recipes: ");
+  return infos;
+}
+
+void Database::set_profiling(bool enable) {
+  int result;
+  if (enable)
+    result = sqlite3_trace_v2(m_db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, &anymeal_trace, this);
+  else
+    result = sqlite3_trace_v2(m_db, 0, NULL, NULL);
+  check(result, "Error setting up statement profiling: ");
+  m_profiling = enable;
+  m_running.clear();
+}
+
+static bool slower(const pair<string, StatementProfile> &a, const pair<string, StatementProfile> &b) {
+  return a.second.total() > b.second.total();
+}
+
+vector<pair<string, StatementProfile> > Database::profile(void) {
+  vector<pair<string, StatementProfile> > result(m_profile.begin(), m_profile.end());
+  sort(result.begin(), result.end(), &slower);
+  return result;
+}
+
+void Database::reset_profile(void) {
+  m_profile.clear();
+}
+
+void Database::trace(unsigned int type, void *statement, void *data) {
+  sqlite3_stmt *stmt = (sqlite3_stmt *)statement;
+  switch (type) {
+  case SQLITE_TRACE_STMT:
+    // Trigger programs are reported with a comment instead of the statement text.
+    if (strncmp((const char *)data, "--", 2) != 0)
+      m_running[stmt] = make_pair(chrono::steady_clock::now(), 0);
+    break;
+  case SQLITE_TRACE_ROW: {
+    map<sqlite3_stmt *, pair<chrono::steady_clock::time_point, int> >::iterator running = m_running.find(stmt);
+    if (running != m_running.end())
+      running->second.second++;
+    break;
+  }
+  case SQLITE_TRACE_PROFILE: {
+    // SQLite measures time with the resolution of the operating system clock which can be as coarse as a millisecond.
+    sqlite3_int64 nanoseconds = *(sqlite3_int64 *)data;
+    int rows = 0;
+    map<sqlite3_stmt *, pair<chrono::steady_clock::time_point, int> >::iterator running = m_running.find(stmt);
+    if (running != m_running.end()) {
+      nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - running->second.first).count();
+      rows = running->second.second;
+      m_running.erase(running);
+    };
+    int vm_steps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+    const char *sql = sqlite3_sql(stmt);
+    m_profile[sql ? sql : ""].record(nanoseconds, rows, vm_steps);
+    break;
+  }
+  };
+}
+
+void Database::copy_pages(sqlite3 *source, sqlite3 *destination, progress_t progress) {
+  // Pages are copied in small steps so that the database is only locked briefly.
+  sqlite3_backup *backup = sqlite3_backup_init(destination, "main", source, "main");
+  if (!backup) {
+    ostringstream s;
+    s << "Error starting copy of database: " << sqlite3_errmsg(destination);
+    throw database_exception(s.str());
+  };
+  int result;
+  while (true) {
+    result = sqlite3_backup_step(backup, BACKUP_PAGES);
+    if (result == SQLITE_BUSY || result == SQLITE_LOCKED) {
+      sqlite3_sleep(10);
+      continue;
+    };
+    if (result != SQLITE_OK)
+      break;
+    if (progress && !progress(sqlite3_backup_remaining(backup), sqlite3_backup_pagecount(backup))) {
+      sqlite3_backup_finish(backup);
+      throw database_exception("Copy of database was cancelled.");
+    };
+  };
+  if (progress)
+    progress(0, sqlite3_backup_pagecount(backup));
+  sqlite3_backup_finish(backup);
+  if (result != SQLITE_DONE) {
+    ostringstream s;
+    s << "Error copying database: " << sqlite3_errstr(result);
+    throw database_exception(s.str());
+  };
+}
+
+void Database::backup_to(const char *filename, progress_t progress) {
+  // The backup is written to a temporary file first so that a cancelled backup does not leave a partial file.
+  string temporary = string(filename) + ".tmp";
+  remove(temporary.c_str());
+  sqlite3 *destination;
+  int result = sqlite3_open(temporary.c_str(), &destination);
+  if (result != SQLITE_OK) {
+    ostringstream s;
+    s << "Error opening backup file: " << sqlite3_errmsg(destination);
+    sqlite3_close(destination);
+    remove(temporary.c_str());
+    throw database_exception(s.str());
+  };
+  // The read transaction keeps the snapshot consistent while other connections modify the database.
+  begin();
+  try {
+    result = sqlite3_exec(m_db, "SELECT COUNT(*) FROM sqlite_master;", NULL, NULL, NULL);
+    check(result, "Error starting read transaction for backup: ");
+    copy_pages(m_db, destination, progress);
+    commit();
+  } catch (exception &) {
+    rollback();
+    sqlite3_close(destination);
+    remove(temporary.c_str());
+    throw;
+  };
+  // The backup is a single file without write-ahead log.
+  result = sqlite3_exec(destination, "PRAGMA journal_mode = DELETE;", NULL, NULL, NULL);
+  ostringstream s;
+  s << "Error disabling write-ahead log of backup: " << sqlite3_errmsg(destination);
+  sqlite3_close(destination);
+  if (result != SQLITE_OK) {
+    remove(temporary.c_str());
+    throw database_exception(s.str());
+  };
+  // Renaming does not replace an existing file on all platforms.
+  remove(filename);
+  if (rename(temporary.c_str(), filename) != 0) {
+    remove(temporary.c_str());
+    throw database_exception(string("Error renaming backup file: ") + strerror(errno));
+  };
+}
+
+static int page_size(sqlite3 *db) {
+  sqlite3_stmt *query;
+  int value = 0;
+  if (sqlite3_prepare_v2(db, "PRAGMA page_size;", -1, &query, NULL) == SQLITE_OK) {
+    if (sqlite3_step(query) == SQLITE_ROW)
+      value = sqlite3_column_int(query, 0);
+    sqlite3_finalize(query);
+  };
+  return value;
+}
+
+void Database::restore_from(const char *filename, progress_t progress) {
+  sqlite3 *source;
+  int result = sqlite3_open_v2(filename, &source, SQLITE_OPEN_READONLY, NULL);
+  if (result != SQLITE_OK) {
+    ostringstream s;
+    s << "Error opening backup file: " << sqlite3_errmsg(source);
+    sqlite3_close(source);
+    throw database_exception(s.str());
+  };
+  bool left_wal = false;
+  try {
+    // Pages cannot be copied into a database using write-ahead logging if the page sizes differ.
+    int backup_page_size = page_size(source);
+    int database_page_size = page_size(m_db);
+    if (backup_page_size > 0 && backup_page_size != database_page_size) {
+      sqlite3_stmt *query;
+      result = sqlite3_prepare_v2(m_db, "PRAGMA journal_mode = DELETE;", -1, &query, NULL);
+      check(result, "Error preparing statement for disabling write-ahead log: ");
+      result = sqlite3_step(query);
+      string mode = result == SQLITE_ROW ? (const char *)sqlite3_column_text(query, 0) : "";
+      sqlite3_finalize(query);
+      left_wal = true;
+      if (mode != "delete") {
+        ostringstream s;
+        s << "Error restoring backup: page size " << backup_page_size << " of backup differs from page size " << database_page_size
+          << " of database and the write-ahead log of the database cannot be disabled.";
+        throw database_exception(s.str());
+      };
+    };
+    copy_pages(source, m_db, progress);
+  } catch (exception &) {
+    sqlite3_close(source);
+    if (left_wal)
+      journal();
+    throw;
+  };
+  sqlite3_close(source);
+  // The backup might have been created by an earlier version.
+  journal();
+  migrate();
+  load_language();
+  load_dictionary();
+  if (m_reindex)
+    rebuild_search_index();
+  if (m_refingerprint)
+    compute_fingerprints();
+  if (m_retokenize)
+    tokenize_ingredients();
+  select_all();
+}
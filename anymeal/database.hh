@@ -14,10 +14,19 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
 #pragma once
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <sqlite3.h>
+#include "bitmap.hh"
+#include "compress.hh"
+#include "profile.hh"
+#include "query.hh"
 #include "recipe.hh"
+#include "string_pool.hh"
 
 
 class database_exception: public std::exception
@@ -30,13 +39,22 @@ protected:
   std::string m_error;
 };
 
+// Number of bits of a recipe id reserved for the recipe id within its cookbook.
+#define COOKBOOK_SHIFT 40
+
 class Database
 {
 public:
   Database(void);
   virtual ~Database(void);
-  void open(const char *filename);
+  void open(const char *filename, bool read_only=false);
+  // Close the connection so that it can be opened again (e.g. while restoring a backup using another connection).
+  void close(void);
   sqlite3 *db(void) { return m_db; }
+  bool compact_storage(void) { return m_compact_storage; }
+  void set_compact_storage(bool compact) { m_compact_storage = compact; }
+  const std::string &language(void) { return m_language; }
+  void set_language(const char *language);
   void begin(void);
   void commit(void);
   void rollback(void);
@@ -44,6 +62,10 @@ public:
   int num_recipes(void);
   int count_recipes(const char *category);
   std::vector<std::pair<sqlite3_int64, std::string> > recipe_info(void);
+  std::vector<std::pair<sqlite3_int64, std::string> > recipe_info(sqlite3_int64 after_id, const char *after_title, int count);
+  std::vector<std::pair<sqlite3_int64, std::string_view> > recipe_info(sqlite3_int64 after_id, const char *after_title, int count,
+                                                                       StringPool &pool);
+  std::vector<std::pair<sqlite3_int64, std::string> > recipe_info(const std::vector<sqlite3_int64> &ids);
   std::vector<std::string> categories(void);
   std::vector<std::pair<std::string, int> > categories_and_counts(void);
   void select_all(void);
@@ -52,8 +74,33 @@ public:
   void select_by_no_category(const char *category);
   void select_by_ingredient(const char *ingredient);
   void select_by_no_ingredient(const char *ingredient);
+  std::vector<std::pair<sqlite3_int64, double> > pantry(const std::vector<std::string> &ingredients, int count);
+  void select_ids(const std::vector<sqlite3_int64> &ids);
+  IdBitmap selection_bitmap(void);
+  void restore_selection(const IdBitmap &bitmap);
+  void select_by_text(const char *text);
+  std::vector<std::pair<sqlite3_int64, std::string> > ranked_recipe_info(const char *text, int offset, int count);
+  std::vector<std::pair<sqlite3_int64, std::string_view> > ranked_recipe_info(const char *text, int offset, int count,
+                                                                              StringPool &pool);
+  static std::string search_query(const char *text);
+  void select_by_query(query_t query);
+  void select_by_query(const char *text);
   Recipe fetch_recipe(sqlite3_int64 id);
   std::vector<Recipe> fetch_recipes(const std::vector<sqlite3_int64> &ids);
+  // Recipes of attached cookbooks have the number of the cookbook in the upper bits of their id.
+  static sqlite3_int64 cookbook_id(int cookbook, sqlite3_int64 id) { return ((sqlite3_int64)cookbook << COOKBOOK_SHIFT) | id; }
+  static int cookbook_of(sqlite3_int64 id) { return (int)(id >> COOKBOOK_SHIFT); }
+  static sqlite3_int64 local_id(sqlite3_int64 id) { return id & (((sqlite3_int64)1 << COOKBOOK_SHIFT) - 1); }
+  int attach_cookbook(const char *filename);
+  int merge(const char *filename, bool skip_duplicates=true);
+  int num_cookbooks(void) { return m_cookbooks.size(); }
+  std::vector<std::pair<sqlite3_int64, std::string> > search_cookbooks(query_t query, sqlite3_int64 after_id, const char *after_title,
+                                                                       int count);
+  std::vector<std::pair<sqlite3_int64, std::string_view> > search_cookbooks(query_t query, sqlite3_int64 after_id,
+                                                                            const char *after_title, int count, StringPool &pool);
+  std::vector<std::pair<sqlite3_int64, std::string> > search_cookbooks(const char *text, sqlite3_int64 after_id, const char *after_title,
+                                                                       int count);
+  int count_cookbooks(query_t query);
   void delete_recipes(const std::vector<sqlite3_int64> &ids);
   void add_recipes_to_category(const std::vector<sqlite3_int64> &ids, const char *category);
   void remove_recipes_from_category(const std::vector<sqlite3_int64> &ids, const char *category);
@@ -63,15 +110,74 @@ public:
   void merge_category(const char *category, const char *target);
   void delete_category(const char *category);
   void garbage_collect(void);
+  bool incremental_vacuum_enabled(void);
+  void convert_to_incremental_vacuum(void);
+  void incremental_vacuum(void);
+  void train_dictionary(void);
+  std::string decompress(const char *data, int size);
+  void set_profiling(bool enable);
+  bool profiling(void) { return m_profiling; }
+  std::vector<std::pair<std::string, StatementProfile> > profile(void);
+  void reset_profile(void);
+  void trace(unsigned int type, void *statement, void *data);
+  // Callback getting the number of remaining and total pages. Returning false cancels the operation.
+  typedef std::function<bool(int, int)> progress_t;
+  void backup_to(const char *filename, progress_t progress=progress_t());
+  void restore_from(const char *filename, progress_t progress=progress_t());
 protected:
   void create_version_1(void);
   void migrate_version_1_to_version_2(void);
   void migrate_version_2_to_version_3(void);
+  void migrate_version_3_to_version_4(void);
+  void migrate_version_4_to_version_5(void);
+  void migrate_version_5_to_version_6(void);
+  void migrate_version_6_to_version_7(void);
+  void migrate_version_7_to_version_8(void);
+  void migrate_version_8_to_version_9(void);
+  void migrate_version_9_to_version_10(void);
+  void migrate_version_10_to_version_11(void);
+  void migrate_version_11_to_version_12(void);
+  void migrate_version_12_to_version_13(void);
+  void migrate_version_13_to_version_14(void);
+  void migrate_version_14_to_version_15(void);
   void migrate(void);
   void check(int result, const char *prefix);
   int user_version(void);
   void pragmas(void);
+  void journal(void);
+  void create_selection(void);
+  void count_selection(void);
+  void materialize_selection(void);
+  void define(sqlite3_stmt **statement, const char *sql, const char *error);
+  void prepare(sqlite3_stmt *&statement);
+  void stage_ids(const std::vector<sqlite3_int64> &ids);
+  void add_ingredient(const char *name);
+  void insert_recipe_rows(sqlite3_int64 recipe_id, Recipe &recipe);
+  void insert_recipe_blob(sqlite3_int64 recipe_id, Recipe &recipe);
+  void fetch_recipe_rows(sqlite3_int64 id, Recipe &recipe);
+  void load_dictionary(void);
+  void index_recipe(sqlite3_int64 recipe_id, Recipe &recipe);
+  void rebuild_search_index(void);
+  void compute_fingerprints(void);
+  void index_ingredient(sqlite3_int64 id, const char *name);
+  void tokenize_ingredients(void);
+  void load_language(void);
+  std::shared_ptr<Database> open_cookbook(const char *filename);
+  std::vector<std::string> cookbook_conditions(query_t query, std::vector<std::string> &parameters);
+  void copy_pages(sqlite3 *source, sqlite3 *destination, progress_t progress);
   sqlite3 *m_db;
+  bool m_compact_storage;
+  bool m_reindex;
+  bool m_refingerprint;
+  bool m_retokenize;
+  bool m_profiling;
+  bool m_all_selected;
+  std::string m_language;
+  std::vector<std::shared_ptr<Database> > m_cookbooks;
+  std::map<sqlite3_stmt **, std::pair<const char *, const char *> > m_definitions;
+  std::map<std::string, StatementProfile> m_profile;
+  std::map<sqlite3_stmt *, std::pair<std::chrono::steady_clock::time_point, int> > m_running;
+  TextDictionary m_dictionary;
   sqlite3_stmt *m_begin;
   sqlite3_stmt *m_commit;
   sqlite3_stmt *m_rollback;
@@ -84,31 +190,49 @@ protected:
   sqlite3_stmt *m_get_categories;
   sqlite3_stmt *m_category_and_count_list;
   sqlite3_stmt *m_get_ingredients;
+  sqlite3_stmt *m_index_ingredient;
+  sqlite3_stmt *m_add_body;
   sqlite3_stmt *m_add_instruction;
   sqlite3_stmt *m_get_instructions;
+  sqlite3_stmt *m_get_dictionary;
+  sqlite3_stmt *m_add_phrase;
+  sqlite3_stmt *m_update_instruction;
+  sqlite3_stmt *m_add_token;
+  sqlite3_stmt *m_match_token;
+  sqlite3_stmt *m_pantry_coverage;
+  sqlite3_stmt *m_select_staged;
+  sqlite3_stmt *m_add_staged_to_selection;
+  sqlite3_stmt *m_selected_ids;
+  sqlite3_stmt *m_get_title;
+  sqlite3_stmt *m_index_recipe;
+  sqlite3_stmt *m_select_text;
+  sqlite3_stmt *m_ranked_titles;
   sqlite3_stmt *m_add_ingredient_section;
   sqlite3_stmt *m_get_ingredient_section;
   sqlite3_stmt *m_add_instruction_section;
   sqlite3_stmt *m_get_instruction_section;
+  sqlite3_stmt *m_count_all;
+  sqlite3_stmt *m_get_all_info;
+  sqlite3_stmt *m_all_category_list;
   sqlite3_stmt *m_count_selected;
   sqlite3_stmt *m_get_info;
+  sqlite3_stmt *m_get_all_page;
+  sqlite3_stmt *m_get_page;
   sqlite3_stmt *m_select_title;
   sqlite3_stmt *m_category_list;
   sqlite3_stmt *m_select_category;
   sqlite3_stmt *m_select_no_category;
   sqlite3_stmt *m_select_ingredient;
   sqlite3_stmt *m_select_no_ingredient;
-  sqlite3_stmt *m_delete_recipe;
-  sqlite3_stmt *m_delete_categories;
-  sqlite3_stmt *m_delete_ingredients;
-  sqlite3_stmt *m_delete_instructions;
-  sqlite3_stmt *m_delete_ingredient_sections;
-  sqlite3_stmt *m_delete_instruction_sections;
-  sqlite3_stmt *m_delete_selection;
+  sqlite3_stmt *m_stage_id;
+  sqlite3_stmt *m_clear_ids;
+  sqlite3_stmt *m_delete_staged_recipes;
+  sqlite3_stmt *m_unselect_staged;
   sqlite3_stmt *m_clean_categories;
   sqlite3_stmt *m_clean_ingredients;
   sqlite3_stmt *m_select_recipe;
-  sqlite3_stmt *m_remove_recipe_category;
+  sqlite3_stmt *m_add_staged_to_category;
+  sqlite3_stmt *m_remove_staged_from_category;
   sqlite3_stmt *m_rename_category;
   sqlite3_stmt *m_get_category_id;
   sqlite3_stmt *m_merge_category;
@@ -163,7 +163,7 @@ void EditDialog::select_ingredient(const QModelIndex &current, const QModelIndex
       m_ui.numerator_spin->setValue(ingredient.amount_numerator());
       m_ui.denominator_spin->setValue(ingredient.amount_denominator());
     };
-    m_ui.unit_combo->setCurrentIndex(index_of_unit(ingredient.unit()));
+    m_ui.unit_combo->setCurrentIndex(ingredient.unit_index());
     m_ui.name_edit->setText(ingredient.text_c_str());
   } else {
     m_ui.ingredient_stack->setCurrentIndex(1);
@@ -185,7 +185,7 @@ void EditDialog::unit_changed(int idx) {
   QModelIndex index = m_ui.ingredients_view->currentIndex();
   if (m_ingredient_model->is_ingredient(index)) {
     Ingredient ingredient = m_ingredient_model->get_ingredient(index);
-    ingredient.set_unit(unit_from_index(idx));
+    ingredient.set_unit((Unit)idx);
     m_ingredient_model->set_ingredient(index, ingredient);
   };
 }
@@ -69,11 +69,7 @@ string recipe_to_mealmaster(Recipe &recipe) {
       amount = amount.substr(0, 7);
       result << string(7 - amount.length(), ' ') << amount;
       result << " ";
-      if (ingredient.unit().empty()) {
-        result << "  ";
-      } else {
-        result << ingredient.unit();
-      };
+      result << ingredient.unit();
       result << " ";
       string txt = ingredient.text();
       // Break up ingredient text using continuation lines if necessary.
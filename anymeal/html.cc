@@ -14,7 +14,10 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
 #include <cassert>
-#include <sstream>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
 #include "html.hh"
 
 
@@ -22,256 +25,277 @@ using namespace std;
 
 #define QT_TRANSLATE_NOOP(scope, x) x
 
-string html_encode(const string &data) {
-  // https://stackoverflow.com/questions/5665231/most-efficient-way-to-escape-xml-html-in-c-string
-  string result;
-  result.reserve(data.size());
-  for(size_t pos=0; pos!=data.size(); pos++) {
-    switch(data[pos]) {
-      case '&':  result.append("&amp;");       break;
-      case '\"': result.append("&quot;");      break;
-      case '\'': result.append("&apos;");      break;
-      case '<':  result.append("&lt;");        break;
-      case '>':  result.append("&gt;");        break;
-      default:   result.append(&data[pos], 1); break;
+static void append_encoded(string &output, string_view text) {
+  // Runs of characters which do not need escaping are copied at once.
+  const char *pos = text.data();
+  const char *end = pos + text.size();
+  while (pos != end) {
+    const char *run = pos;
+    while (pos != end && *pos != '&' && *pos != '\"' && *pos != '\'' && *pos != '<' && *pos != '>')
+      pos++;
+    output.append(run, pos - run);
+    if (pos == end)
+      break;
+    switch(*pos++) {
+      case '&':  output.append("&amp;");  break;
+      case '\"': output.append("&quot;"); break;
+      case '\'': output.append("&apos;"); break;
+      case '<':  output.append("&lt;");   break;
+      default:   output.append("&gt;");   break;
     };
   };
-  return result;
 }
 
-string html_amount(Ingredient &ingredient) {
-  ostringstream stream;
+static void append_integer(string &output, int value) {
+  char buffer[16];
+  char *end = to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+  output.append(buffer, end - buffer);
+}
+
+static void append_amount(string &output, Ingredient &ingredient) {
   if (ingredient.amount_float() > 0) {
-    stream << ingredient.amount_float();
+    // Same format as writing a double to a stream.
+    char buffer[32];
+    int size = snprintf(buffer, sizeof(buffer), "%g", ingredient.amount_float());
+    output.append(buffer, size);
   } else {
     if (ingredient.amount_integer() > 0)
-      stream << ingredient.amount_integer();
+      append_integer(output, ingredient.amount_integer());
     if (ingredient.amount_numerator() > 0) {
       if (ingredient.amount_integer() > 0)
-        stream << " ";
-      stream << ingredient.amount_numerator() << "/" << ingredient.amount_denominator();
+        output += ' ';
+      append_integer(output, ingredient.amount_numerator());
+      output += '/';
+      append_integer(output, ingredient.amount_denominator());
     };
   };
-  return stream.str();
 }
 
-string html_unit(const string &unit, string (*translate)(const char *, const char *)) {
-  const char *result = "";
-  if (unit == "x ") result = QT_TRANSLATE_NOOP("units", "per serving");
-  if (unit == "sm") result = QT_TRANSLATE_NOOP("units", "small");
-  if (unit == "md") result = QT_TRANSLATE_NOOP("units", "medium");
-  if (unit == "lg") result = QT_TRANSLATE_NOOP("units", "large");
-  if (unit == "cn") result = QT_TRANSLATE_NOOP("units", "can");
-  if (unit == "pk") result = QT_TRANSLATE_NOOP("units", "package");
-  if (unit == "pn") result = QT_TRANSLATE_NOOP("units", "pinch");
-  if (unit == "dr") result = QT_TRANSLATE_NOOP("units", "drop");
-  if (unit == "ds") result = QT_TRANSLATE_NOOP("units", "dash");
-  if (unit == "ct") result = QT_TRANSLATE_NOOP("units", "carton");
-  if (unit == "bn") result = QT_TRANSLATE_NOOP("units", "bunch");
-  if (unit == "sl") result = QT_TRANSLATE_NOOP("units", "slice");
-  if (unit == "ea") result = QT_TRANSLATE_NOOP("units", "each");
-  if (unit == "t ") result = QT_TRANSLATE_NOOP("units", "teaspoon");
-  if (unit == "ts") result = QT_TRANSLATE_NOOP("units", "teaspoon");
-  if (unit == "T ") result = QT_TRANSLATE_NOOP("units", "tablespoon");
-  if (unit == "tb") result = QT_TRANSLATE_NOOP("units", "tablespoon");
-  if (unit == "fl") result = QT_TRANSLATE_NOOP("units", "fluid ounce");
-  if (unit == "c ") result = QT_TRANSLATE_NOOP("units", "cup");
-  if (unit == "pt") result = QT_TRANSLATE_NOOP("units", "pint");
-  if (unit == "qt") result = QT_TRANSLATE_NOOP("units", "quart");
-  if (unit == "ga") result = QT_TRANSLATE_NOOP("units", "gallon");
-  if (unit == "oz") result = QT_TRANSLATE_NOOP("units", "ounce");
-  if (unit == "lb") result = QT_TRANSLATE_NOOP("units", "pound");
-  if (unit == "ml") result = QT_TRANSLATE_NOOP("units", "milliliter");
-  if (unit == "cb") result = QT_TRANSLATE_NOOP("units", "cubic cm");
-  if (unit == "cl") result = QT_TRANSLATE_NOOP("units", "centiliter");
-  if (unit == "dl") result = QT_TRANSLATE_NOOP("units", "deciliter");
-  if (unit == "l ") result = QT_TRANSLATE_NOOP("units", "liter");
-  if (unit == "mg") result = QT_TRANSLATE_NOOP("units", "milligram");
-  if (unit == "cg") result = QT_TRANSLATE_NOOP("units", "centigram");
-  if (unit == "dg") result = QT_TRANSLATE_NOOP("units", "decigram");
-  if (unit == "g ") result = QT_TRANSLATE_NOOP("units", "gram");
-  if (unit == "kg") result = QT_TRANSLATE_NOOP("units", "kilogram");
+string html_amount(Ingredient &ingredient) {
+  string result;
+  append_amount(result, ingredient);
+  return result;
+}
+
+// Names of the units indexed by unit.
+static const char *unit_names[] = {
+  QT_TRANSLATE_NOOP("units", "per serving"),
+  QT_TRANSLATE_NOOP("units", "small"),
+  QT_TRANSLATE_NOOP("units", "medium"),
+  QT_TRANSLATE_NOOP("units", "large"),
+  QT_TRANSLATE_NOOP("units", "can"),
+  QT_TRANSLATE_NOOP("units", "package"),
+  QT_TRANSLATE_NOOP("units", "pinch"),
+  QT_TRANSLATE_NOOP("units", "drop"),
+  QT_TRANSLATE_NOOP("units", "dash"),
+  QT_TRANSLATE_NOOP("units", "carton"),
+  QT_TRANSLATE_NOOP("units", "bunch"),
+  QT_TRANSLATE_NOOP("units", "slice"),
+  QT_TRANSLATE_NOOP("units", "each"),
+  QT_TRANSLATE_NOOP("units", "teaspoon"),
+  QT_TRANSLATE_NOOP("units", "tablespoon"),
+  QT_TRANSLATE_NOOP("units", "fluid ounce"),
+  QT_TRANSLATE_NOOP("units", "cup"),
+  QT_TRANSLATE_NOOP("units", "pint"),
+  QT_TRANSLATE_NOOP("units", "quart"),
+  QT_TRANSLATE_NOOP("units", "gallon"),
+  QT_TRANSLATE_NOOP("units", "ounce"),
+  QT_TRANSLATE_NOOP("units", "pound"),
+  QT_TRANSLATE_NOOP("units", "milliliter"),
+  QT_TRANSLATE_NOOP("units", "cubic cm"),
+  QT_TRANSLATE_NOOP("units", "centiliter"),
+  QT_TRANSLATE_NOOP("units", "deciliter"),
+  QT_TRANSLATE_NOOP("units", "liter"),
+  QT_TRANSLATE_NOOP("units", "milligram"),
+  QT_TRANSLATE_NOOP("units", "centigram"),
+  QT_TRANSLATE_NOOP("units", "decigram"),
+  QT_TRANSLATE_NOOP("units", "gram"),
+  QT_TRANSLATE_NOOP("units", "kilogram")
+};
+
+string html_unit(int unit, string (*translate)(const char *, const char *)) {
+  const char *result = unit >= 0 && unit < UNIT_NONE ? unit_names[unit] : "";
   return (*translate)("units", result);
 }
 
-int index_of_unit(const std::string &unit) {
-  int result = 32;
-  if (unit == "x ") result =  0;
-  if (unit == "sm") result =  1;
-  if (unit == "md") result =  2;
-  if (unit == "lg") result =  3;
-  if (unit == "cn") result =  4;
-  if (unit == "pk") result =  5;
-  if (unit == "pn") result =  6;
-  if (unit == "dr") result =  7;
-  if (unit == "ds") result =  8;
-  if (unit == "ct") result =  9;
-  if (unit == "bn") result = 10;
-  if (unit == "sl") result = 11;
-  if (unit == "ea") result = 12;
-  if (unit == "t ") result = 13;
-  if (unit == "ts") result = 13;
-  if (unit == "T ") result = 14;
-  if (unit == "tb") result = 14;
-  if (unit == "fl") result = 15;
-  if (unit == "c ") result = 16;
-  if (unit == "pt") result = 17;
-  if (unit == "qt") result = 18;
-  if (unit == "ga") result = 19;
-  if (unit == "oz") result = 20;
-  if (unit == "lb") result = 21;
-  if (unit == "ml") result = 22;
-  if (unit == "cb") result = 23;
-  if (unit == "cl") result = 24;
-  if (unit == "dl") result = 25;
-  if (unit == "l ") result = 26;
-  if (unit == "mg") result = 27;
-  if (unit == "cg") result = 28;
-  if (unit == "dg") result = 29;
-  if (unit == "g ") result = 30;
-  if (unit == "kg") result = 31;
+string notrans(const char *, const char *text) {
+  return text;
+}
+
+// Rough size of the HTML of a recipe for reserving the output buffer.
+static size_t estimated_size(Recipe &recipe) {
+  size_t result = 512 + 2 * strlen(recipe.title_c_str()) + 64 * recipe.categories().size() + 200 * recipe.ingredients().size();
+  for (vector<string>::iterator instruction=recipe.instructions().begin(); instruction!=recipe.instructions().end(); instruction++)
+    result += instruction->size() + 8;
   return result;
 }
 
-const char *unit_from_index(int index) {
-  switch (index) {
-    case  0: return "x ";
-    case  1: return "sm";
-    case  2: return "md";
-    case  3: return "lg";
-    case  4: return "cn";
-    case  5: return "pk";
-    case  6: return "pn";
-    case  7: return "dr";
-    case  8: return "ds";
-    case  9: return "ct";
-    case 10: return "bn";
-    case 11: return "sl";
-    case 12: return "ea";
-    case 13: return "ts";
-    case 14: return "tb";
-    case 15: return "fl";
-    case 16: return "c ";
-    case 17: return "pt";
-    case 18: return "qt";
-    case 19: return "ga";
-    case 20: return "oz";
-    case 21: return "lb";
-    case 22: return "ml";
-    case 23: return "cb";
-    case 24: return "cl";
-    case 25: return "dl";
-    case 26: return "l ";
-    case 27: return "mg";
-    case 28: return "cg";
-    case 29: return "dg";
-    case 30: return "g ";
-    case 31: return "kg";
-  };
-  return "  ";
+HtmlRenderer::HtmlRenderer(string (*translate)(const char *, const char *)):
+  m_translate(translate),
+  m_categories((*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Categories"))),
+  m_yield((*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Yield"))),
+  m_ingredients((*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Ingredients"))),
+  m_amount((*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "amount"))),
+  m_unit((*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "unit"))),
+  m_ingredient((*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "ingredient"))),
+  m_instructions((*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Instructions")))
+{
+  for (int i=0; i<UNITS; i++)
+    m_translated[i] = false;
 }
 
-string notrans(const char *context, const char *text) {
-  return text;
+const string &HtmlRenderer::unit(int unit) {
+  static const string none;
+  if (unit < 0 || unit >= UNITS)
+    return none;
+  if (!m_translated[unit]) {
+    m_units[unit] = html_unit(unit, m_translate);
+    m_translated[unit] = true;
+  };
+  return m_units[unit];
 }
 
-static void stream_recipe(ostringstream &stream, Recipe &recipe, string (*translate)(const char *, const char *)) {
-  if (!recipe.title().empty()) {
-    stream << "    <h2>" << html_encode(recipe.title()) << "</h2>\n";
+void HtmlRenderer::append_recipe(Recipe &recipe) {
+  if (*recipe.title_c_str()) {
+    m_output += "    <h2>";
+    append_encoded(m_output, recipe.title_c_str());
+    m_output += "</h2>\n";
   };
   if (!recipe.categories().empty()) {
-    stream << "    <p><b>" << (*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Categories")) << ":</b> ";
+    m_output += "    <p><b>";
+    m_output += m_categories;
+    m_output += ":</b> ";
     set<string>::iterator category = recipe.categories().begin();
     while (true) {
-      stream << html_encode(*category++);
+      append_encoded(m_output, *category++);
       if (category != recipe.categories().end())
-        stream << ", ";
+        m_output += ", ";
       else
         break;
     };
-    stream << "</p>\n";
+    m_output += "</p>\n";
   };
   if (recipe.servings() > 0) {
-    stream << "    <p><b>" << (*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Yield")) << ":</b> " << recipe.servings()
-           << " " << html_encode(recipe.servings_unit()) << "</p>\n";
+    m_output += "    <p><b>";
+    m_output += m_yield;
+    m_output += ":</b> ";
+    append_integer(m_output, recipe.servings());
+    m_output += ' ';
+    append_encoded(m_output, recipe.servings_unit());
+    m_output += "</p>\n";
   };
   if (!recipe.ingredients().empty()) {
-    stream << "    <h3>" << (*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Ingredients")) << "</h3>\n"
-           << "    <table>\n"
-           << "      <tr style=\"white-space:nowrap;\">\n"
-           << "        <th style=\"text-align:left\">" << (*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "amount")) << "&nbsp;</th>\n"
-           << "        <th style=\"text-align:left\">" << (*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "unit")) << "&nbsp;</th>\n"
-           << "        <th style=\"text-align:left\">" << (*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "ingredient")) << "</th>\n"
-           << "      </tr>\n";
+    m_output += "    <h3>";
+    m_output += m_ingredients;
+    m_output += "</h3>\n"
+                "    <table>\n"
+                "      <tr style=\"white-space:nowrap;\">\n"
+                "        <th style=\"text-align:left\">";
+    m_output += m_amount;
+    m_output += "&nbsp;</th>\n"
+                "        <th style=\"text-align:left\">";
+    m_output += m_unit;
+    m_output += "&nbsp;</th>\n"
+                "        <th style=\"text-align:left\">";
+    m_output += m_ingredient;
+    m_output += "</th>\n"
+                "      </tr>\n";
     vector<pair<int, string> >::iterator section = recipe.ingredient_sections().begin();
-    for (int i=0; i<recipe.ingredients().size(); i++) {
-      while (section != recipe.ingredient_sections().end() && section->first == i) {
-        stream << "      <tr>\n"
-               << "        <td colspan=\"3\"><em>" << html_encode(section->second) << "</em></td>\n"
-               << "      </tr>\n";
+    for (size_t i=0; i<recipe.ingredients().size(); i++) {
+      while (section != recipe.ingredient_sections().end() && (size_t)section->first == i) {
+        m_output += "      <tr>\n"
+                    "        <td colspan=\"3\"><em>";
+        append_encoded(m_output, section->second);
+        m_output += "</em></td>\n"
+                    "      </tr>\n";
         section++;
       };
-      Ingredient ingredient = recipe.ingredients()[i];
-      stream << "      <tr>\n"
-             << "        <td style=\"white-space:nowrap;\">" << html_amount(ingredient) << "&nbsp;</td>\n"
-             << "        <td style=\"white-space:nowrap;\">" << html_unit(ingredient.unit(), translate) << "&nbsp;</td>\n"
-             << "        <td>" << ingredient.text() << "</td>\n"
-             << "      </tr>\n";
+      Ingredient &ingredient = recipe.ingredients()[i];
+      m_output += "      <tr>\n"
+                  "        <td style=\"white-space:nowrap;\">";
+      append_amount(m_output, ingredient);
+      m_output += "&nbsp;</td>\n"
+                  "        <td style=\"white-space:nowrap;\">";
+      m_output += unit(ingredient.unit_index());
+      m_output += "&nbsp;</td>\n"
+                  "        <td>";
+      m_output += ingredient.text();
+      m_output += "</td>\n"
+                  "      </tr>\n";
     };
-    stream << "    </table>\n";
+    m_output += "    </table>\n";
   };
   if (!recipe.instructions().empty()) {
-    stream << "    <h3>" << (*translate)("recipe", QT_TRANSLATE_NOOP("recipe", "Instructions")) << "</h3>\n";
+    m_output += "    <h3>";
+    m_output += m_instructions;
+    m_output += "</h3>\n";
     vector<pair<int, string> >::iterator section = recipe.instruction_sections().begin();
     bool paragraph_open = false;
-    for (int i=0; i<recipe.instructions().size(); i++) {
-      while (section != recipe.instruction_sections().end() && section->first == i) {
+    for (size_t i=0; i<recipe.instructions().size(); i++) {
+      while (section != recipe.instruction_sections().end() && (size_t)section->first == i) {
         if (paragraph_open) {
-          stream << "</p>\n";
+          m_output += "</p>\n";
           paragraph_open = false;
         };
-        stream << "    <h4>" << html_encode(section->second) << "</h4>\n";
+        m_output += "    <h4>";
+        append_encoded(m_output, section->second);
+        m_output += "</h4>\n";
         section++;
       };
       if (!paragraph_open) {
-        stream << "    <p>";
+        m_output += "    <p>";
         paragraph_open = true;
       } else
-        stream << "<br/>";
-      stream << html_encode(recipe.instructions()[i]);
+        m_output += "<br/>";
+      append_encoded(m_output, recipe.instructions()[i]);
     };
-    stream << "</p>\n";
+    m_output += "</p>\n";
   };
 }
 
-string recipe_to_html(Recipe &recipe, string (*translate)(const char *, const char *)) {
-  ostringstream stream;
-  stream << "<html>\n"
-         << "  <head>\n";
-  if (!recipe.title().empty()) {
-    stream << "    <title>" << html_encode(recipe.title()) << "</title>\n";
+const string &HtmlRenderer::recipe_to_html(Recipe &recipe) {
+  m_output.clear();
+  m_output.reserve(estimated_size(recipe));
+  m_output += "<html>\n"
+              "  <head>\n";
+  if (*recipe.title_c_str()) {
+    m_output += "    <title>";
+    append_encoded(m_output, recipe.title_c_str());
+    m_output += "</title>\n";
   };
-  stream << "  </head>\n"
-         << "  <body>\n";
-  stream_recipe(stream, recipe, translate);
-  stream << "  </body>\n"
-         << "</html>";
-  return stream.str();
+  m_output += "  </head>\n"
+              "  <body>\n";
+  append_recipe(recipe);
+  m_output += "  </body>\n"
+              "</html>";
+  return m_output;
 }
 
-string recipes_to_html(vector<Recipe> &recipes, string (*translate)(const char *, const char *)) {
-  ostringstream stream;
-  stream << "<html>\n"
-         << "  <head>\n"
-         << "    <title>AnyMeal Recipe Export</title>\n"
-         << "  </head>\n"
-         << "  <body>\n";
+const string &HtmlRenderer::recipes_to_html(vector<Recipe> &recipes) {
+  size_t size = 256;
+  for (vector<Recipe>::iterator recipe=recipes.begin(); recipe!=recipes.end(); recipe++)
+    size += estimated_size(*recipe);
+  m_output.clear();
+  m_output.reserve(size);
+  m_output += "<html>\n"
+              "  <head>\n"
+              "    <title>AnyMeal Recipe Export</title>\n"
+              "  </head>\n"
+              "  <body>\n";
   for (vector<Recipe>::iterator recipe=recipes.begin(); recipe!=recipes.end(); recipe++) {
     if (recipe!=recipes.begin())
-      stream << "    <div style=\"page-break-before:always\"></div>\n";
-    stream_recipe(stream, *recipe, translate);
+      m_output += "    <div style=\"page-break-before:always\"></div>\n";
+    append_recipe(*recipe);
   };
-  stream << "  </body>\n"
-         << "</html>";
-  return stream.str();
+  m_output += "  </body>\n"
+              "</html>";
+  return m_output;
+}
+
+string recipe_to_html(Recipe &recipe, string (*translate)(const char *, const char *)) {
+  return HtmlRenderer(translate).recipe_to_html(recipe);
+}
+
+string recipes_to_html(vector<Recipe> &recipes, string (*translate)(const char *, const char *)) {
+  return HtmlRenderer(translate).recipes_to_html(recipes);
 }
@@ -25,12 +25,32 @@ std::string notrans(const char *context, const char *text);
 
 std::string html_amount(Ingredient &ingredient);
 
-std::string html_unit(const std::string &unit, std::string (*translate)(const char *, const char *));
-
-int index_of_unit(const std::string &unit);
-
-const char *unit_from_index(int index);
+std::string html_unit(int unit, std::string (*translate)(const char *, const char *));
 
 std::string recipe_to_html(Recipe &recipe, std::string (*translate)(const char *, const char *)=&notrans);
 
 std::string recipes_to_html(std::vector<Recipe> &recipes, std::string (*translate)(const char *, const char *)=&notrans);
+
+// Renders recipes into an output buffer which is reused by subsequent calls. Labels and units are translated only once.
+class HtmlRenderer
+{
+public:
+  HtmlRenderer(std::string (*translate)(const char *, const char *)=&notrans);
+  // The returned document is valid until the next call.
+  const std::string &recipe_to_html(Recipe &recipe);
+  const std::string &recipes_to_html(std::vector<Recipe> &recipes);
+protected:
+  void append_recipe(Recipe &recipe);
+  const std::string &unit(int unit);
+  std::string (*m_translate)(const char *, const char *);
+  std::string m_categories;
+  std::string m_yield;
+  std::string m_ingredients;
+  std::string m_amount;
+  std::string m_unit;
+  std::string m_ingredient;
+  std::string m_instructions;
+  std::string m_units[UNITS];
+  bool m_translated[UNITS];
+  std::string m_output;
+};
@@ -13,9 +13,100 @@
 
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cctype>
 #include "ingredient.hh"
 
 
-Ingredient::Ingredient(void): m_amount_integer(0), m_amount_numerator(0), m_amount_denominator(1), m_amount_float(0.0)
+using namespace std;
+
+// Key for looking up a two-letter unit code.
+#define UNIT_KEY(a, b) (((unsigned char)(a) << 8) | (unsigned char)(b))
+
+// MealMaster codes indexed by unit.
+static const char *unit_codes[] = {
+  "x ", "sm", "md", "lg", "cn", "pk", "pn", "dr", "ds", "ct", "bn", "sl", "ea", "ts", "tb", "fl", "c ", "pt", "qt",
+  "ga", "oz", "lb", "ml", "cb", "cl", "dl", "l ", "mg", "cg", "dg", "g ", "kg", "  "
+};
+
+Unit unit_from_code(const char *code) {
+  if (code[0] == '\0' || code[1] == '\0' || code[2] != '\0')
+    return UNIT_NONE;
+  // Both characters of the code form a single key.
+  switch (UNIT_KEY(code[0], code[1])) {
+    case UNIT_KEY('x', ' '): return UNIT_PER_SERVING;
+    case UNIT_KEY('s', 'm'): return UNIT_SMALL;
+    case UNIT_KEY('m', 'd'): return UNIT_MEDIUM;
+    case UNIT_KEY('l', 'g'): return UNIT_LARGE;
+    case UNIT_KEY('c', 'n'): return UNIT_CAN;
+    case UNIT_KEY('p', 'k'): return UNIT_PACKAGE;
+    case UNIT_KEY('p', 'n'): return UNIT_PINCH;
+    case UNIT_KEY('d', 'r'): return UNIT_DROP;
+    case UNIT_KEY('d', 's'): return UNIT_DASH;
+    case UNIT_KEY('c', 't'): return UNIT_CARTON;
+    case UNIT_KEY('b', 'n'): return UNIT_BUNCH;
+    case UNIT_KEY('s', 'l'): return UNIT_SLICE;
+    case UNIT_KEY('e', 'a'): return UNIT_EACH;
+    case UNIT_KEY('t', 's'): return UNIT_TEASPOON;
+    case UNIT_KEY('t', ' '): return UNIT_TEASPOON;
+    case UNIT_KEY('t', 'b'): return UNIT_TABLESPOON;
+    case UNIT_KEY('T', ' '): return UNIT_TABLESPOON;
+    case UNIT_KEY('f', 'l'): return UNIT_FLUID_OUNCE;
+    case UNIT_KEY('c', ' '): return UNIT_CUP;
+    case UNIT_KEY('p', 't'): return UNIT_PINT;
+    case UNIT_KEY('q', 't'): return UNIT_QUART;
+    case UNIT_KEY('g', 'a'): return UNIT_GALLON;
+    case UNIT_KEY('o', 'z'): return UNIT_OUNCE;
+    case UNIT_KEY('l', 'b'): return UNIT_POUND;
+    case UNIT_KEY('m', 'l'): return UNIT_MILLILITER;
+    case UNIT_KEY('c', 'b'): return UNIT_CUBIC_CM;
+    case UNIT_KEY('c', 'l'): return UNIT_CENTILITER;
+    case UNIT_KEY('d', 'l'): return UNIT_DECILITER;
+    case UNIT_KEY('l', ' '): return UNIT_LITER;
+    case UNIT_KEY('m', 'g'): return UNIT_MILLIGRAM;
+    case UNIT_KEY('c', 'g'): return UNIT_CENTIGRAM;
+    case UNIT_KEY('d', 'g'): return UNIT_DECIGRAM;
+    case UNIT_KEY('g', ' '): return UNIT_GRAM;
+    case UNIT_KEY('k', 'g'): return UNIT_KILOGRAM;
+    default: return UNIT_NONE;
+  };
+}
+
+const char *unit_code(int unit) {
+  if (unit < 0 || unit > UNIT_NONE)
+    return unit_codes[UNIT_NONE];
+  return unit_codes[unit];
+}
+
+static void add_token(vector<string> &tokens, string &word) {
+  if (word.empty())
+    return;
+  size_t size = word.size();
+  if (size > 3 && word.compare(size - 3, 3, "ies") == 0)
+    word.replace(size - 3, 3, "y");
+  else if (size > 3 && word.compare(size - 3, 3, "oes") == 0)
+    word.erase(size - 2);
+  else if (size > 3 && word[size - 1] == 's' && word[size - 2] != 's')
+    word.erase(size - 1);
+  tokens.push_back(word);
+  word.clear();
+}
+
+vector<string> ingredient_tokens(const char *name) {
+  vector<string> result;
+  string word;
+  for (const char *p=name; *p; p++) {
+    unsigned char c = *p;
+    // Bytes of UTF-8 sequences are kept as part of the word.
+    if (c >= 0x80 || isalnum(c))
+      word += (char)tolower(c);
+    else
+      add_token(result, word);
+  };
+  add_token(result, word);
+  return result;
+}
+
+Ingredient::Ingredient(void): m_amount_integer(0), m_amount_numerator(0), m_amount_denominator(1), m_amount_float(0.0),
+  m_unit(UNIT_NONE)
 {
 }
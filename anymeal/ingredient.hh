@@ -15,8 +15,26 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
 #pragma once
 #include <string>
+#include <vector>
 
 
+// Units of MealMaster ingredients. The values are stored in the database and the recipe blobs.
+enum Unit {
+  UNIT_PER_SERVING = 0, UNIT_SMALL, UNIT_MEDIUM, UNIT_LARGE, UNIT_CAN, UNIT_PACKAGE, UNIT_PINCH, UNIT_DROP, UNIT_DASH,
+  UNIT_CARTON, UNIT_BUNCH, UNIT_SLICE, UNIT_EACH, UNIT_TEASPOON, UNIT_TABLESPOON, UNIT_FLUID_OUNCE, UNIT_CUP, UNIT_PINT,
+  UNIT_QUART, UNIT_GALLON, UNIT_OUNCE, UNIT_POUND, UNIT_MILLILITER, UNIT_CUBIC_CM, UNIT_CENTILITER, UNIT_DECILITER,
+  UNIT_LITER, UNIT_MILLIGRAM, UNIT_CENTIGRAM, UNIT_DECIGRAM, UNIT_GRAM, UNIT_KILOGRAM, UNIT_NONE
+};
+
+// Convert a two-letter MealMaster unit code to a unit. Unknown codes are mapped to UNIT_NONE.
+Unit unit_from_code(const char *code);
+
+// Two-letter MealMaster code of a unit.
+const char *unit_code(int unit);
+
+// Lower-case words of an ingredient name with plural endings removed (e.g. "Large eggs" becomes "large" and "egg").
+std::vector<std::string> ingredient_tokens(const char *name);
+
 class Ingredient
 {
 public:
@@ -29,9 +47,10 @@ public:
   void set_amount_denominator(int amount_denominator) { m_amount_denominator = amount_denominator; }
   double amount_float(void) { return m_amount_float; }
   void set_amount_float(double amount_float) { m_amount_float = amount_float; }
-  std::string &unit(void) { return m_unit; }
-  const char *unit_c_str(void) { return m_unit.c_str(); }
-  void set_unit(const char *unit) { m_unit = unit; }
+  Unit unit_index(void) { return m_unit; }
+  std::string unit(void) { return unit_code(m_unit); }
+  void set_unit(Unit unit) { m_unit = unit; }
+  void set_unit(const char *code) { m_unit = unit_from_code(code); }
   std::string &text(void) { return m_text; }
   const char *text_c_str(void) { return m_text.c_str(); }
   void add_text(const char *text) { m_text += text; }
@@ -41,6 +60,6 @@ protected:
   int m_amount_numerator;
   int m_amount_denominator;
   double m_amount_float;
-  std::string m_unit;
+  Unit m_unit;
   std::string m_text;
 };
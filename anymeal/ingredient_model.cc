@@ -85,7 +85,7 @@ QVariant IngredientModel::data(const QModelIndex &index, int role) const {
     case 0:
       return QVariant(html_amount(ingredient).c_str());
     case 1:
-      return QVariant(html_unit(ingredient.unit(), &translate).c_str());
+      return QVariant(html_unit(ingredient.unit_index(), &translate).c_str());
     case 2:
       return QVariant(ingredient.text().c_str());
   };
@@ -13,14 +13,22 @@
 
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <set>
 #include <unistd.h>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QStringListModel>
+#include <QtGui/QAbstractTextDocumentLayout>
+#include <QtGui/QFontMetrics>
+#include <QtGui/QPainter>
+#include <QtGui/QTextDocument>
+#include <QtGui/QTextFrame>
 #include <QtWidgets/QFileDialog>
 #include <QtWidgets/QMessageBox>
 #include <QtWidgets/QProgressDialog>
@@ -29,23 +37,94 @@
 #include "main_window.hh"
 #include "edit_dialog.hh"
 #include "category_dialog.hh"
+#include "profile_dialog.hh"
 #include "partition.hh"
 #include "recode.hh"
 #include "mealmaster.hh"
 #include "html.hh"
 #include "export.hh"
+#include "query.hh"
 #include "config.h"
 
 
+// Number of recipes before and after the current one to fetch in the background.
+#define PREFETCH_ROWS 5
+// Number of recipes rendered at once when printing.
+#define PRINT_CHUNK 50u
+// Maximum number of recipes returned by the pantry search.
+#define PANTRY_RESULTS 100
+// Maximum number of steps kept in the search history.
+#define HISTORY_SIZE 50
+
 using namespace std;
 
-MainWindow::MainWindow(QWidget *parent):
-  QMainWindow(parent), m_settings("wedesoft", "anymeal"), m_translator(NULL), m_converter_window(this), m_import_dialog(this),
+static Selection current_selection(Database &database, query_t query=query_t()) {
+  Selection result;
+  // Only the first page of titles is fetched. The titles model requests more when scrolling.
+  if (database.num_cookbooks() > 0)
+    result.titles = database.search_cookbooks(query, 0, "", TITLES_PAGE);
+  else
+    result.titles = database.recipe_info(0, "", TITLES_PAGE);
+  result.categories = database.categories();
+  result.count = database.num_recipes() + database.count_cookbooks(query);
+  return result;
+}
+
+static void restore_selection(Database &database, shared_ptr<const IdBitmap> ids) {
+  if (ids)
+    database.restore_selection(*ids);
+  else
+    database.select_all();
+}
+
+static vector<string> split_pantry(const string &text) {
+  vector<string> result;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(',', start);
+    if (end == string::npos)
+      end = text.size();
+    size_t first = text.find_first_not_of(" \t", start);
+    size_t last = text.find_last_not_of(" \t", end - 1);
+    if (first != string::npos && first < end && last != string::npos && last >= first)
+      result.push_back(text.substr(first, last - first + 1));
+    start = end + 1;
+  };
+  return result;
+}
+
+template <typename T>
+T MainWindow::wait_for(future<T> result) {
+  // The result belongs to the request which was submitted last.
+  return wait_for(move(result), m_database.last_request());
+}
+
+template <typename T>
+T MainWindow::wait_for(future<T> result, long request) {
+  // Keep the user interface responsive while the database thread is busy and allow to cancel the request.
+  if (result.wait_for(chrono::milliseconds(100)) != future_status::ready) {
+    QProgressDialog progress(tr("Waiting for database ..."), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    progress.show();
+    while (result.wait_for(chrono::milliseconds(20)) != future_status::ready) {
+      QCoreApplication::processEvents();
+      if (progress.wasCanceled())
+        m_database.interrupt(request);
+    };
+  };
+  return result.get();
+}
+
+MainWindow::MainWindow(QWidget *parent, bool profile_sql):
+  QMainWindow(parent), m_settings("wedesoft", "anymeal"), m_translator(NULL), m_backup_percent(new atomic<int>(0)),
+  m_backup_cancel(new atomic<bool>(false)), m_backup_timer(NULL), m_converter_window(this), m_import_dialog(this),
   m_export_dialog(this), m_category_picker(this), m_titles_model(NULL), m_categories_model(NULL),
-  m_category_table_model(NULL), m_categories_completer(NULL)
+  m_category_table_model(NULL), m_categories_completer(NULL), m_history_index(-1)
 {
   m_ui.setupUi(this);
-  switch_language(m_settings.value("language", QLocale::system().name().mid(0, 2)).toString());
+  QString language = m_settings.value("language", QLocale::system().name().mid(0, 2)).toString();
+  switch_language(language);
   m_ui.search_label->hide();
   connect(m_ui.action_new, &QAction::triggered, this, &MainWindow::new_recipe);
   connect(m_ui.action_import, &QAction::triggered, this, &MainWindow::import);
@@ -58,6 +137,12 @@ MainWindow::MainWindow(QWidget *parent):
   connect(m_ui.action_remove_from_category, &QAction::triggered, this, &MainWindow::remove_from_category);
   connect(m_ui.action_deduplicate, &QAction::triggered, this, &MainWindow::remove_duplicates);
   connect(m_ui.action_collect_garbage, &QAction::triggered, this, &MainWindow::collect_garbage);
+  connect(m_ui.action_compress_instructions, &QAction::triggered, this, &MainWindow::compress_instructions);
+  connect(m_ui.action_compact_storage, &QAction::toggled, this, &MainWindow::set_compact_storage);
+  connect(m_ui.action_merge_database, &QAction::triggered, this, &MainWindow::merge_database);
+  connect(m_ui.action_attach_cookbook, &QAction::triggered, this, &MainWindow::attach_cookbook);
+  connect(m_ui.action_backup, &QAction::triggered, this, &MainWindow::backup);
+  connect(m_ui.action_restore, &QAction::triggered, this, &MainWindow::restore);
   connect(m_ui.action_lang_en, &QAction::triggered, this, &MainWindow::language_en);
   connect(m_ui.action_lang_de, &QAction::triggered, this, &MainWindow::language_de);
   connect(m_ui.action_lang_fr, &QAction::triggered, this, &MainWindow::language_fr);
@@ -65,12 +150,17 @@ MainWindow::MainWindow(QWidget *parent):
   connect(m_ui.action_lang_nl, &QAction::triggered, this, &MainWindow::language_nl);
   connect(m_ui.action_lang_sl, &QAction::triggered, this, &MainWindow::language_sl);
   connect(m_ui.action_open_converter, &QAction::triggered, this, &MainWindow::open_converter);
+  connect(m_ui.action_profile_sql, &QAction::triggered, this, &MainWindow::show_profile);
   connect(m_ui.action_about, &QAction::triggered, this, &MainWindow::about);
   connect(m_ui.title_edit, &QLineEdit::returnPressed, this, &MainWindow::filter);
   connect(m_ui.category_edit, &QLineEdit::returnPressed, this, &MainWindow::filter);
   connect(m_ui.ingredient_edit, &QLineEdit::returnPressed, this, &MainWindow::filter);
+  connect(m_ui.pantry_edit, &QLineEdit::returnPressed, this, &MainWindow::filter);
+  connect(m_ui.text_edit, &QLineEdit::returnPressed, this, &MainWindow::filter);
   connect(m_ui.filter_button, &QPushButton::clicked, this, &MainWindow::filter);
   connect(m_ui.reset_button, &QPushButton::clicked, this, &MainWindow::reset);
+  connect(m_ui.action_back, &QAction::triggered, this, &MainWindow::back);
+  connect(m_ui.action_forward, &QAction::triggered, this, &MainWindow::forward);
   connect(m_ui.titles_view, &QListView::customContextMenuRequested, this, &MainWindow::titles_context_menu);
   connect(m_ui.recipe_browser, &QTextBrowser::customContextMenuRequested, this, &MainWindow::recipe_context_menu);
   m_ui.category_edit->installEventFilter(this);
@@ -86,27 +176,63 @@ MainWindow::MainWindow(QWidget *parent):
   m_recipe_context_menu->addAction(m_ui.action_edit);
   m_recipe_context_menu->addAction(m_ui.action_preview);
   m_recipe_context_menu->addAction(m_ui.action_print);
+  m_backup_timer = new QTimer(this);
+  connect(m_backup_timer, &QTimer::timeout, this, &MainWindow::backup_progress);
   try {
-    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir dir(path);
-    dir.mkpath(dir.absolutePath());
-    m_database.open(dir.filePath("anymeal.sqlite").toUtf8().constData());
-    m_titles_model = new TitlesModel(this, &m_database);
+    string path = database_path().toUtf8().constData();
+    m_database.open(path.c_str());
+    if (profile_sql)
+      m_database.call([](Database &database) { database.set_profiling(true); });
+    m_ui.action_compact_storage->setChecked(m_settings.value("compact_storage", false).toBool());
+    sort_titles(language);
+    open_readers();
+    m_titles_model = new TitlesModel(this);
     m_ui.titles_view->setModel(m_titles_model);
     connect(m_ui.titles_view->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::selected);
-    m_categories_model = new CategoriesModel(this, &m_database);
-    m_category_table_model = new CategoryTableModel(this, &m_database);
+    // Both category models share the interned category names.
+    m_categories_model = new CategoriesModel(this, &m_category_names);
+    m_category_table_model = new CategoryTableModel(this, &m_database, &m_category_names);
     m_categories_completer = new QCompleter(m_categories_model, this);
     m_categories_completer->setCaseSensitivity(Qt::CaseInsensitive);
     m_ui.category_edit->setCompleter(m_categories_completer);
-    show_num_recipes();
+    Snapshot snapshot;
+    snapshot.selection = m_database.call([](Database &database) { return current_selection(database); });
+    push_history(snapshot);
+    show_selection(snapshot.selection);
   } catch (exception &e) {
     QMessageBox::critical(this, tr("Error Opening Database"), e.what());
     exit(1);
   };
 }
 
+MainWindow::~MainWindow(void) {
+  // Stop a running backup so that closing the window does not wait for it.
+  *m_backup_cancel = true;
+}
+
+void MainWindow::open_readers(void) {
+  string path = database_path().toUtf8().constData();
+  m_backup_database.open(path.c_str(), true);
+  m_readers.open(path.c_str());
+  m_prefetcher.open(path.c_str(), &translate);
+}
+
+void MainWindow::close_readers(void) {
+  // The read-only connections are closed while another connection needs exclusive access to the database file.
+  m_prefetcher.close();
+  m_readers.close();
+  m_backup_database.call([](Database &database) { database.close(); });
+}
+
+QString MainWindow::database_path(void) {
+  QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+  dir.mkpath(dir.absolutePath());
+  return dir.filePath("anymeal.sqlite");
+}
+
 void MainWindow::switch_language(const QString &country) {
+  // The prefetcher renders recipes using the translator.
+  m_prefetcher.flush();
   if (m_translator) {
     qApp->removeTranslator(m_translator);
   } else {
@@ -132,6 +258,15 @@ void MainWindow::switch_language(const QString &country) {
 void MainWindow::switch_and_set_language(const char *country) {
   switch_language(country);
   m_settings.setValue("language", country);
+  try {
+    sort_titles(country);
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Sorting Recipes"), e.what());
+  };
+  // Fetch the titles again to show them in the new order.
+  invalidate_history();
+  if (m_history_index >= 0)
+    navigate(m_history_index);
 }
 
 void MainWindow::set_recipe(Recipe recipe) {
@@ -139,6 +274,26 @@ void MainWindow::set_recipe(Recipe recipe) {
   m_ui.recipe_browser->setHtml(recipe_to_html(recipe, &translate).c_str());
 }
 
+void MainWindow::prefetch(const QModelIndex &index) {
+  vector<sqlite3_int64> ids;
+  int rows = m_titles_model->rowCount();
+  for (int i=1; i<=PREFETCH_ROWS; i++) {
+    if (index.row() + i < rows)
+      ids.push_back(m_titles_model->recipeid(m_titles_model->index(index.row() + i)));
+    if (index.row() - i >= 0)
+      ids.push_back(m_titles_model->recipeid(m_titles_model->index(index.row() - i)));
+  };
+  // The background thread does not attach cookbooks. Their recipes are fetched when they are shown.
+  ids.erase(remove_if(ids.begin(), ids.end(), [](sqlite3_int64 id) { return Database::cookbook_of(id) > 0; }), ids.end());
+  m_prefetcher.prefetch(ids);
+}
+
+void MainWindow::sort_titles(const QString &country) {
+  // Recipe titles are sorted according to the rules of the user interface language.
+  string language = country.toUtf8().constData();
+  wait_for(m_database.submit([language](Database &database) { database.set_language(language.c_str()); }));
+}
+
 void MainWindow::language_en(void)
 {
   switch_and_set_language("en");
@@ -179,8 +334,27 @@ bool MainWindow::eventFilter(QObject *object, QEvent *event) {
   return false;
 }
 
-void MainWindow::show_num_recipes(void) {
-  statusBar()->showMessage(tr("Showing %1 recipes ...").arg(m_database.num_recipes()), 5000);
+void MainWindow::show_num_recipes(int count) {
+  statusBar()->showMessage(tr("Showing %1 recipes ...").arg(count), 5000);
+}
+
+void MainWindow::show_selection(const Selection &selection, query_t query) {
+  m_titles_model->reset(selection.titles, selection.count,
+                        [this, query](int, const pair<sqlite3_int64, string_view> &last, int count, StringPool &pool) {
+    sqlite3_int64 id = last.first;
+    string title(last.second);
+    return m_database.call([=, &pool](Database &database) {
+      if (database.num_cookbooks() > 0)
+        return database.search_cookbooks(query, id, title.c_str(), count, pool);
+      return database.recipe_info(id, title.c_str(), count, pool);
+    });
+  });
+  m_categories_model->reset(selection.categories);
+  show_num_recipes(selection.count);
+}
+
+void MainWindow::update_categories(void) {
+  m_categories_model->reset(m_database.call([](Database &database) { return database.categories(); }));
 }
 
 void MainWindow::import(void) {
@@ -202,7 +376,9 @@ void MainWindow::import(void) {
         QProgressDialog progress(tr("Importing files ..."), tr("Cancel"), 0, result.size() * 100, this);
         progress.setWindowModality(Qt::WindowModal);
         for (int i=0; i<result.size(); i++) {
-          m_database.begin();
+          // Recipes are inserted by the database thread while parsing the next ones.
+          vector<future<sqlite3_int64> > inserted;
+          m_database.call([](Database &database) { database.begin(); });
           transaction = true;
           ifstream f(result.at(i).toUtf8().constData(), ifstream::binary);
           bool unexpected_eof = false;
@@ -219,7 +395,9 @@ void MainWindow::import(void) {
                 recoded = result;
               } else
                 recoded = recoder.process_recipe(result);
-              m_database.insert_recipe(recoded);
+              inserted.push_back(m_database.submit([recoded](Database &database) mutable {
+                return database.insert_recipe(recoded);
+              }));
               success++;
             } catch (parse_exception &e) {
               failed++;
@@ -237,7 +415,7 @@ void MainWindow::import(void) {
           };
           if (progress.wasCanceled()) {
             if (transaction) {
-              m_database.rollback();
+              m_database.call([](Database &database) { database.rollback(); });
               transaction = false;
             };
             break;
@@ -251,13 +429,17 @@ void MainWindow::import(void) {
               throw gui_exception(s.str());
             };
           };
-          m_database.commit();
+          for (vector<future<sqlite3_int64> >::iterator id=inserted.begin(); id!=inserted.end(); id++)
+            id->get();
+          m_database.call([](Database &database) { database.commit(); });
           transaction = false;
         };
         progress.setValue(result.size() * 100);
-        m_database.select_all();
-        m_titles_model->reset();
-        m_categories_model->reset();
+        invalidate_history();
+        show_selection(wait_for(m_database.submit([](Database &database) {
+          database.select_all();
+          return current_selection(database);
+        })));
         QMessageBox::information(this, tr("Recipes Imported"), tr("%1 imported and %2 failed.").arg(success).arg(failed));
       };
     };
@@ -265,7 +447,7 @@ void MainWindow::import(void) {
     QMessageBox::critical(this, tr("Error While Importing"), e.what());
     try {
       if (transaction)
-        m_database.rollback();
+        m_database.call([](Database &database) { database.rollback(); });
     } catch (exception &e) {
     };
   };
@@ -318,28 +500,31 @@ void MainWindow::edit_recipe(EditMode mode)
   QModelIndex index = m_ui.titles_view->currentIndex();
   if (index.isValid() && mode != EDIT_NEW) {
     recipe_id = m_titles_model->recipeid(index);
-    recipe = m_database.fetch_recipe(recipe_id);
+    // Recipes of cookbooks can only be edited as a copy.
+    if (mode == EDIT_CURRENT && read_only(vector<sqlite3_int64>(1, recipe_id), tr("Edit Recipe")))
+      return;
+    recipe = m_database.call([recipe_id](Database &database) { return database.fetch_recipe(recipe_id); });
   } else if (mode == EDIT_CURRENT)
     return;  // index is not valid, so can't edit current
   EditDialog edit_dialog(this);
   edit_dialog.set_recipe(recipe);
   edit_dialog.set_category_table_model(m_category_table_model);
-  if (edit_dialog.exec() == QDialog::Accepted) {
+  int dialog_result = edit_dialog.exec();
+  // Categories can be renamed, merged, or deleted in the dialog even if it is cancelled.
+  m_prefetcher.clear();
+  if (dialog_result == QDialog::Accepted) {
     Recipe result = edit_dialog.get_recipe();
-    bool transaction = false;
     try {
-      QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-      m_database.begin();
-      transaction = true;
-      if (mode == EDIT_CURRENT) {
-        assert(recipe_id != 0);
-        vector<sqlite3_int64> ids;
-        ids.push_back(recipe_id);
-        m_database.delete_recipes(ids);
-      };
-      sqlite3_int64 recipe_new_id = m_database.insert_recipe(result);
+      sqlite3_int64 recipe_new_id = wait_for(m_database.transaction([mode, recipe_id, result](Database &database) mutable {
+        if (mode == EDIT_CURRENT) {
+          assert(recipe_id != 0);
+          vector<sqlite3_int64> ids;
+          ids.push_back(recipe_id);
+          database.delete_recipes(ids);
+        };
+        return database.insert_recipe(result);
+      }));
       set_recipe(result);
-      m_database.commit();
       QModelIndex idx;
       if (mode == EDIT_CURRENT) {
         idx = m_titles_model->edit_entry(index, recipe_new_id, result.title_c_str());
@@ -347,15 +532,9 @@ void MainWindow::edit_recipe(EditMode mode)
         idx = m_titles_model->add_entry(recipe_new_id, result.title_c_str());
       };
       m_ui.titles_view->setCurrentIndex(idx);
-      m_categories_model->reset();
-      QGuiApplication::restoreOverrideCursor();
+      update_categories();
+      invalidate_history();
     } catch (exception &e) {
-      try {
-        if (transaction)
-          m_database.rollback();
-      } catch (exception &e) {
-      };
-      QGuiApplication::restoreOverrideCursor();
       QMessageBox::critical(this, tr("Error While Updating Recipe"), e.what());
     };
   };
@@ -363,24 +542,20 @@ void MainWindow::edit_recipe(EditMode mode)
 
 void MainWindow::add_to_category(void) {
   vector<sqlite3_int64> ids = recipe_ids();
-  if (!ids.empty()) {
+  if (!ids.empty() && !read_only(ids, tr("Add to Category"))) {
     CategoryDialog category_dialog;
     category_dialog.set_categories_model(m_categories_model);
     if (category_dialog.exec() == QDialog::Accepted) {
       try {
-        QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-        m_database.begin();
-        m_database.add_recipes_to_category(ids, category_dialog.category().c_str());
-        m_database.commit();
-        m_categories_model->reset();
+        string category = category_dialog.category();
+        m_categories_model->reset(wait_for(m_database.transaction([ids, category](Database &database) {
+          database.add_recipes_to_category(ids, category.c_str());
+          return database.categories();
+        })));
+        m_prefetcher.clear();
+        invalidate_history();
         m_ui.titles_view->setCurrentIndex(QModelIndex());
-        QGuiApplication::restoreOverrideCursor();
       } catch (exception &e) {
-        try {
-          m_database.rollback();
-        } catch (exception &e) {
-        };
-        QGuiApplication::restoreOverrideCursor();
         QMessageBox::critical(this, tr("Error Adding Recipes to Category"), e.what());
       };
     };
@@ -389,24 +564,20 @@ void MainWindow::add_to_category(void) {
 
 void MainWindow::remove_from_category(void) {
   vector<sqlite3_int64> ids = recipe_ids();
-  if (!ids.empty()) {
+  if (!ids.empty() && !read_only(ids, tr("Remove from Category"))) {
     CategoryDialog category_dialog;
     category_dialog.set_categories_model(m_categories_model);
     if (category_dialog.exec() == QDialog::Accepted) {
       try {
-        QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-        m_database.begin();
-        m_database.remove_recipes_from_category(ids, category_dialog.category().c_str());
-        m_database.commit();
-        m_categories_model->reset();
+        string category = category_dialog.category();
+        m_categories_model->reset(wait_for(m_database.transaction([ids, category](Database &database) {
+          database.remove_recipes_from_category(ids, category.c_str());
+          return database.categories();
+        })));
+        m_prefetcher.clear();
+        invalidate_history();
         m_ui.titles_view->setCurrentIndex(QModelIndex());
-        QGuiApplication::restoreOverrideCursor();
       } catch (exception &e) {
-        try {
-          m_database.rollback();
-        } catch (exception &e) {
-        };
-        QGuiApplication::restoreOverrideCursor();
         QMessageBox::critical(this, tr("Error Removing Recipes from Category"), e.what());
       };
     };
@@ -415,18 +586,145 @@ void MainWindow::remove_from_category(void) {
 
 void MainWindow::collect_garbage(void) {
   try {
-    QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    m_database.begin();
-    m_database.garbage_collect();
-    m_database.commit();
-    QGuiApplication::restoreOverrideCursor();
+    wait_for(m_database.transaction([](Database &database) { database.garbage_collect(); }));
+    // Databases created by earlier versions need to be rewritten once before free pages can be released.
+    if (!m_database.call([](Database &database) { return database.incremental_vacuum_enabled(); }) &&
+        QMessageBox::question(this, tr("Collect Garbage"), tr("The database file needs to be rewritten once before unused space "
+                              "can be released. This can take a while for large databases. Rewrite it now?")) == QMessageBox::Yes) {
+      statusBar()->showMessage(tr("Rewriting database ..."));
+      wait_for(m_database.submit([](Database &database) { database.convert_to_incremental_vacuum(); }));
+      statusBar()->clearMessage();
+    };
+    wait_for(m_database.submit([](Database &database) { database.incremental_vacuum(); }));
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Collecting Garbage"), e.what());
+  };
+}
+
+void MainWindow::compress_instructions(void) {
+  try {
+    wait_for(m_database.transaction([](Database &database) { database.train_dictionary(); }));
+    m_prefetcher.clear();
+    statusBar()->showMessage(tr("Instructions compressed"), 5000);
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Compressing Instructions"), e.what());
+  };
+}
+
+void MainWindow::set_compact_storage(bool compact) {
+  m_settings.setValue("compact_storage", compact);
+  m_database.call([compact](Database &database) { database.set_compact_storage(compact); });
+}
+
+void MainWindow::merge_database(void) {
+  QString file = QFileDialog::getOpenFileName(this, tr("Merge Database"), "",
+                                              tr("SQLite database (*.sqlite);;All files (*)"));
+  if (file.isEmpty())
+    return;
+  try {
+    string filename = file.toUtf8().constData();
+    int count = wait_for(m_database.submit([filename](Database &database) { return database.merge(filename.c_str()); }));
+    invalidate_history();
+    show_selection(wait_for(m_database.submit([](Database &database) {
+      database.select_all();
+      return current_selection(database);
+    })));
+    statusBar()->showMessage(tr("Merged %1 recipes").arg(count), 5000);
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Merging Database"), e.what());
+  };
+}
+
+void MainWindow::attach_cookbook(void) {
+  QString file = QFileDialog::getOpenFileName(this, tr("Attach Cookbook"), "",
+                                              tr("SQLite database (*.sqlite);;All files (*)"));
+  if (file.isEmpty())
+    return;
+  try {
+    // The cookbook is attached read-only and its recipes are listed together with the selected recipes.
+    string filename = file.toUtf8().constData();
+    wait_for(m_database.submit([filename](Database &database) { database.attach_cookbook(filename.c_str()); }));
+    m_readers.attach_cookbook(filename.c_str());
+    // Fetch the titles of the current step of the search history again.
+    invalidate_history();
+    navigate(m_history_index);
+    statusBar()->showMessage(tr("Cookbook attached"), 5000);
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Attaching Cookbook"), e.what());
+  };
+}
+
+void MainWindow::backup(void) {
+  if (m_backup_result.valid()) {
+    QMessageBox::warning(this, tr("Back Up Database"), tr("A backup is already in progress."));
+    return;
+  };
+  QString file = QFileDialog::getSaveFileName(this, tr("Back Up Database"), "anymeal-backup.sqlite",
+                                              tr("SQLite database (*.sqlite);;All files (*)"));
+  if (file.isEmpty())
+    return;
+  // The backup runs on a separate read-only connection so that recipes can be browsed and edited meanwhile.
+  string filename = file.toUtf8().constData();
+  shared_ptr<atomic<int> > percent = m_backup_percent;
+  shared_ptr<atomic<bool> > cancel = m_backup_cancel;
+  *percent = 0;
+  m_backup_result = m_backup_database.submit([filename, percent, cancel](Database &database) {
+    database.backup_to(filename.c_str(), [percent, cancel](int remaining, int total) {
+      *percent = total > 0 ? (total - remaining) * 100 / total : 100;
+      return !*cancel;
+    });
+  });
+  backup_progress();
+  m_backup_timer->start(200);
+}
+
+void MainWindow::backup_progress(void) {
+  if (m_backup_result.wait_for(chrono::seconds(0)) != future_status::ready) {
+    statusBar()->showMessage(tr("Backing up database ... %1%").arg(m_backup_percent->load()));
+    return;
+  };
+  m_backup_timer->stop();
+  try {
+    m_backup_result.get();
+    statusBar()->showMessage(tr("Database backed up"), 5000);
   } catch (exception &e) {
+    statusBar()->clearMessage();
+    QMessageBox::critical(this, tr("Error Backing up Database"), e.what());
+  };
+}
+
+void MainWindow::restore(void) {
+  if (m_backup_result.valid()) {
+    QMessageBox::warning(this, tr("Restore Database"), tr("Please wait for the backup to finish."));
+    return;
+  };
+  QString file = QFileDialog::getOpenFileName(this, tr("Restore Database"), "",
+                                              tr("SQLite database (*.sqlite);;All files (*)"));
+  if (file.isEmpty())
+    return;
+  if (QMessageBox::question(this, tr("Restore Database"), tr("Replace all recipes with the content of the backup?"))
+      != QMessageBox::Yes)
+    return;
+  try {
+    string filename = file.toUtf8().constData();
+    // Disabling the write-ahead log for a backup with another page size fails while other connections are open.
+    close_readers();
     try {
-      m_database.rollback();
+      wait_for(m_database.submit([filename](Database &database) { database.restore_from(filename.c_str()); }));
     } catch (exception &) {
+      open_readers();
+      throw;
     };
-    QGuiApplication::restoreOverrideCursor();
-    QMessageBox::critical(this, tr("Error Collecting Garbage"), e.what());
+    open_readers();
+    // The backup may have been sorted for another language.
+    sort_titles(m_settings.value("language", QLocale::system().name().mid(0, 2)).toString());
+    // Recipe ids of the search history refer to the replaced database.
+    m_history.clear();
+    m_history_index = -1;
+    reset();
+    statusBar()->showMessage(tr("Database restored"), 5000);
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Restoring Database"), e.what());
   };
 }
 
@@ -434,6 +732,19 @@ void MainWindow::open_converter(void) {
   m_converter_window.exec();
 }
 
+void MainWindow::show_profile(void) {
+  try {
+    ProfileDialog dialog(this, &m_database);
+    dialog.exec();
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Reading Statement Profile"), e.what());
+  };
+}
+
+string MainWindow::profile_report(void) {
+  return ::profile_report(m_database.call([](Database &database) { return database.profile(); }));
+}
+
 void MainWindow::about(void) {
   QMessageBox::information(this, tr("About AnyMeal %1").arg(PACKAGE_VERSION), "AnyMeal recipe management software\n"
       "Copyright © 2002 to 2024  Jan Wedekind\n\n"
@@ -465,78 +776,212 @@ void MainWindow::reset_search_history(void)
 
 void MainWindow::filter(void) {
   try {
-    QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+    string title = m_ui.title_edit->text().toUtf8().constData();
+    string category = m_ui.category_edit->text().toUtf8().constData();
+    bool with_category = m_ui.with_category_radio->isChecked();
+    string ingredient = m_ui.ingredient_edit->text().toUtf8().constData();
+    bool with_ingredient = m_ui.with_ingredient_radio->isChecked();
+    string pantry = m_ui.pantry_edit->text().toUtf8().constData();
+    string text = m_ui.text_edit->text().toUtf8().constData();
+    bool ranked = !text.empty() && split_pantry(pantry).empty();
+    // The title field accepts the query language if it uses field prefixes. The other fields are combined with it.
+    query_t query = parse_search(title.c_str());
+    if (!category.empty()) {
+      query_t term = query_term(QUERY_CATEGORY, category);
+      query = query_and(query, with_category ? term : query_not(term));
+    };
+    if (!ingredient.empty()) {
+      query_t term = query_term(QUERY_INGREDIENT, ingredient);
+      query = query_and(query, with_ingredient ? term : query_not(term));
+    };
+    if (!text.empty())
+      query = query_and(query, query_term(QUERY_TEXT, text));
+    // Filters narrow down the current selection. Attached cookbooks are searched with all filters combined.
+    query_t combined = query_and(m_history[m_history_index].query, query);
+    // Filters are applied in a transaction so that cancelling restores the previous selection.
+    Snapshot snapshot = wait_for(m_database.transaction([=](Database &database) {
+      Snapshot result;
+      result.query = combined;
+      database.select_by_query(query);
+      if (!split_pantry(pantry).empty()) {
+        vector<pair<sqlite3_int64, double> > ranking = database.pantry(split_pantry(pantry), PANTRY_RESULTS);
+        for (vector<pair<sqlite3_int64, double> >::iterator recipe=ranking.begin(); recipe!=ranking.end(); recipe++)
+          result.order.push_back(recipe->first);
+        database.select_ids(result.order);
+        // The pantry results fit on the first page of titles.
+        result.selection.titles = database.recipe_info(result.order);
+        result.selection.categories = database.categories();
+        result.selection.count = database.num_recipes();
+      } else if (ranked) {
+        // Ranked results only cover the recipes of the main database.
+        result.selection.titles = database.ranked_recipe_info(text.c_str(), 0, TITLES_PAGE);
+        result.selection.categories = database.categories();
+        result.selection.count = database.num_recipes();
+        result.ranking = text;
+      } else
+        result.selection = current_selection(database, combined);
+      // The selected ids are listed in the same request so that the user interface does not need to wait twice.
+      result.ids.reset(new IdBitmap(database.selection_bitmap()));
+      return result;
+    }));
     m_ui.search_label->show();
-    if (!m_ui.title_edit->text().isEmpty()) {
-      m_database.select_by_title(m_ui.title_edit->text().toUtf8().constData());
-      show_search_history(tr("title").toUtf8().constData(), m_ui.title_edit->text().toUtf8().constData());
-      m_titles_model->reset();
-      m_categories_model->reset();
+    if (!title.empty()) {
+      show_search_history(tr("title").toUtf8().constData(), title.c_str());
       m_ui.title_edit->setText("");
     };
-    if (!m_ui.category_edit->text().isEmpty()) {
-      if (m_ui.with_category_radio->isChecked()) {
-        m_database.select_by_category(m_ui.category_edit->text().toUtf8().constData());
-        show_search_history(tr("category").toUtf8().constData(), m_ui.category_edit->text().toUtf8().constData());
-      } else {
-        m_database.select_by_no_category(m_ui.category_edit->text().toUtf8().constData());
-        show_search_history(tr("not category").toUtf8().constData(), m_ui.category_edit->text().toUtf8().constData());
-      };
-      m_titles_model->reset();
-      m_categories_model->reset();
+    if (!category.empty()) {
+      if (with_category)
+        show_search_history(tr("category").toUtf8().constData(), category.c_str());
+      else
+        show_search_history(tr("not category").toUtf8().constData(), category.c_str());
       m_ui.category_edit->setText("");
     };
-    if (!m_ui.ingredient_edit->text().isEmpty()) {
-      if (m_ui.with_ingredient_radio->isChecked()) {
-        m_database.select_by_ingredient(m_ui.ingredient_edit->text().toUtf8().constData());
-        show_search_history(tr("ingredient").toUtf8().constData(), m_ui.ingredient_edit->text().toUtf8().constData());
-      } else {
-        m_database.select_by_no_ingredient(m_ui.ingredient_edit->text().toUtf8().constData());
-        show_search_history(tr("not ingredient").toUtf8().constData(), m_ui.ingredient_edit->text().toUtf8().constData());
-      };
-      m_titles_model->reset();
-      m_categories_model->reset();
+    if (!ingredient.empty()) {
+      if (with_ingredient)
+        show_search_history(tr("ingredient").toUtf8().constData(), ingredient.c_str());
+      else
+        show_search_history(tr("not ingredient").toUtf8().constData(), ingredient.c_str());
       m_ui.ingredient_edit->setText("");
     };
-    show_num_recipes();
-    QGuiApplication::restoreOverrideCursor();
+    if (!pantry.empty()) {
+      show_search_history(tr("pantry").toUtf8().constData(), pantry.c_str());
+      m_ui.pantry_edit->setText("");
+    };
+    if (!text.empty()) {
+      show_search_history(tr("text").toUtf8().constData(), text.c_str());
+      m_ui.text_edit->setText("");
+    };
+    push_history(snapshot);
+    show_snapshot(m_history[m_history_index]);
   } catch (exception &e) {
-    QGuiApplication::restoreOverrideCursor();
     QMessageBox::critical(this, tr("Error Filtering Recipes"), e.what());
   };
 }
 
 void MainWindow::reset(void) {
   try {
-    QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    m_database.select_all();
+    Selection selection = wait_for(m_database.submit([](Database &database) {
+      database.select_all();
+      return current_selection(database);
+    }));
     reset_search_history();
-    m_titles_model->reset();
-    m_categories_model->reset();
-    show_num_recipes();
-    QGuiApplication::restoreOverrideCursor();
+    Snapshot snapshot;
+    snapshot.selection = selection;
+    push_history(snapshot);
+    show_selection(selection);
   } catch (exception &e) {
-    QGuiApplication::restoreOverrideCursor();
     QMessageBox::critical(this, tr("Error Resetting Selection"), e.what());
   };
 }
 
+void MainWindow::show_snapshot(const Snapshot &snapshot) {
+  show_selection(snapshot.selection, snapshot.query);
+  if (!snapshot.ranking.empty()) {
+    string text = snapshot.ranking;
+    m_titles_model->reset(snapshot.selection.titles, snapshot.selection.count,
+                          [this, text](int offset, const pair<sqlite3_int64, string_view> &, int count, StringPool &pool) {
+      return m_database.call([=, &pool](Database &database) {
+        return database.ranked_recipe_info(text.c_str(), offset, count, pool);
+      });
+    });
+  };
+  m_ui.search_label->setText(snapshot.label);
+  m_ui.search_label->setVisible(!snapshot.label.isEmpty());
+}
+
+void MainWindow::push_history(Snapshot snapshot) {
+  snapshot.label = m_ui.search_label->text();
+  snapshot.stale = false;
+  // Taking a new step discards the steps which could be reached with "forward".
+  m_history.erase(m_history.begin() + m_history_index + 1, m_history.end());
+  m_history.push_back(snapshot);
+  if (m_history.size() > HISTORY_SIZE)
+    m_history.erase(m_history.begin());
+  m_history_index = m_history.size() - 1;
+  m_ui.action_back->setEnabled(m_history_index > 0);
+  m_ui.action_forward->setEnabled(false);
+}
+
+void MainWindow::invalidate_history(void) {
+  for (vector<Snapshot>::iterator snapshot=m_history.begin(); snapshot!=m_history.end(); snapshot++)
+    snapshot->stale = true;
+}
+
+void MainWindow::navigate(int index) {
+  try {
+    Snapshot &snapshot = m_history[index];
+    shared_ptr<const IdBitmap> ids = snapshot.ids;
+    if (snapshot.stale) {
+      // Recipes were changed after the snapshot was taken. The titles and categories need to be fetched again.
+      string ranking = snapshot.ranking;
+      vector<sqlite3_int64> order = snapshot.order;
+      query_t query = snapshot.query;
+      snapshot.selection = wait_for(m_database.transaction([ids, ranking, order, query](Database &database) {
+        restore_selection(database, ids);
+        Selection result;
+        if (!ranking.empty() || !order.empty()) {
+          // Ranked results only cover the recipes of the main database.
+          if (!ranking.empty())
+            result.titles = database.ranked_recipe_info(ranking.c_str(), 0, TITLES_PAGE);
+          else
+            result.titles = database.recipe_info(order);
+          result.categories = database.categories();
+          result.count = database.num_recipes();
+        } else
+          result = current_selection(database, query);
+        return result;
+      }));
+      snapshot.stale = false;
+      show_history(index);
+    } else {
+      // The stored titles are shown right away while the database thread restores the selection.
+      future<void> restored = m_database.transaction([ids](Database &database) { restore_selection(database, ids); });
+      long request = m_database.last_request();
+      show_history(index);
+      wait_for(move(restored), request);
+    };
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Restoring Selection"), e.what());
+  };
+}
+
+void MainWindow::show_history(int index) {
+  m_history_index = index;
+  m_ui.action_back->setEnabled(m_history_index > 0);
+  m_ui.action_forward->setEnabled(m_history_index < (int)m_history.size() - 1);
+  show_snapshot(m_history[index]);
+}
+
+void MainWindow::back(void) {
+  if (m_history_index > 0)
+    navigate(m_history_index - 1);
+}
+
+void MainWindow::forward(void) {
+  if (m_history_index < (int)m_history.size() - 1)
+    navigate(m_history_index + 1);
+}
+
 string MainWindow::translate(const char *context, const char *text) {
   return QCoreApplication::translate(context, text).toUtf8().constData();
 }
 
 void MainWindow::selected(const QModelIndex &current, const QModelIndex &) {
   try {
-    QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
     if (current.isValid()) {
-      Recipe recipe = m_database.fetch_recipe(m_titles_model->recipeid(current));
-      set_recipe(recipe);
+      sqlite3_int64 id = m_titles_model->recipeid(current);
+      Recipe recipe;
+      string html;
+      if (m_prefetcher.lookup(id, recipe, html)) {
+        m_recipe = recipe;
+        m_ui.recipe_browser->setHtml(html.c_str());
+      } else
+        set_recipe(wait_for(m_database.submit([id](Database &database) { return database.fetch_recipe(id); })));
+      prefetch(current);
     } else {
       m_ui.recipe_browser->clear();
     };
-    QGuiApplication::restoreOverrideCursor();
   } catch (exception &e) {
-    QGuiApplication::restoreOverrideCursor();
     QMessageBox::critical(this, tr("Error fetching recipe"), e.what());
   };
 }
@@ -549,6 +994,15 @@ void MainWindow::recipe_context_menu(const QPoint &pos) {
   m_recipe_context_menu->popup(m_ui.recipe_browser->viewport()->mapToGlobal(pos));
 }
 
+bool MainWindow::read_only(const vector<sqlite3_int64> &ids, const QString &title) {
+  for (vector<sqlite3_int64>::const_iterator id=ids.begin(); id!=ids.end(); id++)
+    if (Database::cookbook_of(*id) > 0) {
+      QMessageBox::warning(this, title, tr("Recipes of attached cookbooks are read-only."));
+      return true;
+    };
+  return false;
+}
+
 vector<sqlite3_int64> MainWindow::recipe_ids(void) {
   vector<sqlite3_int64> result;
   QItemSelectionModel *model = m_ui.titles_view->selectionModel();
@@ -579,10 +1033,12 @@ void MainWindow::export_recipes(void) {
           ofstream output_file(result.toUtf8().constData(), ofstream::binary);
           QProgressDialog progress(tr("Exporting recipes ..."), tr("Cancel"), 0, ids.size(), this);
           progress.setWindowModality(Qt::WindowModal);
+          // Export a consistent snapshot without blocking the database thread.
+          ReadPool::Lease reader(m_readers);
+          reader->begin();
           for (unsigned int i=0; i<ids.size(); i++) {
             progress.setValue(i);
-            sqlite3_int64 id = ids[i];
-            Recipe recipe = m_database.fetch_recipe(id);
+            Recipe recipe = reader->fetch_recipe(ids[i]);
             try {
               Recipe recoded;
               if (m_export_dialog.encoding() == "UTF-8") {
@@ -614,6 +1070,7 @@ void MainWindow::export_recipes(void) {
             };
             progress.setLabelText(tr("%1 exported and %2 failed ...").arg(success).arg(failed));
           };
+          reader->commit();
           progress.setValue(ids.size());
           QMessageBox::information(this, tr("Recipes Exported"), tr("%1 exported and %2 failed.").arg(success).arg(failed));
         };
@@ -626,26 +1083,17 @@ void MainWindow::export_recipes(void) {
 
 void MainWindow::delete_recipes(void) {
   vector<sqlite3_int64> ids = recipe_ids();
-  if (!ids.empty()) {
+  if (!ids.empty() && !read_only(ids, tr("Delete Recipes"))) {
     if (QMessageBox::question(this, tr("Delete Recipes"), tr("Do you want to delete the selected recipes?")) == QMessageBox::Yes) {
-      bool transaction = false;
       try {
-        QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-        m_database.begin();
-        transaction = true;
-        m_database.delete_recipes(ids);
-        m_database.commit();
-        transaction = false;
-        m_titles_model->reset();
-        m_categories_model->reset();
-        QGuiApplication::restoreOverrideCursor();
+        query_t query = m_history[m_history_index].query;
+        show_selection(wait_for(m_database.transaction([ids, query](Database &database) {
+          database.delete_recipes(ids);
+          return current_selection(database, query);
+        })), query);
+        m_prefetcher.clear();
+        invalidate_history();
       } catch (exception &e) {
-        try {
-          if (transaction)
-            m_database.rollback();
-        } catch (exception &) {
-        };
-        QGuiApplication::restoreOverrideCursor();
         QMessageBox::critical(this, tr("Error Deleting Recipes"), e.what());
       };
     };
@@ -665,13 +1113,73 @@ void MainWindow::print(void) {
   };
 }
 
+// Lay out a document on the pages of the printer in the same way as QTextDocument::print.
+static void print_document(QPainter &painter, QPrinter *printer, QTextDocument &document, int &page) {
+  int margin = (int)((2 / 2.54) * printer->logicalDpiY());
+  QTextFrameFormat format = document.rootFrame()->frameFormat();
+  format.setMargin(margin);
+  document.rootFrame()->setFrameFormat(format);
+  document.documentLayout()->setPaintDevice(printer);
+  QSizeF body(printer->width(), printer->height());
+  document.setPageSize(body);
+  QPointF number_position(body.width() - margin,
+                          body.height() - margin + QFontMetrics(document.defaultFont(), printer).ascent() + 5 * printer->logicalDpiY() / 72.0);
+  for (int i=0; i<document.pageCount(); i++) {
+    if (page > 0)
+      printer->newPage();
+    page++;
+    QRectF view(0, i * body.height(), body.width(), body.height());
+    painter.save();
+    painter.translate(0, -view.top());
+    painter.setClipRect(view);
+    QAbstractTextDocumentLayout::PaintContext context;
+    context.clip = view;
+    context.palette.setColor(QPalette::Text, Qt::black);
+    document.documentLayout()->draw(&painter, context);
+    painter.setClipping(false);
+    painter.setFont(document.defaultFont());
+    QString number = QString::number(page);
+    painter.drawText(qRound(number_position.x() - painter.fontMetrics().horizontalAdvance(number)),
+                     qRound(number_position.y() + view.top()), number);
+    painter.restore();
+  };
+}
+
 void MainWindow::render(QPrinter *printer) {
-  QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-  QTextBrowser text_browser;
-  vector<Recipe> recipes = m_database.fetch_recipes(recipe_ids());
-  text_browser.setHtml(recipes_to_html(recipes, &translate).c_str());
-  text_browser.print(printer);
-  QGuiApplication::restoreOverrideCursor();
+  // Recipes are fetched, rendered, and printed in chunks so that memory use does not grow with the selection.
+  vector<sqlite3_int64> ids = recipe_ids();
+  QProgressDialog progress(tr("Printing recipes ..."), tr("Cancel"), 0, ids.size(), this);
+  progress.setWindowModality(Qt::WindowModal);
+  QPainter painter;
+  if (!painter.begin(printer))
+    return;
+  // The next chunk is fetched while the current one is laid out.
+  auto fetch = [this, &ids](size_t offset) {
+    vector<sqlite3_int64> chunk(ids.begin() + offset, ids.begin() + min(offset + PRINT_CHUNK, ids.size()));
+    return async(launch::async, [this, chunk]() {
+      return m_readers.read([chunk](Database &database) { return database.fetch_recipes(chunk); });
+    });
+  };
+  HtmlRenderer renderer(&translate);
+  int page = 0;
+  try {
+    future<vector<Recipe> > next = fetch(0);
+    for (size_t offset=0; offset<ids.size(); offset+=PRINT_CHUNK) {
+      vector<Recipe> recipes = next.get();
+      if (offset + PRINT_CHUNK < ids.size())
+        next = fetch(offset + PRINT_CHUNK);
+      const string &html = renderer.recipes_to_html(recipes);
+      QTextDocument document;
+      document.setHtml(QString::fromUtf8(html.data(), html.size()));
+      print_document(painter, printer, document, page);
+      progress.setValue(offset + recipes.size());
+      if (progress.wasCanceled())
+        break;
+    };
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Printing Recipes"), e.what());
+  };
+  painter.end();
 }
 
 void MainWindow::remove_duplicates(void) {
@@ -680,26 +1188,35 @@ void MainWindow::remove_duplicates(void) {
   vector<sqlite3_int64> recipes_to_delete;
   QProgressDialog progress(tr("Detecting duplicates ..."), tr("Cancel"), 0, ids.size(), this);
   progress.setWindowModality(Qt::WindowModal);
+  ReadPool::Lease reader(m_readers);
+  reader->begin();
   for (unsigned int i=0; i<ids.size(); i++) {
     progress.setLabelText(tr("Found %1 duplicates ...").arg(recipes_to_delete.size()));
     progress.setValue(i);
     sqlite3_int64 id = ids[i];
-    Recipe recipe = m_database.fetch_recipe(id);
+    Recipe recipe = reader->fetch_recipe(id);
     string txt = recipe_to_mealmaster(recipe);
-    if (recipes.find(txt) != recipes.end())
-      recipes_to_delete.push_back(id);
-    else
+    if (recipes.find(txt) != recipes.end()) {
+      // Duplicates in attached cookbooks are kept because the cookbooks are read-only.
+      if (Database::cookbook_of(id) == 0)
+        recipes_to_delete.push_back(id);
+    } else
       recipes.insert(txt);
     if (progress.wasCanceled())
       break;
   };
+  reader->commit();
   if (!progress.wasCanceled()) {
-    QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    m_database.begin();
-    m_database.delete_recipes(recipes_to_delete);
-    m_database.commit();
-    m_titles_model->reset();
-    m_categories_model->reset();
-    QGuiApplication::restoreOverrideCursor();
+    try {
+      query_t query = m_history[m_history_index].query;
+      show_selection(wait_for(m_database.transaction([recipes_to_delete, query](Database &database) {
+        database.delete_recipes(recipes_to_delete);
+        return current_selection(database, query);
+      })), query);
+      m_prefetcher.clear();
+      invalidate_history();
+    } catch (exception &e) {
+      QMessageBox::critical(this, tr("Error Deleting Recipes"), e.what());
+    };
   };
 }
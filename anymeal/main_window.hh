@@ -14,14 +14,19 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
 #pragma once
+#include <atomic>
+#include <future>
+#include <memory>
 #include <vector>
 #include <QtCore/QTranslator>
 #include <QtCore/QSettings>
+#include <QtCore/QTimer>
 #include <QtWidgets/QMainWindow>
 #include <QtWidgets/QCompleter>
 #include <QtPrintSupport/QPrinter>
 #include "ui_main_window.hh"
-#include "database.hh"
+#include "async_database.hh"
+#include "read_pool.hh"
 #include "category_picker.hh"
 #include "titles_model.hh"
 #include "categories_model.hh"
@@ -29,6 +34,8 @@
 #include "converter_window.hh"
 #include "import_dialog.hh"
 #include "export_dialog.hh"
+#include "prefetch.hh"
+#include "query.hh"
 #include "recipe.hh"
 
 
@@ -42,32 +49,74 @@ protected:
   std::string m_error;
 };
 
+// Recipe titles, categories, and number of recipes of the current selection.
+struct Selection
+{
+  std::vector<std::pair<sqlite3_int64, std::string> > titles;
+  std::vector<std::string> categories;
+  int count;
+};
+
+// Step of the search history. The stored titles are shown directly when navigating and the recipe ids are used to
+// restore the selection of the database. A snapshot without ids stands for all recipes. Ranked snapshots keep the search
+// text or the order of the pantry results so that the ranking survives fetching the titles again. The combined query is
+// used to search attached cookbooks.
+struct Snapshot
+{
+  std::shared_ptr<const IdBitmap> ids;
+  Selection selection;
+  QString label;
+  std::string ranking;
+  std::vector<sqlite3_int64> order;
+  query_t query;
+  bool stale;
+};
+
 typedef enum { EDIT_CURRENT = 0, EDIT_COPY, EDIT_NEW, EDIT_CANCEL } EditMode;
 
 class MainWindow: public QMainWindow
 {
   Q_OBJECT
 public:
-  MainWindow(QWidget *parent=NULL);
+  MainWindow(QWidget *parent=NULL, bool profile_sql=false);
+  virtual ~MainWindow(void);
+  static QString database_path(void);
+  void open_readers(void);
+  void close_readers(void);
+  std::string profile_report(void);
   static std::string translate(const char *context, const char *text);
   std::vector<sqlite3_int64> recipe_ids(void);
-  void show_num_recipes(void);
+  bool read_only(const std::vector<sqlite3_int64> &ids, const QString &title);
+  void show_num_recipes(int count);
+  void show_selection(const Selection &selection, query_t query=query_t());
+  void update_categories(void);
   EditMode editing_mode(void);
   Recipe default_recipe(void);
   void edit_recipe(EditMode mode);
   void show_search_history(const char *type, const char *text);
   void reset_search_history(void);
+  void show_snapshot(const Snapshot &snapshot);
+  void push_history(Snapshot snapshot);
+  void invalidate_history(void);
+  void navigate(int index);
+  void show_history(int index);
   void switch_language(const QString &country);
   void switch_and_set_language(const char *country);
+  void sort_titles(const QString &country);
   void set_recipe(Recipe recipe);
+  void prefetch(const QModelIndex &index);
 public slots:
   void import(void);
   void new_recipe(void);
   void edit(void);
   void collect_garbage(void);
+  void compress_instructions(void);
+  void set_compact_storage(bool compact);
   void about(void);
   void filter(void);
   void reset(void);
+  void back(void);
+  void forward(void);
   void selected(const QModelIndex &current, const QModelIndex &previous);
   void titles_context_menu(const QPoint &pos);
   void recipe_context_menu(const QPoint &pos);
@@ -85,22 +134,42 @@ public slots:
   void language_nl(void);
   void language_sl(void);
   void open_converter(void);
+  void show_profile(void);
   void remove_duplicates(void);
+  void merge_database(void);
+  void attach_cookbook(void);
+  void backup(void);
+  void backup_progress(void);
+  void restore(void);
 protected:
   bool eventFilter(QObject *object, QEvent *event);
+  template <typename T>
+  T wait_for(std::future<T> result);
+  template <typename T>
+  T wait_for(std::future<T> result, long request);
   Ui::MainWindow m_ui;
   QSettings m_settings;
   Recipe m_recipe;
   QTranslator *m_translator;
-  Database m_database;
+  AsyncDatabase m_database;
+  AsyncDatabase m_backup_database;
+  std::future<void> m_backup_result;
+  std::shared_ptr<std::atomic<int> > m_backup_percent;
+  std::shared_ptr<std::atomic<bool> > m_backup_cancel;
+  QTimer *m_backup_timer;
+  ReadPool m_readers;
+  Prefetcher m_prefetcher;
   ConverterWindow m_converter_window;
   ImportDialog m_import_dialog;
   ExportDialog m_export_dialog;
   CategoryPicker m_category_picker;
+  StringPool m_category_names;
   TitlesModel *m_titles_model;
   CategoriesModel *m_categories_model;
   CategoryTableModel *m_category_table_model;
   QCompleter *m_categories_completer;
   QMenu *m_titles_context_menu;
   QMenu *m_recipe_context_menu;
+  std::vector<Snapshot> m_history;
+  int m_history_index;
 };
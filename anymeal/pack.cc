@@ -0,0 +1,347 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#ifdef __MINGW32__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "blob.hh"
+#include "database.hh"
+#include "pack.hh"
+
+
+using namespace std;
+
+RecipePack::RecipePack(void): m_data(NULL), m_size(0), m_header(NULL), m_file(NULL), m_mapping(NULL)
+{
+}
+
+RecipePack::~RecipePack(void) {
+  close();
+}
+
+void RecipePack::open(const char *filename) {
+  close();
+#ifdef __MINGW32__
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    throw pack_exception(string("Error opening recipe pack ") + filename);
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || (size_t)size.QuadPart < sizeof(PackHeader)) {
+    CloseHandle(file);
+    throw pack_exception(string(filename) + " is not a recipe pack.");
+  };
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  const void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+  if (!data) {
+    if (mapping)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    throw pack_exception(string("Error mapping recipe pack ") + filename);
+  };
+  m_file = file;
+  m_mapping = mapping;
+  m_size = size.QuadPart;
+#else
+  int file = ::open(filename, O_RDONLY);
+  if (file < 0)
+    throw pack_exception(string("Error opening recipe pack ") + filename + ": " + strerror(errno));
+  struct stat status;
+  if (fstat(file, &status) != 0 || (size_t)status.st_size < sizeof(PackHeader)) {
+    ::close(file);
+    throw pack_exception(string(filename) + " is not a recipe pack.");
+  };
+  void *data = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+  ::close(file);
+  if (data == MAP_FAILED)
+    throw pack_exception(string("Error mapping recipe pack ") + filename + ": " + strerror(errno));
+  m_size = status.st_size;
+#endif
+  m_data = (const char *)data;
+  m_header = (const PackHeader *)m_data;
+  // Only the header is checked here. Everything else is checked when it is accessed.
+  try {
+    if (memcmp(m_header->magic, PACK_MAGIC, sizeof(m_header->magic)) != 0)
+      throw pack_exception(string(filename) + " is not a recipe pack.");
+    if (m_header->version != PACK_VERSION)
+      throw pack_exception(string("Recipe pack ") + filename + " has an unsupported version.");
+    if (m_header->byte_order != PACK_BYTE_ORDER)
+      throw pack_exception(string("Recipe pack ") + filename + " was created on a machine with a different byte order.");
+    if (m_header->size != m_size)
+      throw pack_exception(string("Recipe pack ") + filename + " is truncated.");
+    table(m_header->recipes, m_header->num_recipes, sizeof(PackRecipe));
+    table(m_header->ids, m_header->num_recipes, sizeof(uint32_t));
+    table(m_header->categories, m_header->num_categories, sizeof(PackIndex));
+    table(m_header->ingredients, m_header->num_ingredients, sizeof(PackIndex));
+  } catch (pack_exception &) {
+    close();
+    throw;
+  };
+}
+
+void RecipePack::close(void) {
+  if (!m_data)
+    return;
+#ifdef __MINGW32__
+  UnmapViewOfFile(m_data);
+  CloseHandle((HANDLE)m_mapping);
+  CloseHandle((HANDLE)m_file);
+#else
+  munmap((void *)m_data, m_size);
+#endif
+  m_data = NULL;
+  m_size = 0;
+  m_header = NULL;
+  m_file = NULL;
+  m_mapping = NULL;
+}
+
+const void *RecipePack::table(uint64_t offset, uint64_t count, size_t size) const {
+  // Tables must be inside the file and aligned so that their entries can be accessed directly.
+  if (!m_data || offset > m_size || count > (m_size - offset) / size || offset % min(size, sizeof(uint64_t)) != 0)
+    throw pack_exception("Recipe pack is corrupt.");
+  return m_data + offset;
+}
+
+int RecipePack::size(void) const {
+  return m_header ? m_header->num_recipes : 0;
+}
+
+const PackRecipe &RecipePack::entry(int number) const {
+  if (number < 0 || number >= size())
+    throw pack_exception("Recipe number is out of range.");
+  return ((const PackRecipe *)(m_data + m_header->recipes))[number];
+}
+
+string_view RecipePack::view(const PackString &text) const {
+  // The terminating zero is checked so that the data of the view can be used as a C string.
+  const char *data = (const char *)table(text.offset, (uint64_t)text.size + 1, 1);
+  if (data[text.size] != '\0')
+    throw pack_exception("Recipe pack is corrupt.");
+  return string_view(data, text.size);
+}
+
+sqlite3_int64 RecipePack::id(int number) const {
+  return entry(number).id;
+}
+
+string_view RecipePack::title(int number) const {
+  return view(entry(number).title);
+}
+
+Recipe RecipePack::recipe(int number) const {
+  const PackRecipe &source = entry(number);
+  Recipe result;
+  result.set_title(view(source.title).data());
+  result.set_servings(source.servings);
+  result.set_servings_unit(view(source.servings_unit).data());
+  const uint32_t *categories = (const uint32_t *)table(source.categories, source.num_categories, sizeof(uint32_t));
+  for (uint32_t i=0; i<source.num_categories; i++)
+    result.add_category(category(categories[i]).data());
+  string_view body = view(source.body);
+  try {
+    blob_to_recipe_body(body.data(), body.size(), result);
+  } catch (blob_exception &e) {
+    throw pack_exception(e.what());
+  };
+  return result;
+}
+
+int RecipePack::find(sqlite3_int64 id) const {
+  if (!m_header)
+    return -1;
+  const uint32_t *ids = (const uint32_t *)(m_data + m_header->ids);
+  const uint32_t *end = ids + m_header->num_recipes;
+  const uint32_t *number = lower_bound(ids, end, id, [this](uint32_t number, sqlite3_int64 id) { return entry(number).id < id; });
+  if (number == end || entry(*number).id != id)
+    return -1;
+  return *number;
+}
+
+vector<pair<sqlite3_int64, string_view> > RecipePack::titles(int offset, int count) const {
+  vector<pair<sqlite3_int64, string_view> > result;
+  for (int number=offset; number<min(offset + count, size()); number++)
+    result.push_back(make_pair(id(number), title(number)));
+  return result;
+}
+
+int RecipePack::num_categories(void) const {
+  return m_header ? m_header->num_categories : 0;
+}
+
+string_view RecipePack::category(int number) const {
+  if (number < 0 || number >= num_categories())
+    throw pack_exception("Category number is out of range.");
+  return view(((const PackIndex *)(m_data + m_header->categories))[number].name);
+}
+
+pack_range_t RecipePack::lookup(uint64_t offset, uint32_t count, const char *name) const {
+  const PackIndex *begin = (const PackIndex *)table(offset, count, sizeof(PackIndex));
+  const PackIndex *end = begin + count;
+  const PackIndex *index = lower_bound(begin, end, string_view(name), [this](const PackIndex &index, string_view name) {
+    return view(index.name) < name;
+  });
+  if (index == end || view(index->name) != name)
+    return pack_range_t(NULL, NULL);
+  const uint32_t *recipes = (const uint32_t *)table(index->recipes, index->num_recipes, sizeof(uint32_t));
+  return pack_range_t(recipes, recipes + index->num_recipes);
+}
+
+pack_range_t RecipePack::recipes_in_category(const char *name) const {
+  if (!m_header)
+    return pack_range_t(NULL, NULL);
+  return lookup(m_header->categories, m_header->num_categories, name);
+}
+
+pack_range_t RecipePack::recipes_with_ingredient(const char *name) const {
+  if (!m_header)
+    return pack_range_t(NULL, NULL);
+  return lookup(m_header->ingredients, m_header->num_ingredients, name);
+}
+
+void browse_pack(TitleList &titles, const RecipePack &pack) {
+  vector<pair<sqlite3_int64, string_view> > page = pack.titles(0, TITLES_PAGE);
+  titles.reset(vector<pair<sqlite3_int64, string> >(page.begin(), page.end()), pack.size(), pack_titles(pack));
+}
+
+TitleList::fetch_t pack_titles(const RecipePack &pack) {
+  // The pack is sorted by title so that pages are fetched by offset.
+  return [&pack](int offset, const pair<sqlite3_int64, string_view> &, int count, StringPool &) {
+    return pack.titles(offset, count);
+  };
+}
+
+string pack_recipe_to_html(const RecipePack &pack, sqlite3_int64 id, string (*translate)(const char *, const char *)) {
+  int number = pack.find(id);
+  if (number < 0)
+    throw pack_exception("Recipe is not part of the recipe pack.");
+  Recipe recipe = pack.recipe(number);
+  return recipe_to_html(recipe, translate);
+}
+
+template <typename T>
+static void append(string &output, const T &value) {
+  output.append((const char *)&value, sizeof(T));
+}
+
+static void align(string &output, size_t alignment) {
+  output.resize((output.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+static PackString append_string(string &output, const string &text) {
+  PackString result;
+  memset(&result, 0, sizeof(result));
+  result.offset = output.size();
+  result.size = text.size();
+  output += text;
+  output += '\0';
+  return result;
+}
+
+static uint64_t append_index(string &output, const map<string, vector<uint32_t> > &postings) {
+  vector<PackIndex> indices;
+  for (map<string, vector<uint32_t> >::const_iterator posting=postings.begin(); posting!=postings.end(); posting++) {
+    PackIndex index;
+    memset(&index, 0, sizeof(index));
+    index.name = append_string(output, posting->first);
+    align(output, sizeof(uint32_t));
+    index.recipes = output.size();
+    index.num_recipes = posting->second.size();
+    output.append((const char *)posting->second.data(), posting->second.size() * sizeof(uint32_t));
+    indices.push_back(index);
+  };
+  align(output, sizeof(uint64_t));
+  uint64_t result = output.size();
+  for (vector<PackIndex>::iterator index=indices.begin(); index!=indices.end(); index++)
+    append(output, *index);
+  return result;
+}
+
+void write_pack(Database &database, const char *filename) {
+  // The tables of recipes and ids are at the start. Strings, recipe bodies, and the name indices follow.
+  vector<pair<sqlite3_int64, string> > infos = database.recipe_info();
+  uint32_t count = infos.size();
+  map<string, vector<uint32_t> > category_recipes;
+  vector<pair<string, int> > categories = database.categories_and_counts();
+  for (vector<pair<string, int> >::iterator category=categories.begin(); category!=categories.end(); category++)
+    category_recipes[category->first];
+  map<string, uint32_t> category_numbers;
+  for (map<string, vector<uint32_t> >::iterator category=category_recipes.begin(); category!=category_recipes.end(); category++)
+    category_numbers[category->first] = category_numbers.size();
+  map<string, vector<uint32_t> > ingredient_recipes;
+  PackHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+  header.version = PACK_VERSION;
+  header.byte_order = PACK_BYTE_ORDER;
+  header.num_recipes = count;
+  header.recipes = sizeof(PackHeader);
+  header.ids = header.recipes + count * sizeof(PackRecipe);
+  string output(header.ids + count * sizeof(uint32_t), '\0');
+  vector<PackRecipe> recipes(count);
+  for (uint32_t number=0; number<count; number++) {
+    Recipe recipe = database.fetch_recipe(infos[number].first);
+    PackRecipe &entry = recipes[number];
+    memset(&entry, 0, sizeof(entry));
+    entry.id = infos[number].first;
+    entry.title = append_string(output, recipe.title());
+    entry.servings = recipe.servings();
+    entry.servings_unit = append_string(output, recipe.servings_unit());
+    entry.body = append_string(output, recipe_body_to_blob(recipe));
+    align(output, sizeof(uint32_t));
+    entry.categories = output.size();
+    entry.num_categories = recipe.categories().size();
+    for (set<string>::iterator category=recipe.categories().begin(); category!=recipe.categories().end(); category++) {
+      map<string, uint32_t>::iterator category_number = category_numbers.find(*category);
+      if (category_number == category_numbers.end())
+        throw pack_exception("Recipe category is missing in list of categories.");
+      append(output, category_number->second);
+      category_recipes[*category].push_back(number);
+    };
+    set<string> ingredients;
+    for (vector<Ingredient>::iterator ingredient=recipe.ingredients().begin(); ingredient!=recipe.ingredients().end(); ingredient++)
+      if (ingredients.insert(ingredient->text()).second)
+        ingredient_recipes[ingredient->text()].push_back(number);
+  };
+  header.num_categories = category_recipes.size();
+  header.categories = append_index(output, category_recipes);
+  header.num_ingredients = ingredient_recipes.size();
+  header.ingredients = append_index(output, ingredient_recipes);
+  header.size = output.size();
+  vector<uint32_t> ids(count);
+  for (uint32_t number=0; number<count; number++)
+    ids[number] = number;
+  sort(ids.begin(), ids.end(), [&recipes](uint32_t a, uint32_t b) { return recipes[a].id < recipes[b].id; });
+  memcpy(&output[0], &header, sizeof(header));
+  if (count > 0) {
+    memcpy(&output[header.recipes], recipes.data(), count * sizeof(PackRecipe));
+    memcpy(&output[header.ids], ids.data(), count * sizeof(uint32_t));
+  };
+  ofstream file(filename, ios::binary);
+  file.write(output.data(), output.size());
+  file.close();
+  if (!file)
+    throw pack_exception(string("Error writing recipe pack ") + filename);
+}
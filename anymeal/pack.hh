@@ -0,0 +1,138 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sqlite3.h>
+#include "recipe.hh"
+#include "html.hh"
+#include "title_list.hh"
+
+
+#define PACK_MAGIC "AMLPACK"
+#define PACK_VERSION 1
+// Written in the native byte order so that readers on machines with a different byte order can reject the pack.
+#define PACK_BYTE_ORDER 0x01020304
+
+class Database;
+
+class pack_exception: public std::exception
+{
+public:
+  pack_exception(const std::string &error): m_error(error) {}
+  virtual ~pack_exception(void) throw() {}
+  virtual const char *what(void) const throw() { return m_error.c_str(); }
+protected:
+  std::string m_error;
+};
+
+// Zero-terminated string stored at the given offset of the pack.
+struct PackString
+{
+  uint64_t offset;
+  uint32_t size;
+  uint32_t reserved;
+};
+
+struct PackHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t size;
+  uint32_t num_recipes;
+  uint32_t num_categories;
+  uint32_t num_ingredients;
+  uint32_t reserved;
+  // Table of recipes sorted by title.
+  uint64_t recipes;
+  // Numbers of the recipes sorted by id.
+  uint64_t ids;
+  // Tables of category and ingredient names sorted by name.
+  uint64_t categories;
+  uint64_t ingredients;
+};
+
+struct PackRecipe
+{
+  int64_t id;
+  PackString title;
+  PackString servings_unit;
+  // Ingredients, instructions, and sections in the format of the database blobs.
+  PackString body;
+  int32_t servings;
+  uint32_t num_categories;
+  // Numbers of the categories of the recipe.
+  uint64_t categories;
+};
+
+// Name of a category or ingredient with the ascending numbers of the recipes using it.
+struct PackIndex
+{
+  PackString name;
+  uint64_t recipes;
+  uint32_t num_recipes;
+  uint32_t reserved;
+};
+
+// Range of recipe numbers in the pack.
+typedef std::pair<const uint32_t *, const uint32_t *> pack_range_t;
+
+// Immutable recipe collection in a single file which is mapped into memory. Recipes are numbered in the order of their titles.
+// The header, byte order, and table offsets are checked when opening the pack. Strings are checked when they are accessed.
+class RecipePack
+{
+public:
+  RecipePack(void);
+  virtual ~RecipePack(void);
+  void open(const char *filename);
+  void close(void);
+  int size(void) const;
+  sqlite3_int64 id(int number) const;
+  std::string_view title(int number) const;
+  Recipe recipe(int number) const;
+  // Number of the recipe with the given id or -1 if it is not part of the pack.
+  int find(sqlite3_int64 id) const;
+  // Page of recipe ids and titles as used by the list of titles.
+  std::vector<std::pair<sqlite3_int64, std::string_view> > titles(int offset, int count) const;
+  int num_categories(void) const;
+  std::string_view category(int number) const;
+  pack_range_t recipes_in_category(const char *name) const;
+  pack_range_t recipes_with_ingredient(const char *name) const;
+protected:
+  const void *table(uint64_t offset, uint64_t count, size_t size) const;
+  const PackRecipe &entry(int number) const;
+  std::string_view view(const PackString &text) const;
+  pack_range_t lookup(uint64_t offset, uint32_t count, const char *name) const;
+  const char *m_data;
+  size_t m_size;
+  const PackHeader *m_header;
+  void *m_file;
+  void *m_mapping;
+};
+
+// Show the titles of the pack in a list of titles. The titles refer to the mapped file which must stay open.
+void browse_pack(TitleList &titles, const RecipePack &pack);
+TitleList::fetch_t pack_titles(const RecipePack &pack);
+// Render the recipe with the given id in the same way as recipes of the database.
+std::string pack_recipe_to_html(const RecipePack &pack, sqlite3_int64 id,
+                                std::string (*translate)(const char *, const char *)=&notrans);
+
+// Write the selected recipes of the database to a pack file.
+void write_pack(Database &database, const char *filename);
@@ -0,0 +1,154 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <set>
+#include "prefetch.hh"
+
+
+using namespace std;
+
+Prefetcher::Prefetcher(void): m_translate(&notrans), m_busy(false), m_stop(false), m_generation(0)
+{
+}
+
+Prefetcher::~Prefetcher(void) {
+  stop();
+}
+
+void Prefetcher::open(const char *filename, string (*translate)(const char *, const char *)) {
+  m_database.open(filename, true);
+  m_translate = translate;
+  m_stop = false;
+  m_thread = thread(&Prefetcher::run, this);
+}
+
+void Prefetcher::close(void) {
+  stop();
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_wanted.clear();
+    m_cache.clear();
+    m_generation++;
+    m_busy = false;
+  }
+  m_idle.notify_all();
+  m_database.close();
+}
+
+void Prefetcher::stop(void) {
+  if (m_thread.joinable()) {
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_request.notify_one();
+    m_thread.join();
+  };
+}
+
+void Prefetcher::prefetch(const vector<sqlite3_int64> &ids) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_wanted = ids;
+    // Only keep recipes which are still in the neighbourhood of the current one.
+    set<sqlite3_int64> wanted(ids.begin(), ids.end());
+    map<sqlite3_int64, pair<Recipe, string> >::iterator entry = m_cache.begin();
+    while (entry != m_cache.end()) {
+      if (wanted.find(entry->first) == wanted.end())
+        entry = m_cache.erase(entry);
+      else
+        entry++;
+    };
+    m_busy = m_thread.joinable();
+  }
+  m_request.notify_one();
+}
+
+bool Prefetcher::lookup(sqlite3_int64 id, Recipe &recipe, string &html) {
+  lock_guard<mutex> lock(m_mutex);
+  map<sqlite3_int64, pair<Recipe, string> >::iterator entry = m_cache.find(id);
+  if (entry == m_cache.end())
+    return false;
+  recipe = entry->second.first;
+  html = entry->second.second;
+  return true;
+}
+
+void Prefetcher::clear(void) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_cache.clear();
+    m_generation++;
+    m_busy = m_thread.joinable();
+  }
+  m_request.notify_one();
+}
+
+void Prefetcher::flush(void) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_wanted.clear();
+    m_cache.clear();
+    m_generation++;
+    m_busy = m_thread.joinable();
+  }
+  m_request.notify_one();
+  wait();
+}
+
+void Prefetcher::wait(void) {
+  unique_lock<mutex> lock(m_mutex);
+  while (m_busy)
+    m_idle.wait(lock);
+}
+
+void Prefetcher::run(void) {
+  unique_lock<mutex> lock(m_mutex);
+  while (!m_stop) {
+    vector<sqlite3_int64>::iterator id = m_wanted.begin();
+    while (id != m_wanted.end() && m_cache.find(*id) != m_cache.end())
+      id++;
+    if (id == m_wanted.end()) {
+      m_busy = false;
+      m_idle.notify_all();
+      m_request.wait(lock);
+      continue;
+    };
+    sqlite3_int64 recipe_id = *id;
+    int generation = m_generation;
+    lock.unlock();
+    bool success = false;
+    Recipe recipe;
+    string html;
+    try {
+      recipe = m_database.fetch_recipe(recipe_id);
+      html = recipe_to_html(recipe, m_translate);
+      success = true;
+    } catch (exception &) {
+      // Errors are reported when the recipe is fetched in the foreground.
+    };
+    lock.lock();
+    if (generation == m_generation) {
+      if (success)
+        m_cache[recipe_id] = make_pair(recipe, html);
+      else {
+        id = find(m_wanted.begin(), m_wanted.end(), recipe_id);
+        if (id != m_wanted.end())
+          m_wanted.erase(id);
+      };
+    };
+  };
+}
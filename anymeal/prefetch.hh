@@ -0,0 +1,56 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "database.hh"
+#include "html.hh"
+
+
+// Background thread fetching and rendering recipes using its own read-only database connection.
+class Prefetcher
+{
+public:
+  Prefetcher(void);
+  virtual ~Prefetcher(void);
+  void open(const char *filename, std::string (*translate)(const char *, const char *)=&notrans);
+  // Stop the background thread and close the database connection. The prefetcher can be opened again afterwards.
+  void close(void);
+  void prefetch(const std::vector<sqlite3_int64> &ids);
+  bool lookup(sqlite3_int64 id, Recipe &recipe, std::string &html);
+  void clear(void);
+  // Drop all requests and wait until the background thread has stopped rendering (e.g. before switching the language).
+  void flush(void);
+  void wait(void);
+protected:
+  void stop(void);
+  void run(void);
+  Database m_database;
+  std::string (*m_translate)(const char *, const char *);
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_request;
+  std::condition_variable m_idle;
+  std::vector<sqlite3_int64> m_wanted;
+  std::map<sqlite3_int64, std::pair<Recipe, std::string> > m_cache;
+  bool m_busy;
+  bool m_stop;
+  int m_generation;
+};
@@ -0,0 +1,84 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <iomanip>
+#include <sstream>
+#include "profile.hh"
+
+
+using namespace std;
+
+static int bucket(sqlite3_int64 nanoseconds) {
+  int octave = 0;
+  while (nanoseconds >= 2 * PROFILE_SUBBUCKETS) {
+    nanoseconds >>= 1;
+    octave++;
+  };
+  return octave * PROFILE_SUBBUCKETS + nanoseconds;
+}
+
+static sqlite3_int64 bucket_limit(int index) {
+  if (index < 2 * PROFILE_SUBBUCKETS)
+    return index + 1;
+  int octave = index / PROFILE_SUBBUCKETS - 1;
+  sqlite3_int64 value = index % PROFILE_SUBBUCKETS + PROFILE_SUBBUCKETS;
+  return (value + 1) << octave;
+}
+
+StatementProfile::StatementProfile(void): m_count(0), m_total(0), m_maximum(0), m_rows(0), m_vm_steps(0)
+{
+}
+
+void StatementProfile::record(sqlite3_int64 nanoseconds, int rows, int vm_steps) {
+  if (nanoseconds < 0)
+    nanoseconds = 0;
+  m_count++;
+  m_total += nanoseconds;
+  if (nanoseconds > m_maximum)
+    m_maximum = nanoseconds;
+  m_rows += rows;
+  m_vm_steps += vm_steps;
+  int index = bucket(nanoseconds);
+  if (index >= (int)m_histogram.size())
+    m_histogram.resize(index + 1);
+  m_histogram[index]++;
+}
+
+sqlite3_int64 StatementProfile::percentile(double fraction) const {
+  sqlite3_int64 remaining = (sqlite3_int64)(fraction * m_count + 0.999999);
+  for (int index=0; index<(int)m_histogram.size(); index++) {
+    remaining -= m_histogram[index];
+    if (remaining <= 0)
+      return min(bucket_limit(index), m_maximum);
+  };
+  return m_maximum;
+}
+
+string profile_report(const vector<pair<string, StatementProfile> > &profile) {
+  ostringstream s;
+  s << setw(8) << "calls" << setw(12) << "total ms" << setw(10) << "p99 ms" << setw(10) << "rows" << setw(12) << "vm steps"
+    << "  statement" << endl;
+  s << fixed << setprecision(3);
+  for (vector<pair<string, StatementProfile> >::const_iterator entry=profile.begin(); entry!=profile.end(); entry++) {
+    string sql = entry->first;
+    for (string::iterator c=sql.begin(); c!=sql.end(); c++)
+      if (*c == '\n')
+        *c = ' ';
+    s << setw(8) << entry->second.count() << setw(12) << entry->second.total() * 1e-6
+      << setw(10) << entry->second.percentile(0.99) * 1e-6 << setw(10) << entry->second.rows()
+      << setw(12) << entry->second.vm_steps() << "  " << sql << endl;
+  };
+  return s.str();
+}
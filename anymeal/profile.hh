@@ -0,0 +1,49 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include <sqlite3.h>
+
+
+// Number of histogram buckets per power of two. The relative error of percentiles is at most 1/PROFILE_SUBBUCKETS.
+#define PROFILE_SUBBUCKETS 8
+
+// Aggregated execution statistics of an SQL statement.
+class StatementProfile
+{
+public:
+  StatementProfile(void);
+  void record(sqlite3_int64 nanoseconds, int rows, int vm_steps);
+  int count(void) const { return m_count; }
+  sqlite3_int64 total(void) const { return m_total; }
+  sqlite3_int64 maximum(void) const { return m_maximum; }
+  sqlite3_int64 rows(void) const { return m_rows; }
+  sqlite3_int64 vm_steps(void) const { return m_vm_steps; }
+  // Upper bound of the given fraction of execution times in nanoseconds.
+  sqlite3_int64 percentile(double fraction) const;
+protected:
+  int m_count;
+  sqlite3_int64 m_total;
+  sqlite3_int64 m_maximum;
+  sqlite3_int64 m_rows;
+  sqlite3_int64 m_vm_steps;
+  std::vector<int> m_histogram;
+};
+
+// Table of statements with number of calls, total and 99th percentile time, rows, and virtual machine steps.
+std::string profile_report(const std::vector<std::pair<std::string, StatementProfile> > &profile);
@@ -0,0 +1,81 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cmath>
+#include <QtWidgets/QMessageBox>
+#include "profile_dialog.hh"
+
+
+using namespace std;
+
+ProfileDialog::ProfileDialog(QWidget *parent, AsyncDatabase *database):
+  QDialog(parent), m_database(database)
+{
+  m_ui.setupUi(this);
+  m_ui.enable_check->setChecked(m_database->call([](Database &database) { return database.profiling(); }));
+  connect(m_ui.enable_check, &QCheckBox::toggled, this, &ProfileDialog::set_profiling);
+  connect(m_ui.refresh_button, &QPushButton::clicked, this, &ProfileDialog::refresh);
+  connect(m_ui.reset_button, &QPushButton::clicked, this, &ProfileDialog::reset_profile);
+  refresh();
+}
+
+static QTableWidgetItem *number_item(double value) {
+  // Numeric data is used so that the table is sorted numerically.
+  QTableWidgetItem *item = new QTableWidgetItem;
+  item->setData(Qt::DisplayRole, value);
+  item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+  return item;
+}
+
+static double milliseconds(sqlite3_int64 nanoseconds) {
+  return round(nanoseconds * 1e-3) * 1e-3;
+}
+
+void ProfileDialog::refresh(void) {
+  try {
+    vector<pair<string, StatementProfile> > profile = m_database->call([](Database &database) { return database.profile(); });
+    m_ui.statements_table->setSortingEnabled(false);
+    m_ui.statements_table->setRowCount(profile.size());
+    for (int row=0; row<(int)profile.size(); row++) {
+      const StatementProfile &statement = profile[row].second;
+      QString sql = QString::fromUtf8(profile[row].first.c_str()).simplified();
+      QTableWidgetItem *sql_item = new QTableWidgetItem(sql);
+      sql_item->setToolTip(QString::fromUtf8(profile[row].first.c_str()));
+      m_ui.statements_table->setItem(row, 0, number_item(statement.count()));
+      m_ui.statements_table->setItem(row, 1, number_item(milliseconds(statement.total())));
+      m_ui.statements_table->setItem(row, 2, number_item(milliseconds(statement.percentile(0.99))));
+      m_ui.statements_table->setItem(row, 3, number_item(statement.rows()));
+      m_ui.statements_table->setItem(row, 4, number_item(statement.vm_steps()));
+      m_ui.statements_table->setItem(row, 5, sql_item);
+    };
+    m_ui.statements_table->setSortingEnabled(true);
+    m_ui.statements_table->resizeColumnsToContents();
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Reading Statement Profile"), e.what());
+  };
+}
+
+void ProfileDialog::reset_profile(void) {
+  m_database->call([](Database &database) { database.reset_profile(); });
+  refresh();
+}
+
+void ProfileDialog::set_profiling(bool enable) {
+  try {
+    m_database->call([enable](Database &database) { database.set_profiling(enable); });
+  } catch (exception &e) {
+    QMessageBox::critical(this, tr("Error Setting Up Statement Profiling"), e.what());
+  };
+}
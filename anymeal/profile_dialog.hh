@@ -0,0 +1,35 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <QtWidgets/QDialog>
+#include "ui_profile_dialog.hh"
+#include "async_database.hh"
+
+
+// Dialog showing execution statistics of the SQL statements of the main database connection.
+class ProfileDialog: public QDialog
+{
+  Q_OBJECT
+public:
+  ProfileDialog(QWidget *parent, AsyncDatabase *database);
+public slots:
+  void refresh(void);
+  void reset_profile(void);
+  void set_profiling(bool enable);
+protected:
+  Ui::ProfileDialog m_ui;
+  AsyncDatabase *m_database;
+};
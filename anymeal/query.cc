@@ -0,0 +1,343 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cctype>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include "query.hh"
+
+
+using namespace std;
+
+query_t query_term(QueryKind kind, const string &value) {
+  return query_t(new Query(kind, value));
+}
+
+query_t query_not(query_t query) {
+  return query_t(new Query(QUERY_NOT, vector<query_t>(1, query)));
+}
+
+static query_t query_combine(QueryKind kind, query_t a, query_t b) {
+  if (!a)
+    return b;
+  if (!b)
+    return a;
+  vector<query_t> children;
+  children.push_back(a);
+  children.push_back(b);
+  return query_t(new Query(kind, children));
+}
+
+query_t query_and(query_t a, query_t b) {
+  return query_combine(QUERY_AND, a, b);
+}
+
+query_t query_or(query_t a, query_t b) {
+  return query_combine(QUERY_OR, a, b);
+}
+
+// Recursive descent parser for the query language.
+class QueryParser
+{
+public:
+  QueryParser(const char *text): m_text(text), m_pos(0) {}
+  query_t parse(void) {
+    skip_space();
+    if (at_end())
+      return query_t();
+    query_t result = disjunction();
+    if (!at_end())
+      error("Unexpected closing parenthesis");
+    return result;
+  }
+protected:
+  void error(const char *message) {
+    ostringstream s;
+    s << message << " at position " << m_pos + 1 << " of query \"" << m_text << "\"";
+    throw query_exception(s.str());
+  }
+  bool at_end(void) {
+    return m_pos >= m_text.size();
+  }
+  void skip_space(void) {
+    while (!at_end() && isspace((unsigned char)m_text[m_pos]))
+      m_pos++;
+  }
+  bool delimiter(size_t pos) {
+    return pos >= m_text.size() || isspace((unsigned char)m_text[pos]) || m_text[pos] == '(' || m_text[pos] == ')';
+  }
+  bool keyword(const char *name) {
+    size_t n = strlen(name);
+    if (m_text.compare(m_pos, n, name) != 0 || !delimiter(m_pos + n))
+      return false;
+    m_pos += n;
+    skip_space();
+    return true;
+  }
+  string value(void) {
+    string result;
+    if (!at_end() && m_text[m_pos] == '"') {
+      m_pos++;
+      while (true) {
+        if (at_end())
+          error("Missing closing quote");
+        if (m_text[m_pos] == '"') {
+          m_pos++;
+          if (at_end() || m_text[m_pos] != '"')
+            break;
+        };
+        result += m_text[m_pos++];
+      };
+    } else {
+      while (!delimiter(m_pos))
+        result += m_text[m_pos++];
+    };
+    if (result.empty())
+      error("Missing search term");
+    skip_space();
+    return result;
+  }
+  query_t term(void) {
+    size_t start = m_pos;
+    while (!at_end() && isalpha((unsigned char)m_text[m_pos]))
+      m_pos++;
+    if (!at_end() && m_text[m_pos] == ':') {
+      string field = m_text.substr(start, m_pos - start);
+      m_pos++;
+      if (field == "title")
+        return query_term(QUERY_TITLE, value());
+      if (field == "cat" || field == "category")
+        return query_term(QUERY_CATEGORY, value());
+      if (field == "ing" || field == "ingredient")
+        return query_term(QUERY_INGREDIENT, value());
+      if (field == "text")
+        return query_term(QUERY_TEXT, value());
+    };
+    m_pos = start;
+    return query_term(QUERY_TITLE, value());
+  }
+  query_t primary(void) {
+    if (at_end())
+      error("Missing search term");
+    if (m_text[m_pos] == ')')
+      error("Unexpected closing parenthesis");
+    if (m_text[m_pos] == '(') {
+      m_pos++;
+      skip_space();
+      query_t result = disjunction();
+      if (at_end() || m_text[m_pos] != ')')
+        error("Missing closing parenthesis");
+      m_pos++;
+      skip_space();
+      return result;
+    };
+    return term();
+  }
+  query_t negation(void) {
+    if (keyword("NOT"))
+      return query_not(negation());
+    return primary();
+  }
+  query_t conjunction(void) {
+    query_t result = negation();
+    while (!at_end() && m_text[m_pos] != ')') {
+      size_t pos = m_pos;
+      if (keyword("OR")) {
+        m_pos = pos;
+        break;
+      };
+      keyword("AND");
+      result = query_and(result, negation());
+    };
+    return result;
+  }
+  query_t disjunction(void) {
+    query_t result = conjunction();
+    while (keyword("OR"))
+      result = query_or(result, conjunction());
+    return result;
+  }
+  string m_text;
+  size_t m_pos;
+};
+
+query_t parse_query(const char *text) {
+  return QueryParser(text).parse();
+}
+
+bool uses_query_syntax(const char *text) {
+  static const char *fields[] = {"title:", "cat:", "category:", "ing:", "ingredient:", "text:"};
+  for (const char *p=text; *p; p++) {
+    if (p != text && !isspace((unsigned char)p[-1]) && p[-1] != '(')
+      continue;
+    for (size_t i=0; i<sizeof(fields) / sizeof(fields[0]); i++)
+      if (strncmp(p, fields[i], strlen(fields[i])) == 0)
+        return true;
+  };
+  return false;
+}
+
+query_t parse_search(const char *text) {
+  if (uses_query_syntax(text))
+    return parse_query(text);
+  if (*text == '\0')
+    return query_t();
+  return query_term(QUERY_TITLE, text);
+}
+
+string text_search_query(const char *text) {
+  // Quote each word so that punctuation cannot be mistaken for query syntax.
+  string result;
+  istringstream words(text);
+  string word;
+  while (words >> word) {
+    string quoted = "\"";
+    for (string::iterator c=word.begin(); c!=word.end(); c++) {
+      if (*c == '"')
+        quoted += '"';
+      quoted += *c;
+    };
+    quoted += "\"";
+    if (!result.empty())
+      result += " OR ";
+    result += quoted;
+  };
+  return result;
+}
+
+query_t simplify_query(query_t query) {
+  if (!query)
+    return query;
+  switch (query->kind()) {
+  case QUERY_NOT: {
+    query_t child = simplify_query(query->children()[0]);
+    if (child->kind() == QUERY_NOT)
+      return child->children()[0];
+    return query_not(child);
+  }
+  case QUERY_AND:
+  case QUERY_OR: {
+    vector<query_t> children;
+    set<string> seen;
+    vector<query_t> pending(query->children().rbegin(), query->children().rend());
+    while (!pending.empty()) {
+      query_t child = simplify_query(pending.back());
+      pending.pop_back();
+      if (child->kind() == query->kind()) {
+        pending.insert(pending.end(), child->children().rbegin(), child->children().rend());
+        continue;
+      };
+      if (seen.insert(query_to_string(child)).second)
+        children.push_back(child);
+    };
+    if (children.size() == 1)
+      return children[0];
+    return query_t(new Query(query->kind(), children));
+  }
+  default:
+    return query;
+  };
+}
+
+static string quote_value(const string &value) {
+  bool plain = !value.empty();
+  for (string::const_iterator c=value.begin(); c!=value.end(); c++)
+    if (isspace((unsigned char)*c) || *c == '"' || *c == '(' || *c == ')')
+      plain = false;
+  if (plain && value != "AND" && value != "OR" && value != "NOT")
+    return value;
+  string result = "\"";
+  for (string::const_iterator c=value.begin(); c!=value.end(); c++) {
+    if (*c == '"')
+      result += '"';
+    result += *c;
+  };
+  result += "\"";
+  return result;
+}
+
+string query_to_string(query_t query) {
+  if (!query)
+    return "";
+  switch (query->kind()) {
+  case QUERY_TITLE:
+    return "title:" + quote_value(query->value());
+  case QUERY_CATEGORY:
+    return "cat:" + quote_value(query->value());
+  case QUERY_INGREDIENT:
+    return "ing:" + quote_value(query->value());
+  case QUERY_TEXT:
+    return "text:" + quote_value(query->value());
+  case QUERY_NOT: {
+    query_t child = query->children()[0];
+    if (child->kind() == QUERY_AND || child->kind() == QUERY_OR)
+      return "NOT (" + query_to_string(child) + ")";
+    return "NOT " + query_to_string(child);
+  }
+  default: {
+    string result;
+    for (vector<query_t>::const_iterator child=query->children().begin(); child!=query->children().end(); child++) {
+      if (!result.empty())
+        result += query->kind() == QUERY_AND ? " AND " : " OR ";
+      if ((*child)->kind() == QUERY_AND || (*child)->kind() == QUERY_OR)
+        result += "(" + query_to_string(*child) + ")";
+      else
+        result += query_to_string(*child);
+    };
+    return result;
+  }
+  };
+}
+
+static string parameter(vector<string> &parameters, const string &value) {
+  parameters.push_back(value);
+  ostringstream s;
+  s << "?" << parameters.size();
+  return s.str();
+}
+
+string query_to_sql(query_t query, vector<string> &parameters, const string &schema) {
+  if (!query)
+    return "1";
+  switch (query->kind()) {
+  case QUERY_TITLE:
+    return "id IN (SELECT id FROM " + schema + "recipes WHERE title LIKE '%' || " + parameter(parameters, query->value()) + " || '%')";
+  case QUERY_CATEGORY:
+    return "id IN (SELECT recipeid FROM " + schema + "category, " + schema + "categories WHERE categoryid = categories.id AND name LIKE " +
+           parameter(parameters, query->value()) + " || '%')";
+  case QUERY_INGREDIENT:
+    return "id IN (SELECT recipeid FROM " + schema + "ingredientindex, " + schema + "ingredients WHERE ingredientid = ingredients.id AND "
+           "name LIKE '%' || " + parameter(parameters, query->value()) + " || '%')";
+  case QUERY_TEXT: {
+    string text = text_search_query(query->value().c_str());
+    if (text.empty())
+      return "1";
+    return "id IN (SELECT rowid FROM " + schema + "recipesearch WHERE recipesearch MATCH " + parameter(parameters, text) + ")";
+  }
+  case QUERY_NOT:
+    return "NOT " + query_to_sql(query->children()[0], parameters, schema);
+  default: {
+    string result = "(";
+    for (vector<query_t>::const_iterator child=query->children().begin(); child!=query->children().end(); child++) {
+      if (child != query->children().begin())
+        result += query->kind() == QUERY_AND ? " AND " : " OR ";
+      result += query_to_sql(*child, parameters, schema);
+    };
+    result += ")";
+    return result;
+  }
+  };
+}
@@ -0,0 +1,71 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class query_exception: public std::exception
+{
+public:
+  query_exception(const std::string &error): m_error(error) {}
+  virtual ~query_exception(void) throw() {}
+  virtual const char *what(void) const throw() { return m_error.c_str(); }
+protected:
+  std::string m_error;
+};
+
+typedef enum { QUERY_TITLE = 0, QUERY_CATEGORY, QUERY_INGREDIENT, QUERY_TEXT, QUERY_NOT, QUERY_AND, QUERY_OR } QueryKind;
+
+// Node of the syntax tree of a recipe query such as "title:soup AND (cat:vegan OR ing:tofu) AND NOT ing:nuts".
+class Query;
+
+typedef std::shared_ptr<Query> query_t;
+
+class Query
+{
+public:
+  Query(QueryKind kind, const std::string &value): m_kind(kind), m_value(value) {}
+  Query(QueryKind kind, const std::vector<query_t> &children): m_kind(kind), m_children(children) {}
+  QueryKind kind(void) const { return m_kind; }
+  const std::string &value(void) const { return m_value; }
+  const std::vector<query_t> &children(void) const { return m_children; }
+protected:
+  QueryKind m_kind;
+  std::string m_value;
+  std::vector<query_t> m_children;
+};
+
+query_t query_term(QueryKind kind, const std::string &value);
+query_t query_not(query_t query);
+query_t query_and(query_t a, query_t b);
+query_t query_or(query_t a, query_t b);
+// Parse a query. Words without field prefix are matched against the title and juxtaposed terms are combined with AND.
+query_t parse_query(const char *text);
+// Check whether a search text contains a field prefix such as "cat:" and therefore is meant as a query.
+bool uses_query_syntax(const char *text);
+// Parse the text as a query if it uses query syntax. Otherwise it is a plain title search.
+query_t parse_search(const char *text);
+// Full-text search expression matching any of the words of the text.
+std::string text_search_query(const char *text);
+// Flatten nested conjunctions and disjunctions, remove double negations and duplicate terms.
+query_t simplify_query(query_t query);
+// Canonical text representation of a query.
+std::string query_to_string(query_t query);
+// Compile a query to an SQL condition on the recipe id "id". Terms are appended to the list of parameters.
+// The tables are looked up in the given schema (e.g. "main.") if specified.
+std::string query_to_sql(query_t query, std::vector<std::string> &parameters, const std::string &schema="");
@@ -0,0 +1,114 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include "read_pool.hh"
+
+
+using namespace std;
+
+ReadPool::ReadPool(int size): m_size(size), m_opening(0)
+{
+}
+
+ReadPool::~ReadPool(void) {
+}
+
+void ReadPool::open(const char *filename) {
+  lock_guard<mutex> lock(m_mutex);
+  m_filename = filename;
+}
+
+void ReadPool::close(void) {
+  unique_lock<mutex> lock(m_mutex);
+  m_filename.clear();
+  while ((int)m_idle.size() < (int)m_connections.size() || m_opening > 0)
+    m_available.wait(lock);
+  m_idle.clear();
+  m_connections.clear();
+}
+
+void ReadPool::attach_cookbook(const char *filename) {
+  lock_guard<mutex> lock(m_mutex);
+  m_cookbooks.push_back(filename);
+}
+
+static void attach_cookbooks(Database *database, const vector<string> &cookbooks) {
+  while (database->num_cookbooks() < (int)cookbooks.size())
+    database->attach_cookbook(cookbooks[database->num_cookbooks()].c_str());
+}
+
+Database *ReadPool::acquire(void) {
+  unique_lock<mutex> lock(m_mutex);
+  if (m_filename.empty())
+    throw database_exception("Pool of database connections was not opened.");
+  while (m_idle.empty() && (int)m_connections.size() + m_opening >= m_size)
+    m_available.wait(lock);
+  // The pool might have been closed meanwhile.
+  if (m_filename.empty())
+    throw database_exception("Pool of database connections was not opened.");
+  if (!m_idle.empty()) {
+    Database *database = m_idle.back();
+    m_idle.pop_back();
+    vector<string> cookbooks = m_cookbooks;
+    lock.unlock();
+    try {
+      attach_cookbooks(database, cookbooks);
+    } catch (exception &) {
+      release(database);
+      throw;
+    };
+    return database;
+  };
+  // Connections are opened on demand so that unused slots do not prepare any statements.
+  m_opening++;
+  string filename = m_filename;
+  vector<string> cookbooks = m_cookbooks;
+  lock.unlock();
+  shared_ptr<Database> database(new Database);
+  try {
+    database->open(filename.c_str(), true);
+    attach_cookbooks(database.get(), cookbooks);
+  } catch (exception &) {
+    lock.lock();
+    m_opening--;
+    m_available.notify_all();
+    throw;
+  };
+  lock.lock();
+  m_opening--;
+  m_connections.push_back(database);
+  return database.get();
+}
+
+void ReadPool::release(Database *database) {
+  // Do not hand out a connection which still holds on to an old snapshot.
+  if (!sqlite3_get_autocommit(database->db())) {
+    try {
+      database->rollback();
+    } catch (exception &) {
+    };
+  };
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_idle.push_back(database);
+  }
+  // Wake up all waiting threads because closing the pool waits for every connection.
+  m_available.notify_all();
+}
+
+int ReadPool::connections(void) {
+  lock_guard<mutex> lock(m_mutex);
+  return m_connections.size();
+}
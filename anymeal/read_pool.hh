@@ -0,0 +1,84 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "database.hh"
+
+
+// Pool of read-only connections to a database in WAL mode.
+// Readers run concurrently with the writer and each request sees a consistent snapshot.
+class ReadPool
+{
+public:
+  ReadPool(int size=4);
+  virtual ~ReadPool(void);
+  void open(const char *filename);
+  // Wait for all leases to be returned and close the connections. The pool needs to be opened again afterwards.
+  void close(void);
+  // Cookbooks are attached to each connection when it is handed out.
+  void attach_cookbook(const char *filename);
+  Database *acquire(void);
+  void release(Database *database);
+  // Connection leased from the pool for the lifetime of the object.
+  class Lease
+  {
+  public:
+    Lease(ReadPool &pool): m_pool(pool), m_database(pool.acquire()) {}
+    virtual ~Lease(void) { m_pool.release(m_database); }
+    Database &operator*(void) { return *m_database; }
+    Database *operator->(void) { return m_database; }
+  protected:
+    ReadPool &m_pool;
+    Database *m_database;
+  };
+  template <typename F>
+  typename std::invoke_result<F, Database &>::type read(F request) {
+    Lease lease(*this);
+    lease->begin();
+    try {
+      if constexpr (std::is_void<typename std::invoke_result<F, Database &>::type>::value) {
+        request(*lease);
+        lease->commit();
+      } else {
+        typename std::invoke_result<F, Database &>::type result = request(*lease);
+        lease->commit();
+        return result;
+      };
+    } catch (std::exception &) {
+      try {
+        lease->rollback();
+      } catch (std::exception &) {
+      };
+      throw;
+    };
+  }
+  int size(void) { return m_size; }
+  int connections(void);
+protected:
+  int m_size;
+  std::string m_filename;
+  std::vector<std::string> m_cookbooks;
+  std::mutex m_mutex;
+  std::condition_variable m_available;
+  std::vector<std::shared_ptr<Database> > m_connections;
+  std::vector<Database *> m_idle;
+  int m_opening;
+};
@@ -34,3 +34,51 @@ void Recipe::append_instruction(const char *instruction) {
     m_instructions[n - 1] += " ";
   m_instructions[n - 1] += instruction;
 }
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  for (size_t i=0; i<size; i++) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  };
+  return hash;
+}
+
+static uint64_t fnv1a(uint64_t hash, const string &text) {
+  // The terminating zero separates consecutive strings.
+  return fnv1a(hash, text.c_str(), text.size() + 1);
+}
+
+static uint64_t fnv1a(uint64_t hash, int64_t value) {
+  return fnv1a(hash, &value, sizeof(value));
+}
+
+uint64_t recipe_fingerprint(Recipe &recipe) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = fnv1a(hash, recipe.title());
+  hash = fnv1a(hash, (int64_t)recipe.servings());
+  hash = fnv1a(hash, recipe.servings_unit());
+  hash = fnv1a(hash, (int64_t)recipe.ingredients().size());
+  for (vector<Ingredient>::iterator ingredient=recipe.ingredients().begin(); ingredient!=recipe.ingredients().end(); ingredient++) {
+    hash = fnv1a(hash, (int64_t)ingredient->amount_integer());
+    hash = fnv1a(hash, (int64_t)ingredient->amount_numerator());
+    hash = fnv1a(hash, (int64_t)ingredient->amount_denominator());
+    double amount_float = ingredient->amount_float();
+    hash = fnv1a(hash, &amount_float, sizeof(amount_float));
+    hash = fnv1a(hash, (int64_t)ingredient->unit_index());
+    hash = fnv1a(hash, ingredient->text());
+  };
+  hash = fnv1a(hash, (int64_t)recipe.ingredient_sections().size());
+  for (vector<pair<int, string> >::iterator section=recipe.ingredient_sections().begin(); section!=recipe.ingredient_sections().end(); section++) {
+    hash = fnv1a(hash, (int64_t)section->first);
+    hash = fnv1a(hash, section->second);
+  };
+  hash = fnv1a(hash, (int64_t)recipe.instructions().size());
+  for (vector<string>::iterator instruction=recipe.instructions().begin(); instruction!=recipe.instructions().end(); instruction++)
+    hash = fnv1a(hash, *instruction);
+  for (vector<pair<int, string> >::iterator section=recipe.instruction_sections().begin(); section!=recipe.instruction_sections().end(); section++) {
+    hash = fnv1a(hash, (int64_t)section->first);
+    hash = fnv1a(hash, section->second);
+  };
+  return hash;
+}
@@ -14,6 +14,7 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
 #pragma once
+#include <cstdint>
 #include <utility>
 #include <string>
 #include <vector>
@@ -58,3 +59,6 @@ protected:
   std::vector<std::string> m_instructions;
   std::vector<std::pair<int, std::string> > m_instruction_sections;
 };
+
+// 64-bit FNV-1a hash of the content of a recipe for detecting duplicates. The categories are not part of the content.
+uint64_t recipe_fingerprint(Recipe &recipe);
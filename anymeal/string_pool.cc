@@ -0,0 +1,62 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cstring>
+#include "string_pool.hh"
+
+
+using namespace std;
+
+StringPool::StringPool(void): m_used(0), m_bytes(0)
+{
+}
+
+string_view StringPool::add(string_view text) {
+  size_t size = text.size() + 1;
+  char *target;
+  if (size > STRING_POOL_BLOCK) {
+    // Long strings get a block of their own so that the current block can still be filled.
+    m_large.push_back(unique_ptr<char[]>(new char[size]));
+    target = m_large.back().get();
+  } else {
+    if (m_blocks.empty() || m_used + size > STRING_POOL_BLOCK) {
+      m_blocks.push_back(unique_ptr<char[]>(new char[STRING_POOL_BLOCK]));
+      m_used = 0;
+    };
+    target = m_blocks.back().get() + m_used;
+    m_used += size;
+  };
+  memcpy(target, text.data(), text.size());
+  target[text.size()] = '\0';
+  m_bytes += size;
+  return string_view(target, text.size());
+}
+
+string_view StringPool::intern(string_view text) {
+  unordered_set<string_view>::iterator existing = m_interned.find(text);
+  if (existing != m_interned.end())
+    return *existing;
+  string_view result = add(text);
+  m_interned.insert(result);
+  return result;
+}
+
+void StringPool::clear(void) {
+  m_interned.clear();
+  m_blocks.clear();
+  m_large.clear();
+  m_used = 0;
+  m_bytes = 0;
+}
@@ -0,0 +1,41 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+
+#define STRING_POOL_BLOCK 65536
+
+// Append-only arena of zero-terminated strings. The views remain valid until the pool is cleared.
+class StringPool
+{
+public:
+  StringPool(void);
+  std::string_view add(std::string_view text);
+  // Return the view of an equal string interned before or add the string.
+  std::string_view intern(std::string_view text);
+  size_t bytes(void) const { return m_bytes; }
+  void clear(void);
+protected:
+  std::vector<std::unique_ptr<char[]> > m_blocks;
+  std::vector<std::unique_ptr<char[]> > m_large;
+  size_t m_used;
+  size_t m_bytes;
+  std::unordered_set<std::string_view> m_interned;
+};
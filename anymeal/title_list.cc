@@ -0,0 +1,77 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include "title_list.hh"
+
+
+using namespace std;
+
+TitleList::TitleList(void): m_total(0), m_offset(0) {
+}
+
+void TitleList::reset(const vector<pair<sqlite3_int64, string> > &titles, int total, fetch_t fetch) {
+  // The titles are kept in a pool to avoid allocating memory for each title.
+  m_pool.clear();
+  m_titles.clear();
+  for (vector<pair<sqlite3_int64, string> >::const_iterator title=titles.begin(); title!=titles.end(); title++)
+    m_titles.push_back(make_pair(title->first, m_pool.add(title->second)));
+  m_last = m_titles.empty() ? pair<sqlite3_int64, string_view>(0, "") : m_titles.back();
+  m_added.clear();
+  m_total = total;
+  m_offset = titles.size();
+  m_fetch = fetch;
+}
+
+bool TitleList::can_fetch_more(void) const {
+  if (!m_fetch)
+    return false;
+  return (int)m_titles.size() < m_total;
+}
+
+vector<pair<sqlite3_int64, string_view> > TitleList::fetch_more(void) {
+  vector<pair<sqlite3_int64, string_view> > rows;
+  if (!can_fetch_more())
+    return rows;
+  int offset = m_titles.size();
+  vector<pair<sqlite3_int64, string_view> > page = m_fetch(m_offset, m_last, min(TITLES_PAGE, m_total - offset), m_pool);
+  if (page.empty()) {
+    // Recipes were removed since the search was run.
+    m_total = offset;
+    return rows;
+  };
+  m_offset += page.size();
+  m_last = page.back();
+  // Recipes added or edited in the meantime are shown already.
+  for (vector<pair<sqlite3_int64, string_view> >::iterator title=page.begin(); title!=page.end(); title++)
+    if (m_added.find(title->first) == m_added.end())
+      rows.push_back(*title);
+  return rows;
+}
+
+void TitleList::append(const vector<pair<sqlite3_int64, string_view> > &rows) {
+  m_titles.insert(m_titles.end(), rows.begin(), rows.end());
+}
+
+void TitleList::edit(int row, sqlite3_int64 id, const char *title) {
+  m_titles[row] = pair<sqlite3_int64, string_view>(id, m_pool.add(title));
+  m_added.insert(id);
+}
+
+void TitleList::add(sqlite3_int64 id, const char *title) {
+  m_titles.push_back(pair<sqlite3_int64, string_view>(id, m_pool.add(title)));
+  m_added.insert(id);
+  m_total++;
+}
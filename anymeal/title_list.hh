@@ -0,0 +1,55 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#pragma once
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sqlite3.h>
+#include "string_pool.hh"
+
+
+#define TITLES_PAGE 200
+
+// Recipe titles of a selection which are loaded page by page. Recipes added or edited after the search are kept at their
+// position and are skipped when the following pages are fetched.
+class TitleList
+{
+public:
+  TitleList(void);
+  // Callback getting the offset, the last recipe loaded from the database, the number of recipes to fetch, and the pool
+  // for storing the titles.
+  typedef std::function<std::vector<std::pair<sqlite3_int64, std::string_view> >(int, const std::pair<sqlite3_int64, std::string_view> &,
+                                                                                int, StringPool &)> fetch_t;
+  void reset(const std::vector<std::pair<sqlite3_int64, std::string> > &titles, int total, fetch_t fetch);
+  int size(void) const { return m_titles.size(); }
+  const std::pair<sqlite3_int64, std::string_view> &operator[](int row) const { return m_titles[row]; }
+  bool can_fetch_more(void) const;
+  // Fetch the next page and return the titles which are not shown yet. They are shown after calling "append".
+  std::vector<std::pair<sqlite3_int64, std::string_view> > fetch_more(void);
+  void append(const std::vector<std::pair<sqlite3_int64, std::string_view> > &rows);
+  void edit(int row, sqlite3_int64 id, const char *title);
+  void add(sqlite3_int64 id, const char *title);
+protected:
+  StringPool m_pool;
+  std::vector<std::pair<sqlite3_int64, std::string_view> > m_titles;
+  std::pair<sqlite3_int64, std::string_view> m_last;
+  std::set<sqlite3_int64> m_added;
+  int m_total;
+  int m_offset;
+  fetch_t m_fetch;
+};
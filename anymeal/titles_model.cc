@@ -13,18 +13,18 @@
 
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
 #include "titles_model.hh"
 
 
 using namespace std;
 
-TitlesModel::TitlesModel(QObject *parent, Database *database): QAbstractListModel(parent), m_database(database) {
-  m_titles = m_database->recipe_info();
+TitlesModel::TitlesModel(QObject *parent): QAbstractListModel(parent) {
 }
 
-void TitlesModel::reset(void) {
+void TitlesModel::reset(const vector<pair<sqlite3_int64, string> > &titles, int total, fetch_t fetch) {
   beginResetModel();
-  m_titles = m_database->recipe_info();
+  m_titles.reset(titles, total, fetch);
   endResetModel();
 }
 
@@ -32,11 +32,29 @@ int TitlesModel::rowCount(const QModelIndex &) const {
   return m_titles.size();
 }
 
+bool TitlesModel::canFetchMore(const QModelIndex &parent) const {
+  if (parent.isValid())
+    return false;
+  return m_titles.can_fetch_more();
+}
+
+void TitlesModel::fetchMore(const QModelIndex &parent) {
+  if (!canFetchMore(parent))
+    return;
+  int offset = m_titles.size();
+  vector<pair<sqlite3_int64, string_view> > rows = m_titles.fetch_more();
+  if (rows.empty())
+    return;
+  beginInsertRows(QModelIndex(), offset, offset + rows.size() - 1);
+  m_titles.append(rows);
+  endInsertRows();
+}
+
 QVariant TitlesModel::data(const QModelIndex &index, int role) const {
   QVariant result;
   if (role == Qt::DisplayRole) {
     int row = index.row();
-    result = QString(m_titles[row].second.c_str());
+    result = QString::fromUtf8(m_titles[row].second.data(), m_titles[row].second.size());
   };
   return result;
 }
@@ -47,8 +65,7 @@ sqlite_int64 TitlesModel::recipeid(const QModelIndex &index) {
 }
 
 QModelIndex TitlesModel::edit_entry(const QModelIndex &index, sqlite3_int64 id, const char *title) {
-  int row = index.row();
-  m_titles[row] = pair<sqlite3_int64, string>(id, title);
+  m_titles.edit(index.row(), id, title);
   emit dataChanged(index, index);
   return index;
 }
@@ -56,7 +73,7 @@ QModelIndex TitlesModel::edit_entry(const QModelIndex &index, sqlite3_int64 id,
 QModelIndex TitlesModel::add_entry(sqlite3_int64 id, const char *title) {
   int row = m_titles.size();
   beginInsertRows(QModelIndex(), row, row);
-  m_titles.push_back(pair<sqlite3_int64, string>(id, title));
+  m_titles.add(id, title);
   endInsertRows();
   return index(row);
 }
@@ -14,24 +14,25 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
 #pragma once
-#include <vector>
-#include <string>
 #include <QtCore/QAbstractListModel>
-#include "database.hh"
+#include "title_list.hh"
 
 
+// List of recipe titles. Large selections are loaded page by page while scrolling.
 class TitlesModel: public QAbstractListModel
 {
   Q_OBJECT
 public:
-  TitlesModel(QObject *parent, Database *database);
-  void reset(void);
+  TitlesModel(QObject *parent);
+  typedef TitleList::fetch_t fetch_t;
+  void reset(const std::vector<std::pair<sqlite3_int64, std::string> > &titles, int total, fetch_t fetch);
   virtual int rowCount(const QModelIndex &parent=QModelIndex()) const;
+  virtual bool canFetchMore(const QModelIndex &parent) const;
+  virtual void fetchMore(const QModelIndex &parent);
   virtual QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   sqlite3_int64 recipeid(const QModelIndex &index);
   QModelIndex edit_entry(const QModelIndex &index, sqlite3_int64 id, const char *title);
   QModelIndex add_entry(sqlite3_int64 id, const char *title);
 protected:
-  Database *m_database;
-  std::vector<std::pair<sqlite3_int64, std::string> > m_titles;
+  TitleList m_titles;
 };
@@ -0,0 +1,80 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "html.hh"
+
+
+// Measure rendering of recipes to HTML as used by the recipe preview and by printing.
+// Usage: bench_html [number of recipes]
+
+using namespace std;
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static Recipe create_recipe(int i) {
+  static const char *codes[] = {"c ", "ts", "tb", "g ", "oz", "lb", "ea", "x "};
+  Recipe recipe;
+  recipe.set_title(("Recipe " + to_string(i) + " with \"quotes\"").c_str());
+  recipe.add_category("Main dish");
+  recipe.add_category(i % 2 ? "Odd" : "Even");
+  recipe.set_servings(4);
+  recipe.set_servings_unit("servings");
+  recipe.add_ingredient_section(0, "Dough");
+  for (int j=0; j<12; j++) {
+    Ingredient ingredient;
+    ingredient.set_amount_integer(j % 3);
+    ingredient.set_amount_numerator(j % 2);
+    ingredient.set_amount_denominator(2);
+    ingredient.set_unit(codes[j % 8]);
+    ingredient.set_text("flour, sifted");
+    recipe.add_ingredient(ingredient);
+  };
+  for (int j=0; j<8; j++)
+    recipe.add_instruction("Mix the flour with the water & salt until the dough is smooth and let it rest for <20> minutes.");
+  return recipe;
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 20000;
+  vector<Recipe> recipes;
+  for (int i=0; i<count; i++)
+    recipes.push_back(create_recipe(i));
+  size_t bytes = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i=0; i<count; i++)
+    bytes += recipe_to_html(recipes[i]).size();
+  double single = seconds_since(start);
+  HtmlRenderer renderer;
+  start = chrono::steady_clock::now();
+  for (int i=0; i<count; i++)
+    bytes += renderer.recipe_to_html(recipes[i]).size();
+  double reused = seconds_since(start);
+  start = chrono::steady_clock::now();
+  bytes += renderer.recipes_to_html(recipes).size();
+  double all = seconds_since(start);
+  cout << "recipes: " << count << endl;
+  cout << "recipe_to_html: " << single * 1e6 / count << " us/recipe" << endl;
+  cout << "reused renderer: " << reused * 1e6 / count << " us/recipe" << endl;
+  cout << "recipes_to_html: " << all * 1e6 / count << " us/recipe" << endl;
+  cout << "output: " << bytes / 3 / count << " bytes/recipe" << endl;
+  return 0;
+}
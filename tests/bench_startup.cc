@@ -0,0 +1,82 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include "database.hh"
+
+
+// Measure the time until the main window can show the recipe list of a large database.
+// Usage: bench_startup [number of recipes] [database file]
+
+using namespace std;
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void create_database(const char *filename, int count) {
+  cerr << "Creating " << filename << " with " << count << " recipes ..." << endl;
+  Database database;
+  database.open(filename);
+  database.begin();
+  for (int i=0; i<count; i++) {
+    Recipe recipe;
+    ostringstream title;
+    title << "Recipe " << i;
+    recipe.set_title(title.str().c_str());
+    recipe.add_category(i % 2 ? "odd" : "even");
+    Ingredient ingredient;
+    ingredient.set_text("water");
+    recipe.add_ingredient(ingredient);
+    recipe.add_instruction("Boil the water.");
+    database.insert_recipe(recipe);
+  };
+  database.commit();
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+  const char *filename = argc > 2 ? argv[2] : "bench_startup.sqlite";
+  if (access(filename, F_OK) != 0)
+    create_database(filename, count);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  Database database;
+  database.open(filename);
+  double open = seconds_since(start);
+  int recipes = database.num_recipes();
+  vector<string> categories = database.categories();
+  // The main window only fetches the first page of titles.
+  vector<pair<sqlite3_int64, string> > titles = database.recipe_info(0, "", 200);
+  double ready = seconds_since(start);
+  chrono::steady_clock::time_point filter = chrono::steady_clock::now();
+  database.select_by_title("1");
+  titles = database.recipe_info(0, "", 200);
+  double first_filter = seconds_since(filter);
+  chrono::steady_clock::time_point scroll = chrono::steady_clock::now();
+  titles = database.recipe_info(titles.back().first, titles.back().second.c_str(), 200);
+  double next_page = seconds_since(scroll);
+  cout << "recipes: " << recipes << endl;
+  cout << "categories: " << categories.size() << endl;
+  cout << "open: " << open * 1000 << " ms" << endl;
+  cout << "recipe list ready: " << ready * 1000 << " ms" << endl;
+  cout << "first filter: " << first_filter * 1000 << " ms" << endl;
+  cout << "next page: " << next_page * 1000 << " ms" << endl;
+  return 0;
+}
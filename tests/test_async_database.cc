@@ -0,0 +1,101 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <chrono>
+#include <gtest/gtest.h>
+#include "async_database.hh"
+
+
+using namespace std;
+using namespace testing;
+
+TEST(AsyncDatabaseTest, OpenDatabase) {
+  AsyncDatabase database;
+  database.open(":memory:");
+}
+
+TEST(AsyncDatabaseTest, FailedToOpen) {
+  AsyncDatabase database;
+  EXPECT_THROW(database.open("/tmp/nosuchdir/anymeal.db"), database_exception);
+}
+
+TEST(AsyncDatabaseTest, ReturnResult) {
+  AsyncDatabase database;
+  database.open(":memory:");
+  future<sqlite3_int64> id = database.submit([](Database &db) {
+    Recipe recipe;
+    recipe.set_title("apple pie");
+    return db.insert_recipe(recipe);
+  });
+  EXPECT_EQ(1, id.get());
+  EXPECT_EQ(1, database.call([](Database &db) { return db.num_recipes(); }));
+}
+
+TEST(AsyncDatabaseTest, PropagateException) {
+  AsyncDatabase database;
+  database.open(":memory:");
+  future<Recipe> recipe = database.submit([](Database &db) { return db.fetch_recipe(1); });
+  EXPECT_THROW(recipe.get(), database_exception);
+}
+
+TEST(AsyncDatabaseTest, CommitTransaction) {
+  AsyncDatabase database;
+  database.open(":memory:");
+  database.transaction([](Database &db) {
+    Recipe recipe;
+    db.insert_recipe(recipe);
+  }).get();
+  EXPECT_EQ(1, database.call([](Database &db) { db.select_all(); return db.num_recipes(); }));
+}
+
+TEST(AsyncDatabaseTest, RollbackTransaction) {
+  AsyncDatabase database;
+  database.open(":memory:");
+  future<void> result = database.transaction([](Database &db) {
+    Recipe recipe;
+    db.insert_recipe(recipe);
+    db.fetch_recipe(2);
+  });
+  EXPECT_THROW(result.get(), database_exception);
+  EXPECT_EQ(0, database.call([](Database &db) { db.select_all(); return db.num_recipes(); }));
+}
+
+TEST(AsyncDatabaseTest, InterruptRequest) {
+  AsyncDatabase database;
+  database.open(":memory:");
+  future<int> result = database.submit([](Database &db) {
+    return sqlite3_exec(db.db(), "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c) SELECT COUNT(*) FROM c;",
+                        NULL, NULL, NULL);
+  });
+  long request = database.last_request();
+  while (result.wait_for(chrono::milliseconds(10)) != future_status::ready)
+    database.interrupt(request);
+  EXPECT_EQ(SQLITE_INTERRUPT, result.get());
+}
+
+TEST(AsyncDatabaseTest, InterruptFinishedRequest) {
+  AsyncDatabase database;
+  database.open(":memory:");
+  database.call([](Database &) {});
+  long finished = database.last_request();
+  future<int> result = database.submit([](Database &db) {
+    return sqlite3_exec(db.db(), "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < 1000000) "
+                        "SELECT COUNT(*) FROM c;", NULL, NULL, NULL);
+  });
+  EXPECT_EQ(finished + 1, database.last_request());
+  while (result.wait_for(chrono::milliseconds(1)) != future_status::ready)
+    database.interrupt(finished);
+  EXPECT_EQ(SQLITE_OK, result.get());
+}
@@ -0,0 +1,73 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <gtest/gtest.h>
+#include "bitmap.hh"
+
+
+using namespace std;
+using namespace testing;
+
+TEST(BitmapTest, Empty) {
+  IdBitmap bitmap;
+  EXPECT_EQ(0, bitmap.size());
+  EXPECT_FALSE(bitmap.contains(1));
+  EXPECT_EQ(0, bitmap.ids().size());
+}
+
+TEST(BitmapTest, AddIds) {
+  IdBitmap bitmap;
+  bitmap.add(5);
+  bitmap.add(3);
+  bitmap.add(5);
+  EXPECT_EQ(2, bitmap.size());
+  EXPECT_TRUE(bitmap.contains(3));
+  EXPECT_FALSE(bitmap.contains(4));
+  EXPECT_TRUE(bitmap.contains(5));
+}
+
+TEST(BitmapTest, SortedIds) {
+  IdBitmap bitmap(vector<sqlite3_int64>{70000, 3, 65536, 1});
+  vector<sqlite3_int64> ids = bitmap.ids();
+  ASSERT_EQ(4, ids.size());
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(3, ids[1]);
+  EXPECT_EQ(65536, ids[2]);
+  EXPECT_EQ(70000, ids[3]);
+  EXPECT_FALSE(bitmap.contains(65537));
+}
+
+TEST(BitmapTest, SparseContainer) {
+  IdBitmap bitmap;
+  for (int i=1; i<=100; i++)
+    bitmap.add(i * 100);
+  EXPECT_EQ(100 * sizeof(uint16_t), bitmap.bytes());
+}
+
+TEST(BitmapTest, DenseContainer) {
+  IdBitmap bitmap;
+  for (int i=1; i<=20000; i++)
+    bitmap.add(i);
+  EXPECT_EQ(20000, bitmap.size());
+  EXPECT_EQ(8192, bitmap.bytes());
+  EXPECT_TRUE(bitmap.contains(12345));
+  EXPECT_FALSE(bitmap.contains(20001));
+  bitmap.add(12345);
+  EXPECT_EQ(20000, bitmap.size());
+  vector<sqlite3_int64> ids = bitmap.ids();
+  ASSERT_EQ(20000, ids.size());
+  EXPECT_EQ(1, ids.front());
+  EXPECT_EQ(20000, ids.back());
+}
@@ -0,0 +1,105 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <gtest/gtest.h>
+#include "blob.hh"
+
+
+using namespace std;
+using namespace testing;
+
+static Recipe decode(const string &blob) {
+  Recipe result;
+  blob_to_recipe_body(blob.data(), blob.size(), result);
+  return result;
+}
+
+TEST(BlobTest, EmptyRecipe) {
+  Recipe recipe;
+  string blob = recipe_body_to_blob(recipe);
+  EXPECT_EQ(5, blob.size());
+  Recipe result = decode(blob);
+  EXPECT_EQ(0, result.ingredients().size());
+  EXPECT_EQ(0, result.instructions().size());
+}
+
+TEST(BlobTest, IngredientRoundtrip) {
+  Recipe recipe;
+  Ingredient ingredient;
+  ingredient.set_amount_integer(2);
+  ingredient.set_amount_numerator(1);
+  ingredient.set_amount_denominator(3);
+  ingredient.set_unit("ts");
+  ingredient.set_text("salt");
+  recipe.add_ingredient(ingredient);
+  Ingredient ingredient2;
+  ingredient2.set_amount_float(1.5);
+  ingredient2.set_unit("l");
+  ingredient2.set_text("water");
+  recipe.add_ingredient(ingredient2);
+  Recipe result = decode(recipe_body_to_blob(recipe));
+  ASSERT_EQ(2, result.ingredients().size());
+  EXPECT_EQ(2, result.ingredients()[0].amount_integer());
+  EXPECT_EQ(1, result.ingredients()[0].amount_numerator());
+  EXPECT_EQ(3, result.ingredients()[0].amount_denominator());
+  EXPECT_EQ("ts", result.ingredients()[0].unit());
+  EXPECT_EQ("salt", result.ingredients()[0].text());
+  EXPECT_EQ(0, result.ingredients()[1].amount_integer());
+  EXPECT_EQ(1, result.ingredients()[1].amount_denominator());
+  EXPECT_EQ(1.5, result.ingredients()[1].amount_float());
+  EXPECT_EQ("water", result.ingredients()[1].text());
+}
+
+TEST(BlobTest, InstructionsAndSectionsRoundtrip) {
+  Recipe recipe;
+  recipe.add_instruction("Mix everything.");
+  recipe.add_instruction(string(300, 'x').c_str());
+  recipe.add_ingredient_section(0, "Dough");
+  recipe.add_instruction_section(1, "Baking");
+  Recipe result = decode(recipe_body_to_blob(recipe));
+  ASSERT_EQ(2, result.instructions().size());
+  EXPECT_EQ("Mix everything.", result.instructions()[0]);
+  EXPECT_EQ(300, result.instructions()[1].size());
+  ASSERT_EQ(1, result.ingredient_sections().size());
+  EXPECT_EQ(0, result.ingredient_sections()[0].first);
+  EXPECT_EQ("Dough", result.ingredient_sections()[0].second);
+  ASSERT_EQ(1, result.instruction_sections().size());
+  EXPECT_EQ(1, result.instruction_sections()[0].first);
+  EXPECT_EQ("Baking", result.instruction_sections()[0].second);
+}
+
+TEST(BlobTest, Truncated) {
+  Recipe recipe;
+  recipe.add_instruction("Mix everything.");
+  string blob = recipe_body_to_blob(recipe);
+  EXPECT_THROW(decode(blob.substr(0, blob.size() - 3)), blob_exception);
+}
+
+TEST(BlobTest, ReadVersion1) {
+  // Ingredient with integer amount, unit code "g ", and text "flour".
+  string blob("\x01\x01\x01\x02\x02g \x05" "flour\x00\x00\x00", 16);
+  Recipe result = decode(blob);
+  ASSERT_EQ(1, result.ingredients().size());
+  EXPECT_EQ(2, result.ingredients()[0].amount_integer());
+  EXPECT_EQ(UNIT_GRAM, result.ingredients()[0].unit_index());
+  EXPECT_EQ("flour", result.ingredients()[0].text());
+}
+
+TEST(BlobTest, UnknownVersion) {
+  Recipe recipe;
+  string blob = recipe_body_to_blob(recipe);
+  blob[0] = BLOB_VERSION + 1;
+  EXPECT_THROW(decode(blob), blob_exception);
+}
@@ -0,0 +1,71 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <gtest/gtest.h>
+#include "collate.hh"
+
+
+using namespace std;
+using namespace testing;
+
+TEST(CollateTest, IgnoreCase) {
+  EXPECT_LT(sort_key("apple", "en"), sort_key("Banana", "en"));
+  EXPECT_LT(sort_key("Apple", "en"), sort_key("banana", "en"));
+}
+
+TEST(CollateTest, CaseBreaksTies) {
+  EXPECT_LT(sort_key("Apple", "en"), sort_key("apple", "en"));
+  EXPECT_NE(sort_key("Apple", "en"), sort_key("apple", "en"));
+}
+
+TEST(CollateTest, ShorterTitleFirst) {
+  EXPECT_LT(sort_key("Pie", "en"), sort_key("Pie crust", "en"));
+  EXPECT_LT(sort_key("", "en"), sort_key("a", "en"));
+}
+
+TEST(CollateTest, DigitsBeforeLetters) {
+  EXPECT_LT(sort_key("7 Up Cake", "en"), sort_key("Apple Cake", "en"));
+}
+
+TEST(CollateTest, Umlauts) {
+  EXPECT_LT(sort_key("\xc3\x84pfel", "de"), sort_key("Birnen", "de"));
+  EXPECT_LT(sort_key("Apfel", "de"), sort_key("\xc3\x84pfel", "de"));
+  EXPECT_LT(sort_key("Kl\xc3\xb6\xc3\x9f" "e", "de"), sort_key("Kn\xc3\xb6" "del", "de"));
+}
+
+TEST(CollateTest, SharpS) {
+  EXPECT_LT(sort_key("Strasse", "de"), sort_key("Stra\xc3\x9f" "e", "de"));
+  EXPECT_LT(sort_key("Stra\xc3\x9f" "e", "de"), sort_key("Strast", "de"));
+}
+
+TEST(CollateTest, FrenchAccents) {
+  EXPECT_LT(sort_key("\xc3\xa9" "clair", "fr"), sort_key("fondue", "fr"));
+  EXPECT_LT(sort_key("cr\xc3\xaape", "fr"), sort_key("croissant", "fr"));
+}
+
+TEST(CollateTest, SlovenianCaron) {
+  EXPECT_LT(sort_key("\xc4\x8d" "ebula", "en"), sort_key("cvet", "en"));
+  EXPECT_LT(sort_key("cvet", "sl"), sort_key("\xc4\x8d" "ebula", "sl"));
+  EXPECT_LT(sort_key("\xc4\x8d" "ebula", "sl"), sort_key("dan", "sl"));
+  EXPECT_LT(sort_key("zelje", "sl"), sort_key("\xc5\xbe" "ganci", "sl"));
+}
+
+TEST(CollateTest, OtherCharactersAfterLetters) {
+  EXPECT_LT(sort_key("zucchini", "en"), sort_key("\xce\xb1", "en"));
+}
+
+TEST(CollateTest, InvalidUTF8) {
+  EXPECT_LT(sort_key("zucchini", "en"), sort_key("\xc3", "en"));
+}
@@ -0,0 +1,83 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <gtest/gtest.h>
+#include "compress.hh"
+
+
+using namespace std;
+using namespace testing;
+
+static vector<string> corpus(void) {
+  vector<string> result;
+  result.push_back("Preheat oven to 350 degrees.");
+  result.push_back("Preheat oven to 350 degrees. Grease a baking pan.");
+  result.push_back("Bake for 30 minutes.");
+  result.push_back("Bake for 45 minutes.");
+  return result;
+}
+
+TEST(CompressTest, EmptyDictionary) {
+  TextDictionary dictionary;
+  EXPECT_TRUE(dictionary.empty());
+  string compressed = dictionary.compress("Stir.");
+  EXPECT_EQ("Stir.", dictionary.decompress(compressed.data(), compressed.size()));
+}
+
+TEST(CompressTest, TrainDictionary) {
+  TextDictionary dictionary;
+  dictionary.train(corpus());
+  EXPECT_FALSE(dictionary.empty());
+  EXPECT_EQ(1, dictionary.generation());
+  EXPECT_EQ("Preheat oven to 350 ", dictionary.phrases()[0]);
+}
+
+TEST(CompressTest, LimitSize) {
+  TextDictionary dictionary;
+  dictionary.train(corpus(), 3);
+  EXPECT_EQ(3, dictionary.phrases().size());
+}
+
+TEST(CompressTest, Roundtrip) {
+  TextDictionary dictionary;
+  dictionary.train(corpus());
+  string text = "Preheat oven to 350 degrees. Bake for 30 minutes.";
+  string compressed = dictionary.compress(text);
+  EXPECT_LT(compressed.size(), text.size() / 2);
+  EXPECT_EQ(text, dictionary.decompress(compressed.data(), compressed.size()));
+}
+
+TEST(CompressTest, EscapeLeadBytes) {
+  TextDictionary dictionary;
+  dictionary.train(corpus());
+  string text = "Bake for \xf8\xff minutes.";
+  string compressed = dictionary.compress(text);
+  EXPECT_EQ(text, dictionary.decompress(compressed.data(), compressed.size()));
+}
+
+TEST(CompressTest, WrongGeneration) {
+  TextDictionary dictionary;
+  dictionary.train(corpus());
+  string compressed = dictionary.compress("Bake for 30 minutes.");
+  dictionary.train(corpus());
+  EXPECT_THROW(dictionary.decompress(compressed.data(), compressed.size()), compress_exception);
+}
+
+TEST(CompressTest, InvalidCode) {
+  TextDictionary dictionary;
+  string compressed = dictionary.compress("x");
+  compressed += "\xf9\x01";
+  EXPECT_THROW(dictionary.decompress(compressed.data(), compressed.size()), compress_exception);
+}
@@ -13,6 +13,8 @@
 
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cstdio>
+#include <cstdlib>
 #include <gtest/gtest.h>
 #include "database.hh"
 
@@ -30,6 +32,11 @@ int has_row(void *exist, int, char**, char**) {
   return 0;
 }
 
+int int_value(void *value, int, char **values, char**) {
+  *(int *)value = atoi(values[0]);
+  return 0;
+}
+
 TEST(DatabaseTest, CreateRecipeTable) {
   Database database;
   database.open(":memory:");
@@ -220,6 +227,132 @@ TEST(DatabaseTest, GetRecipeCountAndTitles) {
   EXPECT_EQ("Recipe B", info[1].second);
 }
 
+TEST(DatabaseTest, GetTitlesPageByPage) {
+  Database database;
+  database.open(":memory:");
+  const char *titles[] = {"banana", "Apple", "cherry", "apple", "Banana"};
+  for (int i=0; i<5; i++) {
+    Recipe recipe;
+    recipe.set_title(titles[i]);
+    database.insert_recipe(recipe);
+  };
+  vector<pair<sqlite3_int64, string> > pages = database.recipe_info(0, "", 2);
+  ASSERT_EQ(2, pages.size());
+  while (true) {
+    vector<pair<sqlite3_int64, string> > page = database.recipe_info(pages.back().first, pages.back().second.c_str(), 2);
+    if (page.empty())
+      break;
+    pages.insert(pages.end(), page.begin(), page.end());
+  };
+  EXPECT_EQ(database.recipe_info(), pages);
+  EXPECT_EQ(2, pages[0].first);
+  EXPECT_EQ(4, pages[1].first);
+  EXPECT_EQ(3, pages[4].first);
+}
+
+TEST(DatabaseTest, GetTitlesIntoStringPool) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.set_title("Recipe B");
+  database.insert_recipe(recipe);
+  recipe.set_title("Recipe A");
+  database.insert_recipe(recipe);
+  StringPool pool;
+  vector<pair<sqlite3_int64, string_view> > page = database.recipe_info(0, "", 10, pool);
+  ASSERT_EQ(2, page.size());
+  EXPECT_EQ(make_pair((sqlite3_int64)2, string_view("Recipe A")), page[0]);
+  EXPECT_EQ(18, pool.bytes());
+  database.select_by_text("recipe");
+  EXPECT_EQ(2, database.ranked_recipe_info("recipe", 0, 10, pool).size());
+  EXPECT_EQ(36, pool.bytes());
+}
+
+TEST(DatabaseTest, GetTitlesPageOfSelection) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1;
+  recipe1.set_title("Recipe B");
+  database.insert_recipe(recipe1);
+  Recipe recipe2;
+  recipe2.set_title("Recipe A");
+  database.insert_recipe(recipe2);
+  Recipe recipe3;
+  recipe3.set_title("Other");
+  database.insert_recipe(recipe3);
+  database.select_by_title("Recipe");
+  vector<pair<sqlite3_int64, string> > page = database.recipe_info(2, "Recipe A", 10);
+  ASSERT_EQ(1, page.size());
+  EXPECT_EQ("Recipe B", page[0].second);
+}
+
+TEST(DatabaseTest, TitleIndexUsedForPages) {
+  Database database;
+  database.open(":memory:");
+  sqlite3_stmt *statement;
+  sqlite3_prepare_v2(database.db(), "EXPLAIN QUERY PLAN SELECT id, title FROM recipes WHERE (sortkey, id) > (x'00', 1) "
+                     "ORDER BY sortkey, id LIMIT 10;", -1, &statement, NULL);
+  ASSERT_EQ(SQLITE_ROW, sqlite3_step(statement));
+  string plan = (const char *)sqlite3_column_text(statement, 3);
+  sqlite3_finalize(statement);
+  EXPECT_NE(string::npos, plan.find("recipes_sortkey"));
+}
+
+TEST(DatabaseTest, SortTitlesWithDiacritics) {
+  Database database;
+  database.open(":memory:");
+  const char *titles[] = {"Zwiebelkuchen", "\xc3\x84pfel im Schlafrock", "Apfelstrudel", "\xc3\xa9" "clair"};
+  for (int i=0; i<4; i++) {
+    Recipe recipe;
+    recipe.set_title(titles[i]);
+    database.insert_recipe(recipe);
+  };
+  vector<pair<sqlite3_int64, string> > info = database.recipe_info();
+  EXPECT_EQ(2, info[0].first);
+  EXPECT_EQ(3, info[1].first);
+  EXPECT_EQ(4, info[2].first);
+  EXPECT_EQ(1, info[3].first);
+}
+
+TEST(DatabaseTest, SortTitlesInLanguage) {
+  Database database;
+  database.open(":memory:");
+  const char *titles[] = {"\xc4\x8c" "esnova juha", "Cvetaca", "Dunajski zrezek"};
+  for (int i=0; i<3; i++) {
+    Recipe recipe;
+    recipe.set_title(titles[i]);
+    database.insert_recipe(recipe);
+  };
+  EXPECT_EQ(1, database.recipe_info()[0].first);
+  database.set_language("sl");
+  EXPECT_EQ("sl", database.language());
+  vector<pair<sqlite3_int64, string> > info = database.recipe_info();
+  EXPECT_EQ(2, info[0].first);
+  EXPECT_EQ(1, info[1].first);
+  EXPECT_EQ(3, info[2].first);
+  EXPECT_EQ(3, database.recipe_info(1, titles[0], 10)[0].first);
+}
+
+TEST(DatabaseTest, KeepSortingLanguage) {
+  remove("language.sqlite");
+  {
+    Database database;
+    database.open("language.sqlite");
+    database.set_language("de");
+  }
+  {
+    Database database;
+    database.open("language.sqlite");
+    EXPECT_EQ("de", database.language());
+  }
+  {
+    Database database;
+    database.open("language.sqlite", true);
+    EXPECT_EQ("de", database.language());
+  }
+  remove("language.sqlite");
+}
+
 TEST(DatabaseTest, SelectByTitle) {
   Database database;
   database.open(":memory:");
@@ -419,6 +552,1211 @@ TEST(DatabaseTest, DeleteRecipes) {
   EXPECT_EQ(exist, 1);
 }
 
+TEST(DatabaseTest, DeleteCascades) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_category("A");
+  recipe.add_instruction("Stir.");
+  recipe.add_instruction_section(0, "Preparation");
+  Ingredient ingredient;
+  ingredient.add_text("water");
+  recipe.add_ingredient(ingredient);
+  recipe.add_ingredient_section(0, "Base");
+  database.insert_recipe(recipe);
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  database.delete_recipes(ids);
+  const char *tables[] = {"category", "ingredient", "instruction", "ingredientsection", "instructionsection"};
+  for (int i=0; i<5; i++) {
+    int exist = 0;
+    string query = string("SELECT recipeid FROM ") + tables[i] + ";";
+    sqlite3_exec(database.db(), query.c_str(), &has_row, &exist, NULL);
+    EXPECT_EQ(0, exist) << tables[i];
+  };
+  EXPECT_EQ(0, database.num_recipes());
+}
+
+TEST(DatabaseTest, MigrateToCascadingDelete) {
+  remove("migrate.sqlite");
+  sqlite3 *db;
+  sqlite3_open("migrate.sqlite", &db);
+  sqlite3_exec(db,
+    "CREATE TABLE recipes(id INTEGER PRIMARY KEY, title VARCHAR(60) NOT NULL, servings INTEGER NOT NULL, "
+    "servingsunit VARCHAR(40) NOT NULL);\n"
+    "CREATE TABLE categories(id INTEGER PRIMARY KEY, name VARCHAR(40) UNIQUE NOT NULL);\n"
+    "CREATE TABLE category(recipeid INTEGER NOT NULL, categoryid INTEGER NOT NULL, PRIMARY KEY(recipeid, categoryid), "
+    "FOREIGN KEY(recipeid) REFERENCES recipes(id), FOREIGN KEY(categoryid) REFERENCES categories(id));\n"
+    "CREATE TABLE ingredients(id INTEGER PRIMARY KEY, name VARCHAR(60) UNIQUE NOT NULL);\n"
+    "CREATE TABLE ingredient(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, amountint INTEGER NOT NULL, "
+    "amountnum INTEGER NOT NULL, amountdenom INTEGER NOT NULL, amountfloat REAL NOT NULL, unit CHARACTER(2) NOT NULL, "
+    "ingredientid INTEGER NOT NULL, PRIMARY KEY(recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id), "
+    "FOREIGN KEY(ingredientid) REFERENCES ingredients(id));\n"
+    "CREATE TABLE instruction(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, txt TEXT NOT NULL, "
+    "PRIMARY KEY(recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id));\n"
+    "CREATE TABLE ingredientsection(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, title VARCHAR(60) NOT NULL, "
+    "PRIMARY KEY (recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id));\n"
+    "CREATE TABLE instructionsection(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, title VARCHAR(60) NOT NULL, "
+    "PRIMARY KEY (recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id));\n"
+    "INSERT INTO recipes VALUES(1, 'Recipe A', 1, 'servings');\n"
+    "INSERT INTO categories VALUES(1, 'A');\n"
+    "INSERT INTO category VALUES(1, 1);\n"
+    "INSERT INTO instruction VALUES(1, 1, 'Stir.');\n"
+    "PRAGMA user_version = 3;\n",
+    NULL, NULL, NULL);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("migrate.sqlite");
+    Recipe recipe = database.fetch_recipe(1);
+    EXPECT_EQ("Recipe A", recipe.title());
+    ASSERT_EQ(1, recipe.instructions().size());
+    EXPECT_EQ(1, database.ranked_recipe_info("stir", 0, 10).size());
+    vector<sqlite3_int64> ids;
+    ids.push_back(1);
+    database.delete_recipes(ids);
+    int exist = 0;
+    sqlite3_exec(database.db(), "SELECT recipeid FROM category UNION ALL SELECT recipeid FROM instruction;", &has_row, &exist,
+                 NULL);
+    EXPECT_EQ(0, exist);
+  }
+  remove("migrate.sqlite");
+}
+
+TEST(DatabaseTest, MigrateUnitCodes) {
+  remove("migrate.sqlite");
+  sqlite3 *db;
+  sqlite3_open("migrate.sqlite", &db);
+  sqlite3_exec(db,
+    "CREATE TABLE recipes(id INTEGER PRIMARY KEY, title VARCHAR(60) NOT NULL, servings INTEGER NOT NULL, "
+    "servingsunit VARCHAR(40) NOT NULL);\n"
+    "CREATE TABLE categories(id INTEGER PRIMARY KEY, name VARCHAR(40) UNIQUE NOT NULL);\n"
+    "CREATE TABLE category(recipeid INTEGER NOT NULL, categoryid INTEGER NOT NULL, PRIMARY KEY(recipeid, categoryid), "
+    "FOREIGN KEY(recipeid) REFERENCES recipes(id), FOREIGN KEY(categoryid) REFERENCES categories(id));\n"
+    "CREATE TABLE ingredients(id INTEGER PRIMARY KEY, name VARCHAR(60) UNIQUE NOT NULL);\n"
+    "CREATE TABLE ingredient(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, amountint INTEGER NOT NULL, "
+    "amountnum INTEGER NOT NULL, amountdenom INTEGER NOT NULL, amountfloat REAL NOT NULL, unit CHARACTER(2) NOT NULL, "
+    "ingredientid INTEGER NOT NULL, PRIMARY KEY(recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id), "
+    "FOREIGN KEY(ingredientid) REFERENCES ingredients(id));\n"
+    "CREATE TABLE instruction(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, txt TEXT NOT NULL, "
+    "PRIMARY KEY(recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id));\n"
+    "CREATE TABLE ingredientsection(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, title VARCHAR(60) NOT NULL, "
+    "PRIMARY KEY (recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id));\n"
+    "CREATE TABLE instructionsection(recipeid INTEGER NOT NULL, line INTEGER NOT NULL, title VARCHAR(60) NOT NULL, "
+    "PRIMARY KEY (recipeid, line), FOREIGN KEY(recipeid) REFERENCES recipes(id));\n"
+    "INSERT INTO recipes VALUES(1, 'Recipe A', 1, 'servings');\n"
+    "INSERT INTO ingredients VALUES(1, 'salt');\n"
+    "INSERT INTO ingredients VALUES(2, 'flour');\n"
+    "INSERT INTO ingredient VALUES(1, 1, 1, 0, 1, 0.0, 't ', 1);\n"
+    "INSERT INTO ingredient VALUES(1, 2, 200, 0, 1, 0.0, 'g ', 2);\n"
+    "PRAGMA user_version = 3;\n",
+    NULL, NULL, NULL);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("migrate.sqlite");
+    Recipe recipe = database.fetch_recipe(1);
+    ASSERT_EQ(2, recipe.ingredients().size());
+    EXPECT_EQ(UNIT_TEASPOON, recipe.ingredients()[0].unit_index());
+    EXPECT_EQ(UNIT_GRAM, recipe.ingredients()[1].unit_index());
+    int text = 0;
+    sqlite3_exec(database.db(), "SELECT unit FROM ingredient WHERE typeof(unit) <> 'integer';", &has_row, &text, NULL);
+    EXPECT_EQ(0, text);
+    int unhashed = 0;
+    sqlite3_exec(database.db(), "SELECT id FROM recipes WHERE fingerprint IS NULL;", &has_row, &unhashed, NULL);
+    EXPECT_EQ(0, unhashed);
+    database.select_by_ingredient("salt");
+    EXPECT_EQ(1, database.num_recipes());
+    database.delete_recipes(vector<sqlite3_int64>(1, 1));
+    database.garbage_collect();
+    int orphans = 0;
+    sqlite3_exec(database.db(), "SELECT id FROM ingredients;", &has_row, &orphans, NULL);
+    EXPECT_EQ(0, orphans);
+  }
+  remove("migrate.sqlite");
+}
+
+TEST(DatabaseTest, CompactStorageRoundtrip) {
+  Database database;
+  database.open(":memory:");
+  database.set_compact_storage(true);
+  Recipe recipe;
+  recipe.set_title("Recipe A");
+  recipe.add_category("A");
+  Ingredient ingredient;
+  ingredient.set_amount_integer(2);
+  ingredient.set_unit("ts");
+  ingredient.add_text("salt");
+  recipe.add_ingredient(ingredient);
+  recipe.add_instruction("Stir.");
+  recipe.add_instruction_section(0, "Preparation");
+  database.insert_recipe(recipe);
+  int exist = 0;
+  sqlite3_exec(database.db(), "SELECT recipeid FROM ingredient UNION ALL SELECT recipeid FROM instruction;", &has_row, &exist,
+               NULL);
+  EXPECT_EQ(0, exist);
+  Recipe result = database.fetch_recipe(1);
+  EXPECT_EQ("Recipe A", result.title());
+  ASSERT_EQ(1, result.categories().size());
+  ASSERT_EQ(1, result.ingredients().size());
+  EXPECT_EQ(2, result.ingredients()[0].amount_integer());
+  EXPECT_EQ("salt", result.ingredients()[0].text());
+  ASSERT_EQ(1, result.instructions().size());
+  EXPECT_EQ("Stir.", result.instructions()[0]);
+  ASSERT_EQ(1, result.instruction_sections().size());
+}
+
+TEST(DatabaseTest, MixedStorageSearchAndDelete) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1;
+  recipe1.set_title("Recipe A");
+  Ingredient ingredient1;
+  ingredient1.add_text("salt");
+  recipe1.add_ingredient(ingredient1);
+  database.insert_recipe(recipe1);
+  database.set_compact_storage(true);
+  Recipe recipe2;
+  recipe2.set_title("Recipe B");
+  Ingredient ingredient2;
+  ingredient2.add_text("pepper");
+  recipe2.add_ingredient(ingredient2);
+  recipe2.add_ingredient(ingredient2);
+  database.insert_recipe(recipe2);
+  database.select_by_ingredient("pepper");
+  ASSERT_EQ(1, database.num_recipes());
+  EXPECT_EQ("Recipe B", database.recipe_info()[0].second);
+  EXPECT_EQ(2, database.fetch_recipe(2).ingredients().size());
+  EXPECT_EQ(1, database.fetch_recipe(1).ingredients().size());
+  vector<sqlite3_int64> ids;
+  ids.push_back(2);
+  database.delete_recipes(ids);
+  database.garbage_collect();
+  int exist = 0;
+  sqlite3_exec(database.db(), "SELECT name FROM ingredients;", &has_row, &exist, NULL);
+  EXPECT_EQ(1, exist);
+}
+
+TEST(DatabaseTest, CompressInstructions) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_instruction("Preheat oven to 350 degrees.");
+  recipe.add_instruction("Bake for 30 minutes.");
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  database.train_dictionary();
+  database.insert_recipe(recipe);
+  int compressed = 0;
+  sqlite3_exec(database.db(), "SELECT recipeid FROM instruction WHERE typeof(txt) = 'blob';", &has_row, &compressed, NULL);
+  EXPECT_EQ(6, compressed);
+  for (int id=1; id<=3; id++) {
+    Recipe result = database.fetch_recipe(id);
+    ASSERT_EQ(2, result.instructions().size());
+    EXPECT_EQ("Preheat oven to 350 degrees.", result.instructions()[0]);
+    EXPECT_EQ("Bake for 30 minutes.", result.instructions()[1]);
+  };
+  int found = 0;
+  sqlite3_exec(database.db(), "SELECT recipeid FROM instruction WHERE anymeal_text(txt) LIKE '%oven%';", &has_row, &found, NULL);
+  EXPECT_EQ(3, found);
+}
+
+TEST(DatabaseTest, ReloadDictionary) {
+  remove("dictionary.sqlite");
+  {
+    Database database;
+    database.open("dictionary.sqlite");
+    Recipe recipe;
+    recipe.add_instruction("Preheat oven to 350 degrees.");
+    database.insert_recipe(recipe);
+    database.insert_recipe(recipe);
+    Database reader;
+    reader.open("dictionary.sqlite", true);
+    EXPECT_EQ("Preheat oven to 350 degrees.", reader.fetch_recipe(1).instructions()[0]);
+    database.train_dictionary();
+    EXPECT_EQ("Preheat oven to 350 degrees.", reader.fetch_recipe(1).instructions()[0]);
+  }
+  remove("dictionary.sqlite");
+}
+
+TEST(DatabaseTest, RollbackDictionary) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_instruction("Preheat oven to 350 degrees.");
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  database.begin();
+  database.train_dictionary();
+  database.rollback();
+  database.insert_recipe(recipe);
+  EXPECT_EQ("Preheat oven to 350 degrees.", database.fetch_recipe(3).instructions()[0]);
+  int compressed = 0;
+  sqlite3_exec(database.db(), "SELECT recipeid FROM instruction WHERE typeof(txt) = 'blob';", &has_row, &compressed, NULL);
+  EXPECT_EQ(0, compressed);
+}
+
+TEST(DatabaseTest, CategoryCountsAfterSelectingAll) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1;
+  recipe1.set_title("Cake");
+  recipe1.add_category("A");
+  database.insert_recipe(recipe1);
+  Recipe recipe2;
+  recipe2.set_title("Bread");
+  database.insert_recipe(recipe2);
+  database.select_by_title("Bread");
+  database.select_all();
+  database.add_recipes_to_category({1, 2}, "B");
+  // Counts of the previous selection are not maintained while all recipes are selected.
+  int stale = 0;
+  sqlite3_exec(database.db(), "SELECT name FROM sqlite_temp_master WHERE name IN ('categorycounts', 'selected_category_insert');",
+               &has_row, &stale, NULL);
+  EXPECT_EQ(0, stale);
+  database.select_by_title("Bread");
+  vector<string> categories = database.categories();
+  ASSERT_EQ(1, categories.size());
+  EXPECT_EQ("B", categories[0]);
+  int count = 0;
+  sqlite3_exec(database.db(), "SELECT count FROM categorycounts, categories WHERE categoryid = categories.id AND name = 'B';",
+               &int_value, &count, NULL);
+  EXPECT_EQ(1, count);
+  database.select_all();
+  database.remove_recipes_from_category({2}, "B");
+  database.select_by_title("Bread");
+  EXPECT_EQ(0, database.categories().size());
+}
+
+TEST(DatabaseTest, MaintainSelectedCategoryCounts) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1;
+  recipe1.set_title("Cake");
+  recipe1.add_category("A");
+  recipe1.add_category("B");
+  database.insert_recipe(recipe1);
+  Recipe recipe2;
+  recipe2.set_title("Bread");
+  recipe2.add_category("B");
+  database.insert_recipe(recipe2);
+  Recipe recipe3;
+  recipe3.set_title("Cookies");
+  recipe3.add_category("C");
+  database.insert_recipe(recipe3);
+  EXPECT_EQ(3, database.num_recipes());
+  vector<string> categories = database.categories();
+  ASSERT_EQ(3, categories.size());
+  EXPECT_EQ("B", categories[0]);
+  database.select_by_title("C");
+  EXPECT_EQ(2, database.num_recipes());
+  categories = database.categories();
+  ASSERT_EQ(3, categories.size());
+  EXPECT_EQ("A", categories[0]);
+  vector<sqlite3_int64> ids;
+  ids.push_back(3);
+  database.add_recipes_to_category(ids, "A");
+  ids[0] = 1;
+  database.remove_recipes_from_category(ids, "B");
+  database.delete_recipes(ids);
+  EXPECT_EQ(1, database.num_recipes());
+  categories = database.categories();
+  ASSERT_EQ(2, categories.size());
+  EXPECT_EQ("A", categories[0]);
+  EXPECT_EQ("C", categories[1]);
+  database.select_all();
+  EXPECT_EQ(2, database.num_recipes());
+  EXPECT_EQ(3, database.categories().size());
+}
+
+static Recipe recipe_with_ingredients(const char *title, const vector<string> &ingredients) {
+  Recipe recipe;
+  recipe.set_title(title);
+  for (vector<string>::const_iterator text=ingredients.begin(); text!=ingredients.end(); text++) {
+    Ingredient ingredient;
+    ingredient.add_text(text->c_str());
+    recipe.add_ingredient(ingredient);
+  };
+  return recipe;
+}
+
+TEST(DatabaseTest, PantryRanking) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = recipe_with_ingredients("Pancakes", {"flour", "eggs", "milk", "sugar"});
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = recipe_with_ingredients("Omelette", {"eggs", "salt"});
+  database.insert_recipe(recipe2);
+  Recipe recipe3 = recipe_with_ingredients("Salad", {"lettuce", "tomatoes"});
+  database.insert_recipe(recipe3);
+  database.set_compact_storage(true);
+  Recipe recipe4 = recipe_with_ingredients("Scrambled eggs", {"eggs", "butter", "salt"});
+  database.insert_recipe(recipe4);
+  vector<pair<sqlite3_int64, double> > ranking = database.pantry({"egg", "salt", "flour"}, 10);
+  ASSERT_EQ(3, ranking.size());
+  EXPECT_EQ(2, ranking[0].first);
+  EXPECT_DOUBLE_EQ(1.0, ranking[0].second);
+  EXPECT_EQ(4, ranking[1].first);
+  EXPECT_DOUBLE_EQ(2.0 / 3.0, ranking[1].second);
+  EXPECT_EQ(1, ranking[2].first);
+  EXPECT_DOUBLE_EQ(0.5, ranking[2].second);
+}
+
+TEST(DatabaseTest, PantryMatchesWholeWords) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = recipe_with_ingredients("Shortbread", {"unsalted butter", "flour"});
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = recipe_with_ingredients("Dressing", {"extra virgin olive oil", "Salt"});
+  database.insert_recipe(recipe2);
+  Recipe recipe3 = recipe_with_ingredients("Fries", {"potatoes", "oil"});
+  database.insert_recipe(recipe3);
+  vector<pair<sqlite3_int64, double> > ranking = database.pantry({"salt"}, 10);
+  ASSERT_EQ(1, ranking.size());
+  EXPECT_EQ(2, ranking[0].first);
+  ranking = database.pantry({"Olive Oil"}, 10);
+  ASSERT_EQ(1, ranking.size());
+  EXPECT_EQ(2, ranking[0].first);
+  ranking = database.pantry({"potato"}, 10);
+  ASSERT_EQ(1, ranking.size());
+  EXPECT_EQ(3, ranking[0].first);
+}
+
+TEST(DatabaseTest, PantryAfterMigration) {
+  remove("migrate.sqlite");
+  {
+    Database database;
+    database.open("migrate.sqlite");
+    Recipe recipe = recipe_with_ingredients("Omelette", {"eggs", "salt"});
+    database.insert_recipe(recipe);
+  }
+  sqlite3 *db;
+  sqlite3_open("migrate.sqlite", &db);
+  sqlite3_exec(db, "DROP TABLE ingredienttokens; PRAGMA user_version = 14;", NULL, NULL, NULL);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("migrate.sqlite");
+    vector<pair<sqlite3_int64, double> > ranking = database.pantry({"egg"}, 10);
+    ASSERT_EQ(1, ranking.size());
+    EXPECT_DOUBLE_EQ(0.5, ranking[0].second);
+  }
+  remove("migrate.sqlite");
+}
+
+TEST(DatabaseTest, IngredientTokensRemovedWithIngredient) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe = recipe_with_ingredients("Omelette", {"eggs"});
+  database.insert_recipe(recipe);
+  database.delete_recipes({1});
+  database.garbage_collect();
+  int tokens = 0;
+  sqlite3_exec(database.db(), "SELECT * FROM ingredienttokens;", &has_row, &tokens, NULL);
+  EXPECT_EQ(0, tokens);
+}
+
+TEST(DatabaseTest, PantryTopResults) {
+  Database database;
+  database.open(":memory:");
+  for (int i=0; i<5; i++) {
+    Recipe recipe = recipe_with_ingredients("Boiled water", {"water"});
+    database.insert_recipe(recipe);
+  };
+  vector<pair<sqlite3_int64, double> > ranking = database.pantry({"water"}, 2);
+  ASSERT_EQ(2, ranking.size());
+  EXPECT_EQ(1, ranking[0].first);
+  EXPECT_EQ(2, ranking[1].first);
+}
+
+TEST(DatabaseTest, PantryCountsEachIngredientOnce) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe = recipe_with_ingredients("Omelette", {"eggs", "salt", "eggs"});
+  database.insert_recipe(recipe);
+  vector<pair<sqlite3_int64, double> > ranking = database.pantry({"egg", "eggs"}, 10);
+  ASSERT_EQ(1, ranking.size());
+  EXPECT_DOUBLE_EQ(0.5, ranking[0].second);
+}
+
+TEST(DatabaseTest, PantryWithinSelection) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = recipe_with_ingredients("Omelette", {"eggs"});
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = recipe_with_ingredients("Fried eggs", {"eggs"});
+  database.insert_recipe(recipe2);
+  database.select_by_title("Fried");
+  vector<pair<sqlite3_int64, double> > ranking = database.pantry({"eggs"}, 10);
+  ASSERT_EQ(1, ranking.size());
+  EXPECT_EQ(2, ranking[0].first);
+  vector<sqlite3_int64> ids;
+  database.select_ids(ids);
+  EXPECT_EQ(0, database.num_recipes());
+}
+
+TEST(DatabaseTest, RestoreRankedSnapshot) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = recipe_with_ingredients("Pancakes", {"flour", "eggs", "milk", "sugar"});
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = recipe_with_ingredients("Omelette", {"eggs", "salt"});
+  database.insert_recipe(recipe2);
+  Recipe recipe3 = recipe_with_ingredients("Boiled eggs", {"eggs", "water", "salt"});
+  database.insert_recipe(recipe3);
+  vector<pair<sqlite3_int64, double> > ranking = database.pantry({"eggs", "salt"}, 10);
+  vector<sqlite3_int64> order;
+  for (vector<pair<sqlite3_int64, double> >::iterator recipe=ranking.begin(); recipe!=ranking.end(); recipe++)
+    order.push_back(recipe->first);
+  database.select_ids(order);
+  IdBitmap snapshot = database.selection_bitmap();
+  database.select_all();
+  database.delete_recipes({3});
+  database.restore_selection(snapshot);
+  EXPECT_EQ(2, database.num_recipes());
+  vector<pair<sqlite3_int64, string> > titles = database.recipe_info(order);
+  ASSERT_EQ(2, titles.size());
+  EXPECT_EQ("Omelette", titles[0].second);
+  EXPECT_EQ("Pancakes", titles[1].second);
+}
+
+TEST(DatabaseTest, RankedTextSearch) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = recipe_with_ingredients("Apple pie", {"apples", "flour"});
+  recipe1.add_instruction("Bake the pie.");
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = recipe_with_ingredients("Crumble", {"apple", "oats"});
+  recipe2.add_instruction("Serve with apple sauce.");
+  database.insert_recipe(recipe2);
+  Recipe recipe3 = recipe_with_ingredients("Bread", {"flour"});
+  database.insert_recipe(recipe3);
+  database.select_by_text("apple pie");
+  EXPECT_EQ(2, database.num_recipes());
+  vector<pair<sqlite3_int64, string> > ranking = database.ranked_recipe_info("apple pie", 0, 10);
+  ASSERT_EQ(2, ranking.size());
+  EXPECT_EQ("Apple pie", ranking[0].second);
+  EXPECT_EQ("Crumble", ranking[1].second);
+  ranking = database.ranked_recipe_info("apple pie", 1, 10);
+  ASSERT_EQ(1, ranking.size());
+  EXPECT_EQ("Crumble", ranking[0].second);
+}
+
+TEST(DatabaseTest, TextSearchSyntax) {
+  EXPECT_EQ("\"apple\" OR \"pie\"", Database::search_query(" apple  pie "));
+  EXPECT_EQ("\"\"\"a\"\"\" OR \"(b\"", Database::search_query("\"a\" (b"));
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.set_title("Apple pie");
+  database.insert_recipe(recipe);
+  database.select_by_text("apple AND (");
+  EXPECT_EQ(1, database.num_recipes());
+}
+
+TEST(DatabaseTest, DeletedRecipeNotFound) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.set_title("Apple pie");
+  database.insert_recipe(recipe);
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  database.delete_recipes(ids);
+  database.select_all();
+  EXPECT_EQ(0, database.ranked_recipe_info("apple", 0, 10).size());
+}
+
+TEST(DatabaseTest, SelectByQuery) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = recipe_with_ingredients("Tofu soup", {"tofu", "water"});
+  recipe1.add_category("vegan");
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = recipe_with_ingredients("Peanut soup", {"peanuts", "water"});
+  recipe2.add_category("vegan");
+  database.insert_recipe(recipe2);
+  Recipe recipe3 = recipe_with_ingredients("Chicken soup", {"chicken", "water"});
+  database.insert_recipe(recipe3);
+  Recipe recipe4 = recipe_with_ingredients("Tofu salad", {"tofu"});
+  database.insert_recipe(recipe4);
+  database.select_by_query("title:soup AND (cat:vegan OR ing:tofu) AND NOT ing:nuts");
+  vector<pair<sqlite3_int64, string> > titles = database.recipe_info();
+  ASSERT_EQ(1, titles.size());
+  EXPECT_EQ("Tofu soup", titles[0].second);
+  database.select_all();
+  database.select_by_query("tofu OR cat:veg");
+  EXPECT_EQ(3, database.num_recipes());
+}
+
+TEST(DatabaseTest, SelectByQueryWithinSelection) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = recipe_with_ingredients("Tofu soup", {"tofu"});
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = recipe_with_ingredients("Tofu salad", {"tofu"});
+  database.insert_recipe(recipe2);
+  database.select_by_title("soup");
+  database.select_by_query("ing:tofu");
+  EXPECT_EQ(1, database.num_recipes());
+}
+
+TEST(DatabaseTest, EmptyQuerySelectsAll) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe = recipe_with_ingredients("Tofu soup", {"tofu"});
+  database.insert_recipe(recipe);
+  database.select_by_query(" ");
+  EXPECT_EQ(1, database.num_recipes());
+}
+
+TEST(DatabaseTest, RestoreSelection) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1;
+  recipe1.set_title("Tofu soup");
+  recipe1.add_category("vegan");
+  database.insert_recipe(recipe1);
+  Recipe recipe2;
+  recipe2.set_title("Tofu salad");
+  recipe2.add_category("vegan");
+  database.insert_recipe(recipe2);
+  Recipe recipe3;
+  recipe3.set_title("Chicken soup");
+  database.insert_recipe(recipe3);
+  database.select_all();
+  IdBitmap all = database.selection_bitmap();
+  EXPECT_EQ(3, all.size());
+  database.select_by_title("soup");
+  IdBitmap soup = database.selection_bitmap();
+  EXPECT_EQ(2, soup.size());
+  EXPECT_TRUE(soup.contains(1));
+  EXPECT_TRUE(soup.contains(3));
+  database.restore_selection(IdBitmap(vector<sqlite3_int64>{3}));
+  EXPECT_EQ(1, database.num_recipes());
+  EXPECT_EQ(0, database.categories().size());
+  database.restore_selection(all);
+  EXPECT_EQ(3, database.num_recipes());
+  EXPECT_EQ(1, database.categories().size());
+  database.restore_selection(soup);
+  EXPECT_EQ(2, database.num_recipes());
+}
+
+TEST(DatabaseTest, RestoreSelectionSkipsDeletedRecipes) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.set_title("Tofu soup");
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  database.select_all();
+  IdBitmap all = database.selection_bitmap();
+  database.delete_recipes(vector<sqlite3_int64>{1});
+  database.restore_selection(all);
+  EXPECT_EQ(1, database.num_recipes());
+}
+
+TEST(DatabaseTest, ProfileStatements) {
+  Database database;
+  database.open(":memory:");
+  EXPECT_FALSE(database.profiling());
+  database.set_profiling(true);
+  EXPECT_TRUE(database.profiling());
+  Recipe recipe;
+  recipe.set_title("Tofu soup");
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  database.select_all();
+  database.recipe_info();
+  vector<pair<string, StatementProfile> > profile = database.profile();
+  ASSERT_FALSE(profile.empty());
+  bool found = false;
+  for (vector<pair<string, StatementProfile> >::iterator entry=profile.begin(); entry!=profile.end(); entry++) {
+    if (entry->first.find("SELECT id, title FROM recipes") == 0) {
+      found = true;
+      EXPECT_EQ(1, entry->second.count());
+      EXPECT_EQ(2, entry->second.rows());
+      EXPECT_GT(entry->second.vm_steps(), 0);
+    };
+    if (entry != profile.begin()) {
+      EXPECT_LE(entry->second.total(), (entry - 1)->second.total());
+    };
+  };
+  EXPECT_TRUE(found);
+  database.reset_profile();
+  EXPECT_TRUE(database.profile().empty());
+  database.set_profiling(false);
+  database.recipe_info();
+  EXPECT_TRUE(database.profile().empty());
+}
+
+TEST(DatabaseTest, PrepareStatementsOnFirstUse) {
+  Database database;
+  database.open(":memory:");
+  int statements = 0;
+  for (sqlite3_stmt *statement=sqlite3_next_stmt(database.db(), NULL); statement; statement=sqlite3_next_stmt(database.db(), statement))
+    statements++;
+  EXPECT_LT(statements, 10);
+}
+
+TEST(DatabaseTest, ImplicitSelectionOfAllRecipes) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1;
+  recipe1.set_title("Tofu soup");
+  recipe1.add_category("vegan");
+  database.insert_recipe(recipe1);
+  Recipe recipe2;
+  recipe2.set_title("Chicken soup");
+  database.insert_recipe(recipe2);
+  EXPECT_EQ(2, database.num_recipes());
+  EXPECT_EQ(2, database.recipe_info().size());
+  ASSERT_EQ(1, database.categories().size());
+  EXPECT_EQ("vegan", database.categories()[0]);
+  database.select_by_title("Tofu");
+  EXPECT_EQ(1, database.num_recipes());
+  database.select_all();
+  EXPECT_EQ(2, database.num_recipes());
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  database.delete_recipes(ids);
+  EXPECT_EQ(1, database.num_recipes());
+  EXPECT_EQ(0, database.categories().size());
+}
+
+TEST(DatabaseTest, BackupAndRestore) {
+  remove("backup.sqlite");
+  {
+    Database database;
+    database.open(":memory:");
+    Recipe recipe;
+    recipe.set_title("Recipe A");
+    recipe.add_category("Cakes");
+    recipe.add_instruction("Stir.");
+    database.insert_recipe(recipe);
+    database.backup_to("backup.sqlite");
+  }
+  {
+    Database database;
+    database.open(":memory:");
+    Recipe recipe;
+    recipe.set_title("Recipe B");
+    database.insert_recipe(recipe);
+    database.insert_recipe(recipe);
+    database.select_by_title("B");
+    database.restore_from("backup.sqlite");
+    EXPECT_EQ(1, database.num_recipes());
+    EXPECT_EQ("Recipe A", database.recipe_info()[0].second);
+    EXPECT_EQ("Stir.", database.fetch_recipe(1).instructions()[0]);
+    EXPECT_EQ(1, database.count_recipes("Cakes"));
+    EXPECT_EQ(1, database.ranked_recipe_info("stir", 0, 10).size());
+  }
+  remove("backup.sqlite");
+}
+
+TEST(DatabaseTest, BackupProgress) {
+  remove("backup.sqlite");
+  Database database;
+  database.open(":memory:");
+  int calls = 0;
+  int remaining = -1;
+  database.backup_to("backup.sqlite", [&](int r, int) { calls++; remaining = r; return true; });
+  EXPECT_GT(calls, 0);
+  EXPECT_EQ(0, remaining);
+  remove("backup.sqlite");
+}
+
+TEST(DatabaseTest, CancelBackup) {
+  remove("backup.sqlite");
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_instruction(string(4000000, 'x').c_str());
+  database.insert_recipe(recipe);
+  EXPECT_THROW(database.backup_to("backup.sqlite", [](int, int) { return false; }), database_exception);
+  FILE *file = fopen("backup.sqlite", "rb");
+  EXPECT_EQ(NULL, file);
+  if (file)
+    fclose(file);
+  file = fopen("backup.sqlite.tmp", "rb");
+  EXPECT_EQ(NULL, file);
+  if (file)
+    fclose(file);
+}
+
+TEST(DatabaseTest, CancelBackupKeepsPreviousBackup) {
+  remove("backup.sqlite");
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.set_title("Recipe A");
+  database.insert_recipe(recipe);
+  database.backup_to("backup.sqlite");
+  recipe.add_instruction(string(4000000, 'x').c_str());
+  database.insert_recipe(recipe);
+  EXPECT_THROW(database.backup_to("backup.sqlite", [](int, int) { return false; }), database_exception);
+  Database backup;
+  backup.open("backup.sqlite", true);
+  EXPECT_EQ(1, backup.num_recipes());
+  remove("backup.sqlite");
+}
+
+TEST(DatabaseTest, RestoreDifferentPageSize) {
+  remove("backup.sqlite");
+  remove("restore.sqlite");
+  {
+    Database database;
+    database.open("backup.sqlite");
+    Recipe recipe;
+    recipe.set_title("Recipe A");
+    database.insert_recipe(recipe);
+  }
+  sqlite3 *db;
+  sqlite3_open("backup.sqlite", &db);
+  sqlite3_exec(db, "PRAGMA journal_mode = DELETE; PRAGMA page_size = 8192; VACUUM;", NULL, NULL, NULL);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("restore.sqlite");
+    database.restore_from("backup.sqlite");
+    EXPECT_EQ(1, database.num_recipes());
+    int page_size = 0;
+    sqlite3_exec(database.db(), "PRAGMA page_size;", &int_value, &page_size, NULL);
+    EXPECT_EQ(8192, page_size);
+  }
+  {
+    Database database;
+    database.open("restore.sqlite");
+    EXPECT_EQ(1, database.num_recipes());
+  }
+  remove("backup.sqlite");
+  remove("restore.sqlite");
+  remove("restore.sqlite-wal");
+  remove("restore.sqlite-shm");
+}
+
+TEST(DatabaseTest, RestoreDifferentPageSizeWhileReading) {
+  remove("backup.sqlite");
+  remove("restore.sqlite");
+  {
+    Database database;
+    database.open("backup.sqlite");
+  }
+  sqlite3 *db;
+  sqlite3_open("backup.sqlite", &db);
+  sqlite3_exec(db, "PRAGMA journal_mode = DELETE; PRAGMA page_size = 8192; VACUUM;", NULL, NULL, NULL);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("restore.sqlite");
+    Database reader;
+    reader.open("restore.sqlite", true);
+    EXPECT_THROW(database.restore_from("backup.sqlite"), database_exception);
+    Recipe recipe;
+    recipe.set_title("Recipe B");
+    database.insert_recipe(recipe);
+    EXPECT_EQ(1, reader.num_recipes());
+  }
+  remove("backup.sqlite");
+  remove("restore.sqlite");
+  remove("restore.sqlite-wal");
+  remove("restore.sqlite-shm");
+}
+
+TEST(DatabaseTest, RestoreDifferentPageSizeAfterClosingReader) {
+  remove("backup.sqlite");
+  remove("restore.sqlite");
+  {
+    Database database;
+    database.open("backup.sqlite");
+    Recipe recipe;
+    recipe.set_title("Recipe A");
+    database.insert_recipe(recipe);
+  }
+  sqlite3 *db;
+  sqlite3_open("backup.sqlite", &db);
+  sqlite3_exec(db, "PRAGMA journal_mode = DELETE; PRAGMA page_size = 8192; VACUUM;", NULL, NULL, NULL);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("restore.sqlite");
+    Database reader;
+    reader.open("restore.sqlite", true);
+    EXPECT_EQ(0, reader.num_recipes());
+    // Other connections are closed while restoring and opened again afterwards.
+    reader.close();
+    database.restore_from("backup.sqlite");
+    reader.open("restore.sqlite", true);
+    EXPECT_EQ(1, reader.num_recipes());
+    EXPECT_EQ("Recipe A", reader.fetch_recipe(1).title());
+  }
+  remove("backup.sqlite");
+  remove("restore.sqlite");
+  remove("restore.sqlite-wal");
+  remove("restore.sqlite-shm");
+}
+
+TEST(DatabaseTest, BackupWhileWriting) {
+  remove("online.sqlite");
+  remove("backup.sqlite");
+  {
+    Database writer;
+    writer.open("online.sqlite");
+    writer.begin();
+    for (int i=0; i<2000; i++) {
+      Recipe recipe;
+      recipe.set_title("Recipe");
+      recipe.add_instruction(string(500, 'x').c_str());
+      writer.insert_recipe(recipe);
+    };
+    writer.commit();
+    Database reader;
+    reader.open("online.sqlite", true);
+    int steps = 0;
+    reader.backup_to("backup.sqlite", [&](int, int) {
+      steps++;
+      Recipe recipe;
+      recipe.set_title("Added");
+      writer.insert_recipe(recipe);
+      return true;
+    });
+    EXPECT_GT(steps, 1);
+    Database backup;
+    backup.open("backup.sqlite", true);
+    EXPECT_EQ(2000, backup.num_recipes());
+    EXPECT_EQ(2000 + steps, writer.num_recipes());
+  }
+  remove("online.sqlite");
+  remove("online.sqlite-wal");
+  remove("online.sqlite-shm");
+  remove("backup.sqlite");
+}
+
+TEST(DatabaseTest, RestoreMissingFile) {
+  Database database;
+  database.open(":memory:");
+  EXPECT_THROW(database.restore_from("nosuchfile.sqlite"), database_exception);
+}
+
+static void create_cookbook(const char *filename, const char *title1, const char *title2) {
+  remove(filename);
+  Database database;
+  database.open(filename);
+  Recipe recipe1;
+  recipe1.set_title(title1);
+  recipe1.add_category("Soups");
+  database.insert_recipe(recipe1);
+  Recipe recipe2;
+  recipe2.set_title(title2);
+  database.insert_recipe(recipe2);
+}
+
+TEST(DatabaseTest, SearchAttachedCookbooks) {
+  create_cookbook("main.sqlite", "Bean soup", "Apple pie");
+  create_cookbook("cookbook.sqlite", "Carrot soup", "Tomato soup");
+  {
+    Database database;
+    database.open("main.sqlite");
+    EXPECT_EQ(1, database.attach_cookbook("cookbook.sqlite"));
+    EXPECT_EQ(1, database.num_cookbooks());
+    // Recipes of the main database are taken from the selection.
+    database.select_by_query("soup");
+    vector<pair<sqlite3_int64, string> > infos = database.search_cookbooks("soup", 0, "", 10);
+    ASSERT_EQ(3, infos.size());
+    EXPECT_EQ(make_pair(Database::cookbook_id(0, 1), string("Bean soup")), infos[0]);
+    EXPECT_EQ(make_pair(Database::cookbook_id(1, 1), string("Carrot soup")), infos[1]);
+    EXPECT_EQ(make_pair(Database::cookbook_id(1, 2), string("Tomato soup")), infos[2]);
+    EXPECT_EQ(2, database.count_cookbooks(parse_query("soup")));
+    EXPECT_EQ(1, database.count_cookbooks(parse_query("cat:soups")));
+    EXPECT_EQ(2, database.search_cookbooks("cat:soups", 0, "", 10).size());
+    EXPECT_EQ("Tomato soup", database.fetch_recipe(infos[2].first).title());
+    EXPECT_EQ(3, database.recipe_info().size() + database.fetch_recipes({infos[1].first, infos[2].first}).size());
+  }
+  remove("main.sqlite");
+  remove("cookbook.sqlite");
+}
+
+TEST(DatabaseTest, SearchAttachedCookbooksPageByPage) {
+  create_cookbook("main.sqlite", "Recipe A", "Recipe C");
+  create_cookbook("cookbook1.sqlite", "Recipe B", "Recipe E");
+  create_cookbook("cookbook2.sqlite", "Recipe D", "Recipe F");
+  {
+    Database database;
+    database.open("main.sqlite");
+    database.attach_cookbook("cookbook1.sqlite");
+    EXPECT_EQ(2, database.attach_cookbook("cookbook2.sqlite"));
+    vector<pair<sqlite3_int64, string> > pages = database.search_cookbooks("", 0, "", 4);
+    ASSERT_EQ(4, pages.size());
+    vector<pair<sqlite3_int64, string> > page = database.search_cookbooks("", pages.back().first, pages.back().second.c_str(), 4);
+    ASSERT_EQ(2, page.size());
+    pages.insert(pages.end(), page.begin(), page.end());
+    const char *titles[] = {"Recipe A", "Recipe B", "Recipe C", "Recipe D", "Recipe E", "Recipe F"};
+    for (int i=0; i<6; i++)
+      EXPECT_EQ(titles[i], pages[i].second);
+    EXPECT_EQ(2, Database::cookbook_of(pages[5].first));
+    EXPECT_EQ(2, Database::local_id(pages[5].first));
+  }
+  remove("main.sqlite");
+  remove("cookbook1.sqlite");
+  remove("cookbook2.sqlite");
+}
+
+TEST(DatabaseTest, SearchCookbooksWithinSelection) {
+  create_cookbook("main.sqlite", "Bean soup", "Apple pie");
+  create_cookbook("cookbook.sqlite", "Carrot soup", "Tomato soup");
+  {
+    Database database;
+    database.open("main.sqlite");
+    database.attach_cookbook("cookbook.sqlite");
+    database.select_by_title("pie");
+    vector<pair<sqlite3_int64, string> > infos = database.search_cookbooks("", 0, "", 10);
+    ASSERT_EQ(3, infos.size());
+    EXPECT_EQ("Apple pie", infos[0].second);
+    EXPECT_EQ("Carrot soup", infos[1].second);
+    EXPECT_EQ("Tomato soup", infos[2].second);
+  }
+  remove("main.sqlite");
+  remove("cookbook.sqlite");
+}
+
+TEST(DatabaseTest, SearchCookbooksIgnoresStoredSortKeys) {
+  create_cookbook("main.sqlite", "Bean soup", "Apple pie");
+  create_cookbook("cookbook.sqlite", "Carrot soup", "Tomato soup");
+  {
+    // Sort keys of the cookbook computed for another language must not affect the order.
+    Database cookbook;
+    cookbook.open("cookbook.sqlite");
+    sqlite3_exec(cookbook.db(), "UPDATE recipes SET sortkey = X'00' WHERE title = 'Tomato soup';", NULL, NULL, NULL);
+  }
+  {
+    Database database;
+    database.open("main.sqlite");
+    database.attach_cookbook("cookbook.sqlite");
+    vector<pair<sqlite3_int64, string> > infos = database.search_cookbooks("", 0, "", 2);
+    ASSERT_EQ(2, infos.size());
+    EXPECT_EQ("Apple pie", infos[0].second);
+    EXPECT_EQ("Bean soup", infos[1].second);
+    infos = database.search_cookbooks("", infos[1].first, infos[1].second.c_str(), 2);
+    ASSERT_EQ(2, infos.size());
+    EXPECT_EQ("Carrot soup", infos[0].second);
+    EXPECT_EQ("Tomato soup", infos[1].second);
+  }
+  remove("main.sqlite");
+  remove("cookbook.sqlite");
+}
+
+TEST(DatabaseTest, AttachedCookbooksAreReadOnly) {
+  create_cookbook("main.sqlite", "Bean soup", "Apple pie");
+  create_cookbook("cookbook.sqlite", "Carrot soup", "Tomato soup");
+  {
+    Database database;
+    database.open("main.sqlite");
+    database.attach_cookbook("cookbook.sqlite");
+    EXPECT_NE(SQLITE_OK, sqlite3_exec(database.db(), "DELETE FROM cookbook1.recipes;", NULL, NULL, NULL));
+    database.select_by_query("soup");
+    EXPECT_EQ(3, database.search_cookbooks("soup", 0, "", 10).size());
+  }
+  remove("main.sqlite");
+  remove("cookbook.sqlite");
+}
+
+TEST(DatabaseTest, AttachMissingCookbook) {
+  Database database;
+  database.open(":memory:");
+  EXPECT_THROW(database.attach_cookbook("nosuchfile.sqlite"), database_exception);
+  EXPECT_EQ(0, database.num_cookbooks());
+  EXPECT_THROW(database.fetch_recipe(Database::cookbook_id(1, 1)), database_exception);
+}
+
+TEST(DatabaseTest, MergeDatabase) {
+  remove("main.sqlite");
+  remove("source.sqlite");
+  {
+    Database source;
+    source.open("source.sqlite");
+    Recipe recipe1;
+    recipe1.set_title("Tomato soup");
+    recipe1.add_category("Soups");
+    recipe1.add_category("Starters");
+    Ingredient ingredient;
+    ingredient.set_amount_integer(2);
+    ingredient.set_unit(UNIT_TEASPOON);
+    ingredient.set_text("pepper");
+    recipe1.add_ingredient(ingredient);
+    recipe1.add_ingredient_section(0, "Spices");
+    recipe1.add_instruction("Preheat oven to 350 degrees.");
+    recipe1.add_instruction_section(0, "Preparation");
+    source.insert_recipe(recipe1);
+    recipe1.set_title("Carrot soup");
+    source.insert_recipe(recipe1);
+    source.train_dictionary();
+    int compressed = 0;
+    sqlite3_exec(source.db(), "SELECT recipeid FROM instruction WHERE typeof(txt) = 'blob';", &has_row, &compressed, NULL);
+    EXPECT_EQ(2, compressed);
+    source.set_compact_storage(true);
+    Recipe recipe2;
+    recipe2.set_title("Salad");
+    ingredient.set_text("salt");
+    recipe2.add_ingredient(ingredient);
+    source.insert_recipe(recipe2);
+  }
+  {
+    Database database;
+    database.open("main.sqlite");
+    Recipe recipe;
+    recipe.set_title("Bean soup");
+    recipe.add_category("Soups");
+    database.insert_recipe(recipe);
+    EXPECT_EQ(3, database.merge("source.sqlite"));
+    EXPECT_EQ(4, database.num_recipes());
+    Recipe merged = database.fetch_recipe(2);
+    EXPECT_EQ("Tomato soup", merged.title());
+    EXPECT_EQ(2, merged.categories().size());
+    ASSERT_EQ(1, merged.ingredients().size());
+    EXPECT_EQ("pepper", merged.ingredients()[0].text());
+    EXPECT_EQ(UNIT_TEASPOON, merged.ingredients()[0].unit_index());
+    ASSERT_EQ(1, merged.instructions().size());
+    EXPECT_EQ("Preheat oven to 350 degrees.", merged.instructions()[0]);
+    EXPECT_EQ(1, merged.ingredient_sections().size());
+    EXPECT_EQ(1, merged.instruction_sections().size());
+    EXPECT_EQ("salt", database.fetch_recipe(4).ingredients()[0].text());
+    EXPECT_EQ(3, database.count_recipes("Soups"));
+    EXPECT_EQ(2, database.count_recipes("Starters"));
+    database.select_by_ingredient("salt");
+    EXPECT_EQ(1, database.num_recipes());
+    database.select_all();
+    database.select_by_text("oven");
+    EXPECT_EQ(2, database.num_recipes());
+    database.select_all();
+    vector<pair<sqlite3_int64, string> > infos = database.recipe_info();
+    ASSERT_EQ(4, infos.size());
+    EXPECT_EQ("Bean soup", infos[0].second);
+    EXPECT_EQ("Carrot soup", infos[1].second);
+  }
+  remove("main.sqlite");
+  remove("source.sqlite");
+}
+
+TEST(DatabaseTest, MergeSkipsDuplicates) {
+  create_cookbook("main.sqlite", "Bean soup", "Apple pie");
+  create_cookbook("source.sqlite", "Bean soup", "Tomato soup");
+  {
+    Database source;
+    source.open("source.sqlite");
+    Recipe recipe;
+    recipe.set_title("Tomato soup");
+    source.insert_recipe(recipe);
+  }
+  {
+    Database database;
+    database.open("main.sqlite");
+    EXPECT_EQ(1, database.merge("source.sqlite"));
+    vector<pair<sqlite3_int64, string> > infos = database.recipe_info();
+    ASSERT_EQ(3, infos.size());
+    EXPECT_EQ("Tomato soup", infos[2].second);
+    EXPECT_EQ(3, database.merge("source.sqlite", false));
+    EXPECT_EQ(6, database.num_recipes());
+  }
+  remove("main.sqlite");
+  remove("source.sqlite");
+}
+
+TEST(DatabaseTest, MergeSkipsDuplicatesWithoutFingerprint) {
+  create_cookbook("main.sqlite", "Bean soup", "Apple pie");
+  create_cookbook("source.sqlite", "Bean soup", "Tomato soup");
+  sqlite3 *db;
+  sqlite3_open("source.sqlite", &db);
+  sqlite3_exec(db, "UPDATE recipes SET fingerprint = NULL;", NULL, NULL, NULL);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("main.sqlite");
+    EXPECT_EQ(1, database.merge("source.sqlite"));
+    EXPECT_EQ(3, database.num_recipes());
+    int missing = 0;
+    sqlite3_exec(database.db(), "SELECT id FROM recipes WHERE fingerprint IS NULL;", &has_row, &missing, NULL);
+    EXPECT_EQ(0, missing);
+  }
+  remove("main.sqlite");
+  remove("source.sqlite");
+}
+
+TEST(DatabaseTest, MergeSkipsCategoriesOfDuplicates) {
+  create_cookbook("main.sqlite", "Apple pie", "Bread");
+  {
+    remove("source.sqlite");
+    Database source;
+    source.open("source.sqlite");
+    Recipe recipe;
+    recipe.set_title("Bread");
+    recipe.add_category("Baking");
+    source.insert_recipe(recipe);
+  }
+  {
+    Database database;
+    database.open("main.sqlite");
+    EXPECT_EQ(0, database.merge("source.sqlite"));
+    int categories = 0;
+    sqlite3_exec(database.db(), "SELECT id FROM categories WHERE name = 'Baking';", &has_row, &categories, NULL);
+    EXPECT_EQ(0, categories);
+  }
+  remove("main.sqlite");
+  remove("source.sqlite");
+}
+
+TEST(DatabaseTest, MergeMissingDatabase) {
+  Database database;
+  database.open(":memory:");
+  EXPECT_THROW(database.merge("nosuchfile.sqlite"), database_exception);
+  Recipe recipe;
+  database.insert_recipe(recipe);
+  EXPECT_EQ(1, database.num_recipes());
+}
+
+TEST(DatabaseTest, MigrateToIncrementalVacuum) {
+  remove("migrate.sqlite");
+  {
+    Database database;
+    database.open("migrate.sqlite");
+    Recipe recipe;
+    recipe.set_title("Recipe A");
+    database.insert_recipe(recipe);
+  }
+  sqlite3 *db;
+  sqlite3_open("migrate.sqlite", &db);
+  sqlite3_exec(db, "DROP TABLE ingredienttokens; PRAGMA auto_vacuum = NONE; VACUUM; PRAGMA user_version = 13;", NULL, NULL, NULL);
+  int auto_vacuum = -1;
+  sqlite3_exec(db, "PRAGMA auto_vacuum;", &int_value, &auto_vacuum, NULL);
+  EXPECT_EQ(0, auto_vacuum);
+  sqlite3_close(db);
+  {
+    Database database;
+    database.open("migrate.sqlite");
+    int version = 0;
+    sqlite3_exec(database.db(), "PRAGMA user_version;", &int_value, &version, NULL);
+    EXPECT_EQ(15, version);
+    // Opening the database does not rewrite the file.
+    sqlite3_exec(database.db(), "PRAGMA auto_vacuum;", &int_value, &auto_vacuum, NULL);
+    EXPECT_EQ(0, auto_vacuum);
+    EXPECT_FALSE(database.incremental_vacuum_enabled());
+    EXPECT_NO_THROW(database.incremental_vacuum());
+  }
+  {
+    Database database;
+    database.open("migrate.sqlite");
+    Database reader;
+    reader.open("migrate.sqlite", true);
+    EXPECT_EQ("Recipe A", reader.fetch_recipe(1).title());
+    database.convert_to_incremental_vacuum();
+    EXPECT_TRUE(database.incremental_vacuum_enabled());
+    sqlite3_exec(database.db(), "PRAGMA auto_vacuum;", &int_value, &auto_vacuum, NULL);
+    EXPECT_EQ(2, auto_vacuum);
+    database.incremental_vacuum();
+    EXPECT_EQ("Recipe A", database.fetch_recipe(1).title());
+  }
+  remove("migrate.sqlite");
+}
+
 TEST(DatabaseTest, AddRecipeToCategory) {
   Database database;
   database.open(":memory:");
@@ -447,6 +1785,39 @@ TEST(DatabaseTest, RemoveRecipeFromCategory) {
   ASSERT_EQ(0, result.categories().size());
 }
 
+TEST(DatabaseTest, AddRecipesToCategoryTwice) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_category("A");
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  ids.push_back(2);
+  database.add_recipes_to_category(ids, "B");
+  database.add_recipes_to_category(ids, "B");
+  EXPECT_EQ(3, database.count_recipes("A"));
+  EXPECT_EQ(2, database.count_recipes("B"));
+}
+
+TEST(DatabaseTest, RemoveRecipesFromCategoryKeepsOthers) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_category("A");
+  recipe.add_category("B");
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  vector<sqlite3_int64> ids;
+  ids.push_back(2);
+  database.remove_recipes_from_category(ids, "A");
+  database.remove_recipes_from_category(ids, "C");
+  EXPECT_EQ(1, database.count_recipes("A"));
+  EXPECT_EQ(2, database.count_recipes("B"));
+}
+
 TEST(DatabaseTest, RenameCategory) {
   Database database;
   database.open(":memory:");
@@ -508,6 +1879,64 @@ TEST(DatabaseTest, MergeWithRecipesInBothCategories) {
   EXPECT_EQ("A", *result.categories().begin());
 }
 
+TEST(DatabaseTest, MergeCountsReferences) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_category("A");
+  recipe.add_category("B");
+  database.insert_recipe(recipe);
+  Recipe recipe2;
+  recipe2.add_category("B");
+  database.insert_recipe(recipe2);
+  database.merge_category("B", "A");
+  int refcount = -1;
+  sqlite3_exec(database.db(), "SELECT refcount FROM categories WHERE name = 'A';", &int_value, &refcount, NULL);
+  EXPECT_EQ(2, refcount);
+}
+
+TEST(DatabaseTest, CountReferences) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe;
+  recipe.add_category("A");
+  Ingredient ingredient;
+  ingredient.add_text("water");
+  recipe.add_ingredient(ingredient);
+  database.insert_recipe(recipe);
+  database.insert_recipe(recipe);
+  int refcount = -1;
+  sqlite3_exec(database.db(), "SELECT refcount FROM categories WHERE name = 'A';", &int_value, &refcount, NULL);
+  EXPECT_EQ(2, refcount);
+  sqlite3_exec(database.db(), "SELECT refcount FROM ingredients WHERE name = 'water';", &int_value, &refcount, NULL);
+  EXPECT_EQ(2, refcount);
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  database.delete_recipes(ids);
+  ids[0] = 2;
+  database.remove_recipes_from_category(ids, "A");
+  sqlite3_exec(database.db(), "SELECT refcount FROM categories WHERE name = 'A';", &int_value, &refcount, NULL);
+  EXPECT_EQ(0, refcount);
+  sqlite3_exec(database.db(), "SELECT refcount FROM ingredients WHERE name = 'water';", &int_value, &refcount, NULL);
+  EXPECT_EQ(1, refcount);
+  database.garbage_collect();
+  int exist = 0;
+  sqlite3_exec(database.db(), "SELECT name FROM categories;", &has_row, &exist, NULL);
+  EXPECT_EQ(0, exist);
+  sqlite3_exec(database.db(), "SELECT name FROM ingredients;", &has_row, &exist, NULL);
+  EXPECT_EQ(1, exist);
+}
+
+TEST(DatabaseTest, IncrementalVacuum) {
+  Database database;
+  database.open(":memory:");
+  int mode = -1;
+  sqlite3_exec(database.db(), "PRAGMA auto_vacuum;", &int_value, &mode, NULL);
+  EXPECT_EQ(2, mode);
+  EXPECT_TRUE(database.incremental_vacuum_enabled());
+  database.incremental_vacuum();
+}
+
 TEST(DatabaseTest, DeleteCategory) {
   Database database;
   database.open(":memory:");
@@ -13,6 +13,7 @@
 
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cctype>
 #include <gtest/gtest.h>
 #include "html.hh"
 
@@ -162,3 +163,60 @@ TEST(HTMLTest, IngredientSection) {
             "        <td colspan=\"3\"><em>Main</em></td>\n      </tr>\n      <tr>\n        <td style=\"white-space:nowrap;\">&nbsp;</td>\n"
             "        <td style=\"white-space:nowrap;\">&nbsp;</td>\n        <td>flour</td>\n      </tr>\n    </table>\n  </body>\n</html>", result);
 }
+
+TEST(HTMLTest, EscapeAllSpecialCharacters) {
+  Recipe recipe;
+  recipe.add_instruction("a<b>c&d\"e'f");
+  string result = recipe_to_html(recipe);
+  EXPECT_EQ("<html>\n  <head>\n  </head>\n  <body>\n    <h3>Instructions</h3>"
+            "\n    <p>a&lt;b&gt;c&amp;d&quot;e&apos;f</p>\n  </body>\n</html>", result);
+}
+
+TEST(HTMLTest, AmountWithManyDigits) {
+  Ingredient ingredient;
+  ingredient.set_amount_float(0.3333333);
+  EXPECT_EQ("0.333333", html_amount(ingredient));
+  ingredient.set_amount_float(1234567.0);
+  EXPECT_EQ("1.23457e+06", html_amount(ingredient));
+}
+
+static string translate_upper(const char *, const char *text) {
+  string result(text);
+  for (string::iterator c=result.begin(); c!=result.end(); c++)
+    *c = toupper(*c);
+  return result;
+}
+
+TEST(HTMLTest, RendererTranslatesUnits) {
+  Recipe recipe;
+  Ingredient ingredient;
+  ingredient.add_text("apple");
+  ingredient.set_unit("sm");
+  recipe.add_ingredient(ingredient);
+  HtmlRenderer renderer(&translate_upper);
+  string result = renderer.recipe_to_html(recipe);
+  EXPECT_NE(string::npos, result.find("<h3>INGREDIENTS</h3>"));
+  EXPECT_NE(string::npos, result.find(">SMALL&nbsp;<"));
+}
+
+TEST(HTMLTest, RendererReusesBuffer) {
+  HtmlRenderer renderer;
+  Recipe recipe1;
+  recipe1.set_title("First");
+  recipe1.add_instruction("Mix well.");
+  Recipe recipe2;
+  recipe2.set_title("Second");
+  string first = renderer.recipe_to_html(recipe1);
+  const string &second = renderer.recipe_to_html(recipe2);
+  EXPECT_EQ(recipe_to_html(recipe1), first);
+  EXPECT_EQ(recipe_to_html(recipe2), second);
+}
+
+TEST(HTMLTest, RendererMultipleRecipes) {
+  vector<Recipe> recipes(2);
+  recipes[0].set_title("First");
+  recipes[1].set_title("Second");
+  HtmlRenderer renderer;
+  EXPECT_EQ(recipes_to_html(recipes), renderer.recipes_to_html(recipes));
+  EXPECT_NE(string::npos, renderer.recipes_to_html(recipes).find("<div style=\"page-break-before:always\"></div>\n    <h2>Second</h2>"));
+}
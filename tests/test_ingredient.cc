@@ -28,3 +28,44 @@ TEST(IngredientTest, DefaultValues) {
   EXPECT_EQ(1, ingredient.amount_denominator());
   EXPECT_EQ(0.0, ingredient.amount_float());
 }
+
+TEST(IngredientTest, DefaultUnit) {
+  Ingredient ingredient;
+  EXPECT_EQ(UNIT_NONE, ingredient.unit_index());
+  EXPECT_EQ("  ", ingredient.unit());
+}
+
+TEST(IngredientTest, UnitFromCode) {
+  EXPECT_EQ(UNIT_PER_SERVING, unit_from_code("x "));
+  EXPECT_EQ(UNIT_GRAM, unit_from_code("g "));
+  EXPECT_EQ(UNIT_KILOGRAM, unit_from_code("kg"));
+  EXPECT_EQ(UNIT_NONE, unit_from_code("  "));
+  EXPECT_EQ(UNIT_NONE, unit_from_code("xy"));
+  EXPECT_EQ(UNIT_NONE, unit_from_code("g"));
+}
+
+TEST(IngredientTest, AlternativeUnitCodes) {
+  EXPECT_EQ(UNIT_TEASPOON, unit_from_code("t "));
+  EXPECT_EQ(UNIT_TEASPOON, unit_from_code("ts"));
+  EXPECT_EQ(UNIT_TABLESPOON, unit_from_code("T "));
+  EXPECT_EQ(UNIT_TABLESPOON, unit_from_code("tb"));
+}
+
+TEST(IngredientTest, UnitCode) {
+  Ingredient ingredient;
+  ingredient.set_unit(UNIT_LITER);
+  EXPECT_EQ("l ", ingredient.unit());
+  EXPECT_STREQ("  ", unit_code(UNIT_NONE + 1));
+}
+
+TEST(IngredientTest, Tokens) {
+  vector<string> tokens = ingredient_tokens("Large eggs, beaten");
+  ASSERT_EQ(3, tokens.size());
+  EXPECT_EQ("large", tokens[0]);
+  EXPECT_EQ("egg", tokens[1]);
+  EXPECT_EQ("beaten", tokens[2]);
+}
+
+TEST(IngredientTest, TokensOfPlurals) {
+  EXPECT_EQ(vector<string>({"tomato", "berry", "glass", "gas"}), ingredient_tokens("tomatoes berries glass gas"));
+}
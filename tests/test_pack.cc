@@ -0,0 +1,301 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "database.hh"
+#include "pack.hh"
+
+
+using namespace std;
+using namespace testing;
+
+static Recipe make_recipe(const char *title, const char *category, const char *ingredient) {
+  Recipe result;
+  result.set_title(title);
+  result.set_servings(4);
+  result.set_servings_unit("portions");
+  if (category)
+    result.add_category(category);
+  Ingredient ingredient1;
+  ingredient1.set_amount_integer(2);
+  ingredient1.set_unit("c");
+  ingredient1.set_text(ingredient);
+  result.add_ingredient(ingredient1);
+  result.add_instruction("Cook it.");
+  return result;
+}
+
+static void create_pack(const char *filename) {
+  Database database;
+  database.open(":memory:");
+  Recipe recipe1 = make_recipe("Tomato soup", "Soups", "tomatoes");
+  database.insert_recipe(recipe1);
+  Recipe recipe2 = make_recipe("Apple pie", "Baking", "apples");
+  database.insert_recipe(recipe2);
+  Recipe recipe3 = make_recipe("Bean soup", "Soups", "beans");
+  database.insert_recipe(recipe3);
+  Recipe recipe4 = make_recipe("Apple sauce", NULL, "apples");
+  database.insert_recipe(recipe4);
+  write_pack(database, filename);
+}
+
+static string read_pack(const char *filename) {
+  ifstream file(filename, ios::binary);
+  return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+static void write_file(const char *filename, const string &content) {
+  ofstream file(filename, ios::binary);
+  file.write(content.data(), content.size());
+}
+
+template <typename T>
+static T *table(string &pack, uint64_t offset) {
+  return (T *)&pack[offset];
+}
+
+TEST(PackTest, Header) {
+  create_pack("test.pack");
+  string pack = read_pack("test.pack");
+  ASSERT_GE(pack.size(), sizeof(PackHeader));
+  const PackHeader &header = *table<PackHeader>(pack, 0);
+  EXPECT_EQ(0, memcmp(header.magic, PACK_MAGIC, sizeof(header.magic)));
+  EXPECT_EQ(PACK_VERSION, header.version);
+  EXPECT_EQ(PACK_BYTE_ORDER, header.byte_order);
+  EXPECT_EQ(pack.size(), header.size);
+  EXPECT_EQ(4, header.num_recipes);
+  EXPECT_EQ(2, header.num_categories);
+  EXPECT_EQ(3, header.num_ingredients);
+  remove("test.pack");
+}
+
+TEST(PackTest, RoundTrip) {
+  create_pack("test.pack");
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    ASSERT_EQ(4, pack.size());
+    Recipe recipe = pack.recipe(2);
+    EXPECT_EQ("Bean soup", recipe.title());
+    EXPECT_EQ(4, recipe.servings());
+    EXPECT_EQ("portions", recipe.servings_unit());
+    ASSERT_EQ(1, recipe.categories().size());
+    EXPECT_EQ("Soups", *recipe.categories().begin());
+    ASSERT_EQ(1, recipe.ingredients().size());
+    EXPECT_EQ(2, recipe.ingredients()[0].amount_integer());
+    EXPECT_EQ("beans", recipe.ingredients()[0].text());
+    ASSERT_EQ(1, recipe.instructions().size());
+    EXPECT_EQ("Cook it.", recipe.instructions()[0]);
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, TitlesInOrder) {
+  create_pack("test.pack");
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    vector<pair<sqlite3_int64, string_view> > titles = pack.titles(1, 10);
+    ASSERT_EQ(3, titles.size());
+    EXPECT_EQ(make_pair((sqlite3_int64)4, string_view("Apple sauce")), titles[0]);
+    EXPECT_EQ("Bean soup", titles[1].second);
+    EXPECT_EQ("Tomato soup", titles[2].second);
+    EXPECT_EQ("Apple pie", pack.title(0));
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, FindRecipeById) {
+  create_pack("test.pack");
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    EXPECT_EQ(3, pack.find(1));
+    EXPECT_EQ(0, pack.find(2));
+    EXPECT_EQ(1, pack.find(4));
+    EXPECT_EQ(-1, pack.find(5));
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, RecipesInCategory) {
+  create_pack("test.pack");
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    ASSERT_EQ(2, pack.num_categories());
+    EXPECT_EQ("Baking", pack.category(0));
+    EXPECT_EQ("Soups", pack.category(1));
+    pack_range_t soups = pack.recipes_in_category("Soups");
+    ASSERT_EQ(2, soups.second - soups.first);
+    EXPECT_EQ(2, soups.first[0]);
+    EXPECT_EQ(3, soups.first[1]);
+    pack_range_t none = pack.recipes_in_category("Drinks");
+    EXPECT_EQ(none.first, none.second);
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, RecipesWithIngredient) {
+  create_pack("test.pack");
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    pack_range_t apples = pack.recipes_with_ingredient("apples");
+    ASSERT_EQ(2, apples.second - apples.first);
+    EXPECT_EQ(0, apples.first[0]);
+    EXPECT_EQ(1, apples.first[1]);
+    EXPECT_EQ(0, pack.recipes_with_ingredient("pears").second - pack.recipes_with_ingredient("pears").first);
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectFileWithoutMagic) {
+  {
+    ofstream file("test.pack", ios::binary);
+    file << string(1024, 'x');
+  }
+  RecipePack pack;
+  EXPECT_THROW(pack.open("test.pack"), pack_exception);
+  EXPECT_EQ(0, pack.size());
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectTruncatedFile) {
+  create_pack("test.pack");
+  string content;
+  {
+    ifstream file("test.pack", ios::binary);
+    content.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  }
+  {
+    ofstream file("test.pack", ios::binary);
+    file.write(content.data(), content.size() / 2);
+  }
+  RecipePack pack;
+  EXPECT_THROW(pack.open("test.pack"), pack_exception);
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectTruncatedHeader) {
+  create_pack("test.pack");
+  write_file("test.pack", read_pack("test.pack").substr(0, sizeof(PackHeader) - 1));
+  RecipePack pack;
+  EXPECT_THROW(pack.open("test.pack"), pack_exception);
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectOtherByteOrder) {
+  create_pack("test.pack");
+  string content = read_pack("test.pack");
+  table<PackHeader>(content, 0)->byte_order = 0x04030201;
+  write_file("test.pack", content);
+  RecipePack pack;
+  EXPECT_THROW(pack.open("test.pack"), pack_exception);
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectTableOutsideFile) {
+  create_pack("test.pack");
+  string content = read_pack("test.pack");
+  table<PackHeader>(content, 0)->categories = content.size() - sizeof(uint64_t);
+  write_file("test.pack", content);
+  RecipePack pack;
+  EXPECT_THROW(pack.open("test.pack"), pack_exception);
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectMisalignedTable) {
+  create_pack("test.pack");
+  string content = read_pack("test.pack");
+  table<PackHeader>(content, 0)->recipes += 1;
+  write_file("test.pack", content);
+  RecipePack pack;
+  EXPECT_THROW(pack.open("test.pack"), pack_exception);
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectStringOutsideFile) {
+  create_pack("test.pack");
+  string content = read_pack("test.pack");
+  PackRecipe *recipes = table<PackRecipe>(content, table<PackHeader>(content, 0)->recipes);
+  recipes[0].title.offset = content.size() - 2;
+  write_file("test.pack", content);
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    EXPECT_THROW(pack.title(0), pack_exception);
+    EXPECT_THROW(pack.recipe(0), pack_exception);
+    EXPECT_EQ("Apple sauce", pack.title(1));
+    TitleList titles;
+    EXPECT_THROW(browse_pack(titles, pack), pack_exception);
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, RejectUnterminatedString) {
+  create_pack("test.pack");
+  string content = read_pack("test.pack");
+  PackRecipe *recipes = table<PackRecipe>(content, table<PackHeader>(content, 0)->recipes);
+  content[recipes[1].title.offset + recipes[1].title.size] = 'x';
+  write_file("test.pack", content);
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    EXPECT_THROW(pack.title(1), pack_exception);
+    EXPECT_THROW(pack_recipe_to_html(pack, 4), pack_exception);
+    EXPECT_EQ("Apple pie", pack.title(0));
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, BrowseTitles) {
+  create_pack("test.pack");
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    TitleList titles;
+    browse_pack(titles, pack);
+    ASSERT_EQ(4, titles.size());
+    EXPECT_EQ("Apple sauce", titles[1].second);
+    EXPECT_FALSE(titles.can_fetch_more());
+    StringPool pool;
+    vector<pair<sqlite3_int64, string_view> > page = pack_titles(pack)(2, titles[1], 10, pool);
+    ASSERT_EQ(2, page.size());
+    EXPECT_EQ(make_pair((sqlite3_int64)3, string_view("Bean soup")), page[0]);
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, RenderRecipe) {
+  create_pack("test.pack");
+  {
+    RecipePack pack;
+    pack.open("test.pack");
+    string html = pack_recipe_to_html(pack, 3);
+    EXPECT_NE(string::npos, html.find("Bean soup"));
+    EXPECT_NE(string::npos, html.find("beans"));
+    EXPECT_THROW(pack_recipe_to_html(pack, 5), pack_exception);
+  }
+  remove("test.pack");
+}
+
+TEST(PackTest, MissingFile) {
+  RecipePack pack;
+  EXPECT_THROW(pack.open("nosuchfile.pack"), pack_exception);
+}
@@ -0,0 +1,154 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <gtest/gtest.h>
+#include "prefetch.hh"
+
+
+using namespace std;
+using namespace testing;
+
+class PrefetchTest: public Test {
+protected:
+  void SetUp(void) {
+    remove("prefetch.sqlite");
+    Database database;
+    database.open("prefetch.sqlite");
+    Recipe recipe1;
+    recipe1.set_title("Recipe A");
+    database.insert_recipe(recipe1);
+    Recipe recipe2;
+    recipe2.set_title("Recipe B");
+    database.insert_recipe(recipe2);
+  }
+  void TearDown(void) {
+    remove("prefetch.sqlite");
+  }
+};
+
+TEST_F(PrefetchTest, NotCached) {
+  Prefetcher prefetcher;
+  prefetcher.open("prefetch.sqlite");
+  Recipe recipe;
+  string html;
+  EXPECT_FALSE(prefetcher.lookup(1, recipe, html));
+}
+
+TEST_F(PrefetchTest, FetchAndRender) {
+  Prefetcher prefetcher;
+  prefetcher.open("prefetch.sqlite");
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  ids.push_back(2);
+  prefetcher.prefetch(ids);
+  prefetcher.wait();
+  Recipe recipe;
+  string html;
+  ASSERT_TRUE(prefetcher.lookup(2, recipe, html));
+  EXPECT_EQ("Recipe B", recipe.title());
+  EXPECT_EQ(recipe_to_html(recipe), html);
+}
+
+TEST_F(PrefetchTest, DropOutsideOfRange) {
+  Prefetcher prefetcher;
+  prefetcher.open("prefetch.sqlite");
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  prefetcher.prefetch(ids);
+  prefetcher.wait();
+  ids[0] = 2;
+  prefetcher.prefetch(ids);
+  prefetcher.wait();
+  Recipe recipe;
+  string html;
+  EXPECT_FALSE(prefetcher.lookup(1, recipe, html));
+  EXPECT_TRUE(prefetcher.lookup(2, recipe, html));
+}
+
+TEST_F(PrefetchTest, ClearCache) {
+  Prefetcher prefetcher;
+  prefetcher.open("prefetch.sqlite");
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  prefetcher.prefetch(ids);
+  prefetcher.wait();
+  Database database;
+  database.open("prefetch.sqlite");
+  vector<sqlite3_int64> recipes;
+  recipes.push_back(1);
+  database.add_recipes_to_category(recipes, "Dessert");
+  prefetcher.clear();
+  prefetcher.wait();
+  Recipe recipe;
+  string html;
+  ASSERT_TRUE(prefetcher.lookup(1, recipe, html));
+  EXPECT_EQ(1, recipe.categories().size());
+}
+
+TEST_F(PrefetchTest, SkipMissingRecipe) {
+  Prefetcher prefetcher;
+  prefetcher.open("prefetch.sqlite");
+  vector<sqlite3_int64> ids;
+  ids.push_back(3);
+  prefetcher.prefetch(ids);
+  prefetcher.wait();
+  Recipe recipe;
+  string html;
+  EXPECT_FALSE(prefetcher.lookup(3, recipe, html));
+}
+
+static atomic<int> translations(0);
+
+static string counting_translate(const char *, const char *text) {
+  translations++;
+  return text;
+}
+
+TEST_F(PrefetchTest, FlushStopsRendering) {
+  Prefetcher prefetcher;
+  prefetcher.open("prefetch.sqlite", &counting_translate);
+  vector<sqlite3_int64> ids;
+  ids.push_back(1);
+  ids.push_back(2);
+  prefetcher.prefetch(ids);
+  prefetcher.flush();
+  int count = translations;
+  this_thread::sleep_for(chrono::milliseconds(50));
+  EXPECT_EQ(count, translations);
+  Recipe recipe;
+  string html;
+  EXPECT_FALSE(prefetcher.lookup(1, recipe, html));
+  EXPECT_FALSE(prefetcher.lookup(2, recipe, html));
+}
+
+TEST_F(PrefetchTest, CloseAndOpenAgain) {
+  Prefetcher prefetcher;
+  prefetcher.open("prefetch.sqlite");
+  prefetcher.prefetch(vector<sqlite3_int64>(1, 1));
+  prefetcher.wait();
+  prefetcher.close();
+  Recipe recipe;
+  string html;
+  EXPECT_FALSE(prefetcher.lookup(1, recipe, html));
+  prefetcher.open("prefetch.sqlite");
+  prefetcher.prefetch(vector<sqlite3_int64>(1, 2));
+  prefetcher.wait();
+  ASSERT_TRUE(prefetcher.lookup(2, recipe, html));
+  EXPECT_EQ("Recipe B", recipe.title());
+}
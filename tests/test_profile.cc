@@ -0,0 +1,76 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <gtest/gtest.h>
+#include "profile.hh"
+
+
+using namespace std;
+using namespace testing;
+
+TEST(ProfileTest, Empty) {
+  StatementProfile profile;
+  EXPECT_EQ(0, profile.count());
+  EXPECT_EQ(0, profile.total());
+  EXPECT_EQ(0, profile.percentile(0.99));
+}
+
+TEST(ProfileTest, Totals) {
+  StatementProfile profile;
+  profile.record(1000, 2, 30);
+  profile.record(3000, 1, 10);
+  EXPECT_EQ(2, profile.count());
+  EXPECT_EQ(4000, profile.total());
+  EXPECT_EQ(3000, profile.maximum());
+  EXPECT_EQ(3, profile.rows());
+  EXPECT_EQ(40, profile.vm_steps());
+}
+
+TEST(ProfileTest, SmallTimesAreExact) {
+  StatementProfile profile;
+  profile.record(5, 0, 0);
+  EXPECT_EQ(5, profile.percentile(0.99));
+}
+
+TEST(ProfileTest, Percentile) {
+  StatementProfile profile;
+  for (int i=0; i<99; i++)
+    profile.record(1000, 0, 0);
+  profile.record(1000000, 0, 0);
+  EXPECT_GE(profile.percentile(0.99), 1000);
+  EXPECT_LE(profile.percentile(0.99), 1000 + 1000 / PROFILE_SUBBUCKETS);
+  EXPECT_EQ(1000000, profile.percentile(1.0));
+}
+
+TEST(ProfileTest, PercentileOfSlowCalls) {
+  StatementProfile profile;
+  for (int i=0; i<90; i++)
+    profile.record(1000, 0, 0);
+  for (int i=0; i<10; i++)
+    profile.record(200000, 0, 0);
+  EXPECT_GE(profile.percentile(0.99), 200000);
+  EXPECT_LE(profile.percentile(0.99), 200000);
+}
+
+TEST(ProfileTest, Report) {
+  vector<pair<string, StatementProfile> > profile;
+  StatementProfile statement;
+  statement.record(2000000, 3, 42);
+  profile.push_back(make_pair(string("SELECT id\nFROM recipes;"), statement));
+  string report = profile_report(profile);
+  EXPECT_NE(string::npos, report.find("p99 ms"));
+  EXPECT_NE(string::npos, report.find("2.000"));
+  EXPECT_NE(string::npos, report.find("SELECT id FROM recipes;"));
+}
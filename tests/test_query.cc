@@ -0,0 +1,147 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <gtest/gtest.h>
+#include "query.hh"
+
+
+using namespace std;
+using namespace testing;
+
+static string canonical(const char *text) {
+  return query_to_string(simplify_query(parse_query(text)));
+}
+
+TEST(QueryTest, EmptyQuery) {
+  EXPECT_FALSE(parse_query("  "));
+}
+
+TEST(QueryTest, Field) {
+  query_t query = parse_query("cat:vegan");
+  ASSERT_TRUE(query);
+  EXPECT_EQ(QUERY_CATEGORY, query->kind());
+  EXPECT_EQ("vegan", query->value());
+}
+
+TEST(QueryTest, FieldAliases) {
+  EXPECT_EQ("title:soup", canonical("title:soup"));
+  EXPECT_EQ("cat:vegan", canonical("category:vegan"));
+  EXPECT_EQ("ing:tofu", canonical("ingredient:tofu"));
+  EXPECT_EQ("text:simmer", canonical("text:simmer"));
+}
+
+TEST(QueryTest, PlainWordIsTitle) {
+  EXPECT_EQ("title:soup", canonical("soup"));
+}
+
+TEST(QueryTest, UnknownFieldIsTitle) {
+  EXPECT_EQ("title:time:10", canonical("time:10"));
+}
+
+TEST(QueryTest, QuotedValue) {
+  EXPECT_EQ("ing:\"olive oil\"", canonical("ing:\"olive oil\""));
+  EXPECT_EQ("title:\"say \"\"cheese\"\"\"", canonical("\"say \"\"cheese\"\"\""));
+}
+
+TEST(QueryTest, Precedence) {
+  EXPECT_EQ("title:a OR (title:b AND title:c)", canonical("a OR b AND c"));
+  EXPECT_EQ("(title:a OR title:b) AND title:c", canonical("(a OR b) AND c"));
+}
+
+TEST(QueryTest, ImplicitConjunction) {
+  EXPECT_EQ("title:chicken AND title:soup", canonical("chicken soup"));
+}
+
+TEST(QueryTest, Negation) {
+  EXPECT_EQ("title:soup AND NOT ing:nuts", canonical("soup AND NOT ing:nuts"));
+  EXPECT_EQ("NOT (title:a OR title:b)", canonical("NOT (a OR b)"));
+}
+
+TEST(QueryTest, LowerCaseKeywordIsWord) {
+  EXPECT_EQ("title:salt AND title:and AND title:pepper", canonical("salt and pepper"));
+}
+
+TEST(QueryTest, Example) {
+  EXPECT_EQ("title:soup AND (cat:vegan OR ing:tofu) AND NOT ing:nuts",
+            canonical("title:soup AND (cat:vegan OR ing:tofu) AND NOT ing:nuts"));
+}
+
+TEST(QueryTest, FlattenNested) {
+  query_t query = simplify_query(parse_query("a AND (b AND (c AND d))"));
+  EXPECT_EQ(QUERY_AND, query->kind());
+  EXPECT_EQ(4, query->children().size());
+}
+
+TEST(QueryTest, RemoveDoubleNegation) {
+  EXPECT_EQ("cat:vegan", canonical("NOT NOT cat:vegan"));
+}
+
+TEST(QueryTest, RemoveDuplicates) {
+  EXPECT_EQ("title:a OR title:b", canonical("a OR (b OR a)"));
+  EXPECT_EQ("title:a", canonical("a AND (a)"));
+}
+
+TEST(QueryTest, Combine) {
+  query_t query = query_and(query_t(), query_term(QUERY_TITLE, "soup"));
+  EXPECT_EQ("title:soup", query_to_string(query));
+  query = query_and(query, query_not(query_term(QUERY_INGREDIENT, "nuts")));
+  EXPECT_EQ("title:soup AND NOT ing:nuts", query_to_string(query));
+}
+
+TEST(QueryTest, MissingParenthesis) {
+  EXPECT_THROW(parse_query("(a OR b"), query_exception);
+  EXPECT_THROW(parse_query("a OR b)"), query_exception);
+}
+
+TEST(QueryTest, MissingTerm) {
+  EXPECT_THROW(parse_query("a AND"), query_exception);
+  EXPECT_THROW(parse_query("cat:"), query_exception);
+  EXPECT_THROW(parse_query("()"), query_exception);
+}
+
+TEST(QueryTest, MissingQuote) {
+  EXPECT_THROW(parse_query("\"soup"), query_exception);
+}
+
+TEST(QueryTest, CompileToSQL) {
+  vector<string> parameters;
+  string sql = query_to_sql(simplify_query(parse_query("cat:vegan OR NOT ing:tofu")), parameters);
+  EXPECT_EQ("(id IN (SELECT recipeid FROM category, categories WHERE categoryid = categories.id AND name LIKE ?1 || '%') OR "
+            "NOT id IN (SELECT recipeid FROM ingredientindex, ingredients WHERE ingredientid = ingredients.id AND "
+            "name LIKE '%' || ?2 || '%'))", sql);
+  ASSERT_EQ(2, parameters.size());
+  EXPECT_EQ("vegan", parameters[0]);
+  EXPECT_EQ("tofu", parameters[1]);
+}
+
+TEST(QueryTest, CompileWithSchema) {
+  vector<string> parameters;
+  string sql = query_to_sql(simplify_query(parse_query("title:soup")), parameters, "cookbook1.");
+  EXPECT_EQ("id IN (SELECT id FROM cookbook1.recipes WHERE title LIKE '%' || ?1 || '%')", sql);
+}
+
+TEST(QueryTest, DetectQuerySyntax) {
+  EXPECT_TRUE(uses_query_syntax("cat:vegan"));
+  EXPECT_TRUE(uses_query_syntax("soup AND (ing:leek)"));
+  EXPECT_FALSE(uses_query_syntax("Mac AND cheese"));
+  EXPECT_FALSE(uses_query_syntax("Grandma's \"best\" (old) cake"));
+  EXPECT_FALSE(uses_query_syntax("Ratio 1:2 bread"));
+}
+
+TEST(QueryTest, PlainTitleSearch) {
+  EXPECT_EQ("title:\"Mac AND (cheese\"", query_to_string(parse_search("Mac AND (cheese")));
+  EXPECT_EQ("cat:vegan", query_to_string(parse_search("cat:vegan")));
+  EXPECT_FALSE(parse_search(""));
+}
@@ -0,0 +1,140 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include "read_pool.hh"
+
+
+using namespace std;
+using namespace testing;
+
+class ReadPoolTest: public Test {
+protected:
+  void SetUp(void) {
+    remove("read_pool.sqlite");
+    m_database.open("read_pool.sqlite");
+    Recipe recipe;
+    recipe.set_title("Recipe A");
+    m_database.insert_recipe(recipe);
+  }
+  void TearDown(void) {
+    remove("read_pool.sqlite");
+    remove("read_pool.sqlite-wal");
+    remove("read_pool.sqlite-shm");
+  }
+  Database m_database;
+};
+
+int journal_mode(void *mode, int, char **values, char**) {
+  strncpy((char *)mode, values[0], 7);
+  return 0;
+}
+
+TEST_F(ReadPoolTest, WriteAheadLog) {
+  char mode[8] = "";
+  sqlite3_exec(m_database.db(), "PRAGMA journal_mode;", &journal_mode, mode, NULL);
+  EXPECT_STREQ("wal", mode);
+}
+
+TEST_F(ReadPoolTest, NotOpened) {
+  ReadPool pool;
+  EXPECT_THROW(pool.acquire(), database_exception);
+}
+
+TEST_F(ReadPoolTest, ReadRecipe) {
+  ReadPool pool;
+  pool.open("read_pool.sqlite");
+  Recipe recipe = pool.read([](Database &database) { return database.fetch_recipe(1); });
+  EXPECT_EQ("Recipe A", recipe.title());
+}
+
+TEST_F(ReadPoolTest, ReuseConnection) {
+  ReadPool pool;
+  pool.open("read_pool.sqlite");
+  pool.read([](Database &database) { database.fetch_recipe(1); });
+  pool.read([](Database &database) { database.fetch_recipe(1); });
+  EXPECT_EQ(1, pool.connections());
+}
+
+TEST_F(ReadPoolTest, ConcurrentLeases) {
+  ReadPool pool(2);
+  pool.open("read_pool.sqlite");
+  ReadPool::Lease lease1(pool);
+  ReadPool::Lease lease2(pool);
+  EXPECT_EQ(2, pool.connections());
+  EXPECT_EQ("Recipe A", lease2->fetch_recipe(1).title());
+}
+
+TEST_F(ReadPoolTest, ReadOnly) {
+  ReadPool pool;
+  pool.open("read_pool.sqlite");
+  Recipe recipe;
+  EXPECT_THROW(pool.read([&](Database &database) { database.insert_recipe(recipe); }), database_exception);
+}
+
+TEST_F(ReadPoolTest, ImplicitSelection) {
+  ReadPool pool;
+  pool.open("read_pool.sqlite");
+  EXPECT_EQ(1, pool.read([](Database &database) { return database.num_recipes(); }));
+}
+
+TEST_F(ReadPoolTest, SnapshotIsolation) {
+  ReadPool pool;
+  pool.open("read_pool.sqlite");
+  ReadPool::Lease lease(pool);
+  lease->begin();
+  lease->fetch_recipe(1);
+  Recipe recipe;
+  recipe.set_title("Recipe B");
+  m_database.insert_recipe(recipe);
+  EXPECT_THROW(lease->fetch_recipe(2), database_exception);
+  lease->commit();
+  EXPECT_EQ("Recipe B", lease->fetch_recipe(2).title());
+}
+
+TEST_F(ReadPoolTest, AttachCookbook) {
+  {
+    remove("read_pool_cookbook.sqlite");
+    Database cookbook;
+    cookbook.open("read_pool_cookbook.sqlite");
+    Recipe recipe;
+    recipe.set_title("Recipe B");
+    cookbook.insert_recipe(recipe);
+  }
+  ReadPool pool;
+  pool.open("read_pool.sqlite");
+  pool.read([](Database &database) { database.fetch_recipe(1); });
+  // Connections opened before attaching the cookbook attach it when they are handed out again.
+  pool.attach_cookbook("read_pool_cookbook.sqlite");
+  Recipe recipe = pool.read([](Database &database) { return database.fetch_recipe(Database::cookbook_id(1, 1)); });
+  EXPECT_EQ("Recipe B", recipe.title());
+  EXPECT_EQ(1, pool.connections());
+  remove("read_pool_cookbook.sqlite");
+  remove("read_pool_cookbook.sqlite-wal");
+  remove("read_pool_cookbook.sqlite-shm");
+}
+
+TEST_F(ReadPoolTest, CloseAndOpenAgain) {
+  ReadPool pool;
+  pool.open("read_pool.sqlite");
+  pool.read([](Database &database) { database.fetch_recipe(1); });
+  pool.close();
+  EXPECT_EQ(0, pool.connections());
+  EXPECT_THROW(pool.acquire(), database_exception);
+  pool.open("read_pool.sqlite");
+  EXPECT_EQ("Recipe A", pool.read([](Database &database) { return database.fetch_recipe(1); }).title());
+}
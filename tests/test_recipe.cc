@@ -40,3 +40,36 @@ TEST(RecipeTest, AppendToEmptyInstruction) {
   ASSERT_EQ(1, recipe.instructions().size());
   EXPECT_EQ("other", recipe.instructions()[0]);
 }
+
+TEST(RecipeTest, FingerprintOfContent) {
+  Recipe recipe1;
+  recipe1.set_title("Pancakes");
+  recipe1.add_instruction("Mix");
+  Recipe recipe2 = recipe1;
+  recipe2.add_category("Breakfast");
+  EXPECT_EQ(recipe_fingerprint(recipe1), recipe_fingerprint(recipe2));
+  recipe2.set_servings(4);
+  EXPECT_NE(recipe_fingerprint(recipe1), recipe_fingerprint(recipe2));
+}
+
+TEST(RecipeTest, FingerprintSeparatesStrings) {
+  Recipe recipe1;
+  recipe1.add_instruction("ab");
+  recipe1.add_instruction("c");
+  Recipe recipe2;
+  recipe2.add_instruction("a");
+  recipe2.add_instruction("bc");
+  EXPECT_NE(recipe_fingerprint(recipe1), recipe_fingerprint(recipe2));
+}
+
+TEST(RecipeTest, FingerprintOfIngredientAmount) {
+  Recipe recipe1;
+  Ingredient ingredient;
+  ingredient.set_text("flour");
+  ingredient.set_amount_integer(200);
+  recipe1.add_ingredient(ingredient);
+  Recipe recipe2;
+  ingredient.set_amount_integer(300);
+  recipe2.add_ingredient(ingredient);
+  EXPECT_NE(recipe_fingerprint(recipe1), recipe_fingerprint(recipe2));
+}
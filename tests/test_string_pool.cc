@@ -0,0 +1,79 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <cstring>
+#include <gtest/gtest.h>
+#include "string_pool.hh"
+
+
+using namespace std;
+using namespace testing;
+
+TEST(StringPoolTest, AddString) {
+  StringPool pool;
+  string text = "Apple pie";
+  string_view view = pool.add(text);
+  text = "changed";
+  EXPECT_EQ("Apple pie", view);
+  EXPECT_EQ(0, strcmp("Apple pie", view.data()));
+  EXPECT_EQ(10, pool.bytes());
+}
+
+TEST(StringPoolTest, ViewsRemainValid) {
+  StringPool pool;
+  string_view first = pool.add("first");
+  for (int i=0; i<100000; i++)
+    pool.add("some recipe title");
+  EXPECT_EQ("first", first);
+}
+
+TEST(StringPoolTest, AddDoesNotDeduplicate) {
+  StringPool pool;
+  EXPECT_NE(pool.add("soup").data(), pool.add("soup").data());
+}
+
+TEST(StringPoolTest, InternString) {
+  StringPool pool;
+  string_view a = pool.intern("Soups");
+  string_view b = pool.intern(string("Soups"));
+  EXPECT_EQ(a.data(), b.data());
+  EXPECT_NE(a.data(), pool.intern("Salads").data());
+  EXPECT_EQ(13, pool.bytes());
+}
+
+TEST(StringPoolTest, LongString) {
+  StringPool pool;
+  string_view small = pool.add("small");
+  string text(STRING_POOL_BLOCK * 2, 'x');
+  EXPECT_EQ(text, pool.add(text));
+  string_view other = pool.add("other");
+  EXPECT_EQ(small.data() + 6, other.data());
+}
+
+TEST(StringPoolTest, EmptyString) {
+  StringPool pool;
+  string_view view = pool.add("");
+  EXPECT_TRUE(view.empty());
+  EXPECT_EQ('\0', *view.data());
+}
+
+TEST(StringPoolTest, Clear) {
+  StringPool pool;
+  pool.intern("Soups");
+  pool.clear();
+  EXPECT_EQ(0, pool.bytes());
+  pool.intern("Soups");
+  EXPECT_EQ(6, pool.bytes());
+}
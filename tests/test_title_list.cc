@@ -0,0 +1,75 @@
+/* AnyMeal recipe management software
+   Copyright (C) 2024 Jan Wedekind
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <gtest/gtest.h>
+#include "title_list.hh"
+
+
+using namespace std;
+using namespace testing;
+
+// Fetch titles sorted alphabetically which come after the last title loaded.
+static TitleList::fetch_t fetch_from(const vector<pair<sqlite3_int64, string> > *titles) {
+  return [titles](int, const pair<sqlite3_int64, string_view> &last, int count, StringPool &pool) {
+    vector<pair<sqlite3_int64, string> > sorted(*titles);
+    sort(sorted.begin(), sorted.end(), [](const pair<sqlite3_int64, string> &a, const pair<sqlite3_int64, string> &b) {
+      return a.second < b.second;
+    });
+    vector<pair<sqlite3_int64, string_view> > result;
+    for (vector<pair<sqlite3_int64, string> >::const_iterator title=sorted.begin(); title!=sorted.end(); title++)
+      if (title->second > last.second && (int)result.size() < count)
+        result.push_back(make_pair(title->first, pool.add(title->second)));
+    return result;
+  };
+}
+
+TEST(TitleListTest, FetchPages) {
+  vector<pair<sqlite3_int64, string> > titles = {{1, "Apple pie"}, {2, "Bread"}, {3, "Crumble"}};
+  TitleList list;
+  list.reset({titles[0]}, 3, fetch_from(&titles));
+  EXPECT_EQ(1, list.size());
+  EXPECT_TRUE(list.can_fetch_more());
+  list.append(list.fetch_more());
+  ASSERT_EQ(3, list.size());
+  EXPECT_EQ("Crumble", list[2].second);
+  EXPECT_FALSE(list.can_fetch_more());
+}
+
+TEST(TitleListTest, SkipAddedRecipe) {
+  vector<pair<sqlite3_int64, string> > titles = {{1, "Apple pie"}, {2, "Bread"}};
+  TitleList list;
+  list.reset({titles[0]}, 1, fetch_from(&titles));
+  titles.push_back(make_pair(3, string("Crumble")));
+  list.add(3, "Crumble");
+  list.append(list.fetch_more());
+  ASSERT_EQ(2, list.size());
+  EXPECT_EQ(1, list[0].first);
+  EXPECT_EQ(3, list[1].first);
+}
+
+TEST(TitleListTest, SkipEditedRecipe) {
+  vector<pair<sqlite3_int64, string> > titles = {{1, "Apple pie"}, {2, "Bread"}, {3, "Crumble"}};
+  TitleList list;
+  list.reset({titles[0]}, 3, fetch_from(&titles));
+  titles[0] = make_pair(4, string("Biscuits"));
+  list.edit(0, 4, "Biscuits");
+  while (list.can_fetch_more())
+    list.append(list.fetch_more());
+  ASSERT_EQ(3, list.size());
+  EXPECT_EQ(4, list[0].first);
+  EXPECT_EQ(2, list[1].first);
+  EXPECT_EQ(3, list[2].first);
+}